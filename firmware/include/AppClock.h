@@ -0,0 +1,25 @@
+#ifndef APP_CLOCK_H
+#define APP_CLOCK_H
+
+#include <time.h>
+
+/*
+ * Time source for SideEyeApp. The firmware reads the ESP32 timers and SNTP;
+ * the native tests and the replay harness substitute a virtual clock so a
+ * recorded session can run faster than real time.
+ */
+class AppClock {
+public:
+    virtual ~AppClock() {}
+
+    virtual unsigned long millis() = 0;
+    virtual unsigned long micros() = 0;
+
+    // Seconds since the epoch; meaningless until the wall clock has synced
+    virtual time_t wallClock() = 0;
+
+    // Starts syncing the wall clock once the network is up
+    virtual void startWallClockSync() = 0;
+};
+
+#endif
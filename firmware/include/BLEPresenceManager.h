@@ -7,30 +7,60 @@
 #include <BLEAdvertisedDevice.h>
 #include <BLEServer.h>
 #include <ArduinoJson.h>
+#include "PresenceTracker.h"
+#include "SpscRing.h"
 
 class SideEyeNetworkManager;
 struct SystemState;
 
+/*
+ * Passive, duty-cycled scanning for the devices in the presence allowlist
+ * (see PresenceTracker). The allowlist and thresholds are set with the
+ * SetPresence serial command and kept in /presence.json on LittleFS:
+ * {"enabled":true,"macs":["AA:BB:CC:DD:EE:FF"],"irks":["<32 hex digits>"],
+ *  "enter_rssi":-75,"exit_rssi":-85,"window_ms":1000,"period_ms":4000}
+ * MACs are stored hashed; IRKs are hex, most significant byte first.
+ */
 class BLEPresenceManager : public BLEAdvertisedDeviceCallbacks {
 public:
+    // Controller timing while a scan window is open: listen 30 ms of every 100 ms
+    static const uint16_t SCAN_INTERVAL_MS = 100;
+    static const uint16_t SCAN_WINDOW_MS = 30;
+
     BLEPresenceManager();
     void begin(const char* deviceId);
     void update(SideEyeNetworkManager& network, SystemState& state);
     void setEnabled(bool enabled);
     bool isEnabled() const { return _enabled; }
-    bool isPresent() const { return _present; }
+    bool isPresent() const { return _tracker.present(); }
     const char* getStatusString() const;
 
-    // Callbacks
+    // Applies and saves a SetPresence frame; false (and no change) if an
+    // address or key doesn't parse or there are too many
+    bool configure(JsonObject data);
+    const PresenceTracker& tracker() const { return _tracker; }
+    BLEServer* server() const { return _pServer; } // Shared with BLETelemetry
+
+    // Callbacks (BLE task): only queue, update() does the rest
     void onResult(BLEAdvertisedDevice advertisedDevice) override;
 
 private:
+    static const char* const TARGETS_PATH;
+    static const size_t SIGHTING_QUEUE = 32; // Advertisements between two loop passes
+
+    // One advertisement, as onResult() hands it to the loop
+    struct Sighting {
+        uint8_t address[6];
+        int8_t rssi;
+        uint32_t at;
+    };
+
     bool _enabled = false;
-    bool _present = false;
     bool _lastSentPresence = false;
-    unsigned long _lastSeen = 0;
-    const unsigned long PRESENCE_TIMEOUT = 10000; // 10 seconds
-    String _targetMac = "";
+    bool _scanning = false;
+    unsigned long _lastNotify = 0;
+    PresenceTracker _tracker;
+    SpscRing<Sighting, SIGHTING_QUEUE> _sightings;
     
     BLEScan* _pBLEScan = nullptr;
     BLEServer* _pServer = nullptr;
@@ -39,6 +69,9 @@ private:
     void startScan();
     void stopScan();
     void setupServer(const char* deviceId);
+    bool applyTargets(JsonObject data, PresenceTracker& tracker, bool& enabled) const;
+    void loadTargets();
+    bool saveTargets() const;
 };
 
 #endif
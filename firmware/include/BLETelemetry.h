@@ -0,0 +1,140 @@
+#ifndef BLE_TELEMETRY_H
+#define BLE_TELEMETRY_H
+
+#include <Arduino.h>
+#include <BLEDevice.h>
+#include <BLEServer.h>
+#include <atomic>
+#include "SpscRing.h"
+
+/*
+ * The serial protocol over GATT, for hosts with no USB data connection.
+ *
+ * The host writes newline-terminated frames to the RX characteristic,
+ * preferably as writes without response packed up to MTU - 3 bytes; a
+ * frame may span writes and a write may hold several frames. Replies and
+ * acks come back as notifications on TX, split at MTU - 3 bytes.
+ *
+ * Writes arrive on the BLE task and are queued in an SpscRing that the
+ * loop reads like a serial port. After each loop pass that handled frames
+ * the app notifies {"type":"Ack","data":{"frames":3,"free":1536,"dropped":0}}:
+ * `free` is the ring space left, so a host that keeps its unacked bytes
+ * below it never has a write dropped. `dropped` counts writes that didn't
+ * fit since the connection opened.
+ *
+ * The service shares the presence GATT server and isn't advertised (the
+ * advertisement has room for one 128-bit UUID); hosts find it by name.
+ */
+#define BLE_TELEMETRY_SERVICE_UUID "53494445-4559-4500-8000-00805f9b34fb"
+#define BLE_TELEMETRY_RX_UUID      "53494445-4559-4501-8000-00805f9b34fb"
+#define BLE_TELEMETRY_TX_UUID      "53494445-4559-4502-8000-00805f9b34fb"
+
+class BLETelemetry : public Stream, public BLEServerCallbacks, public BLECharacteristicCallbacks {
+public:
+    static const uint16_t DEFAULT_MTU = 23;
+    static const uint16_t LOCAL_MTU = 517; // Largest ATT MTU; the peer picks the smaller
+    static const uint16_t ATT_OVERHEAD = 3;
+    static const size_t RX_SIZE = 2048;    // Power of two
+    static const size_t TX_CHUNK = LOCAL_MTU - ATT_OVERHEAD;
+
+    BLETelemetry() {}
+    BLETelemetry(const BLETelemetry&) = delete;
+    BLETelemetry& operator=(const BLETelemetry&) = delete;
+
+    // After BLEDevice::init(); adds the service to `server`
+    void begin(BLEServer* server) {
+        BLEDevice::setMTU(LOCAL_MTU);
+        server->setCallbacks(this);
+        BLEService* service = server->createService(BLE_TELEMETRY_SERVICE_UUID);
+        _rxCharacteristic = service->createCharacteristic(
+            BLE_TELEMETRY_RX_UUID, BLECharacteristic::PROPERTY_WRITE | BLECharacteristic::PROPERTY_WRITE_NR);
+        _rxCharacteristic->setCallbacks(this);
+        _txCharacteristic = service->createCharacteristic(BLE_TELEMETRY_TX_UUID, BLECharacteristic::PROPERTY_NOTIFY);
+        service->start();
+    }
+
+    bool isConnected() const { return _connected.load(std::memory_order_relaxed); }
+    uint16_t mtu() const { return _mtu.load(std::memory_order_relaxed); }
+    size_t rxFree() const { return _rx.space(); }
+
+    // Stream: what the loop reads
+    int available() override { return (int)_rx.size(); }
+    int read() override {
+        uint8_t c;
+        return _rx.pop(c) ? c : -1;
+    }
+    int peek() override {
+        uint8_t c;
+        return _rx.peek(c) ? c : -1;
+    }
+
+    // Print: replies, sent a chunk at a time
+    using Print::write;
+    size_t write(uint8_t c) override {
+        if (!isConnected()) return 1; // Nobody to tell; keep the caller's accounting simple
+        _txBuffer[_txLength++] = c;
+        if (c == '\n' || _txLength >= (size_t)(mtu() - ATT_OVERHEAD)) flush();
+        return 1;
+    }
+    void flush() override {
+        if (_txLength == 0) return;
+        if (_txCharacteristic && isConnected()) {
+            _txCharacteristic->setValue(_txBuffer, _txLength);
+            _txCharacteristic->notify();
+        }
+        _txLength = 0;
+    }
+
+    // One notification per loop pass, however many frames it handled
+    void ack(uint32_t frames) {
+        if (!isConnected() || frames == 0) return;
+        printf("{\"type\":\"Ack\",\"data\":{\"frames\":%lu,\"free\":%u,\"dropped\":%lu}}\n", (unsigned long)frames,
+               (unsigned)rxFree(), (unsigned long)_dropped.load(std::memory_order_relaxed));
+    }
+
+    // BLE task callbacks
+    void onConnect(BLEServer*) override {
+        _mtu.store(DEFAULT_MTU, std::memory_order_relaxed);
+        _dropped.store(0, std::memory_order_relaxed);
+        _connected.store(true, std::memory_order_relaxed);
+    }
+    void onConnect(BLEServer* server, esp_ble_gatts_cb_param_t* param) override {
+        // 7.5-15 ms connection interval: several writes per event at full rate
+        server->updateConnParams(param->connect.remote_bda, 6, 12, 0, 400);
+    }
+    void onMtuChanged(BLEServer*, esp_ble_gatts_cb_param_t* param) override {
+        uint16_t mtu = param->mtu.mtu;
+        if (mtu > LOCAL_MTU) mtu = LOCAL_MTU;
+        if (mtu < DEFAULT_MTU) mtu = DEFAULT_MTU;
+        _mtu.store(mtu, std::memory_order_relaxed);
+    }
+    void onDisconnect(BLEServer* server) override {
+        _connected.store(false, std::memory_order_relaxed);
+        // A frame cut off by the disconnect must not run into the next
+        // connection's first one
+        _rx.push('\n');
+        server->startAdvertising();
+    }
+    void onWrite(BLECharacteristic* characteristic) override {
+        // All or nothing: a write that doesn't fit is dropped whole, and the
+        // frame it cut short is rejected as bad JSON
+        String value = characteristic->getValue();
+        if (!_rx.push((const uint8_t*)value.c_str(), value.length())) {
+            _dropped.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+private:
+    BLECharacteristic* _rxCharacteristic = nullptr;
+    BLECharacteristic* _txCharacteristic = nullptr;
+    std::atomic<bool> _connected{false};
+    std::atomic<uint16_t> _mtu{DEFAULT_MTU};
+    std::atomic<uint32_t> _dropped{0};
+
+    SpscRing<uint8_t, RX_SIZE> _rx; // BLE task to loop
+
+    uint8_t _txBuffer[TX_CHUNK];
+    size_t _txLength = 0;
+};
+
+#endif
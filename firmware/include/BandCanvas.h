@@ -0,0 +1,45 @@
+#ifndef BAND_CANVAS_H
+#define BAND_CANVAS_H
+
+#include <Arduino_GFX_Library.h>
+
+/*
+ * A full-size draw target that only keeps ROWS rows: drawing anywhere is
+ * allowed, but pixels outside the current band are dropped. Drawing the
+ * same frame once per band rasterizes it with a small scratch buffer
+ * instead of a full-screen canvas.
+ */
+class BandCanvas : public Arduino_GFX {
+public:
+    static const int16_t ROWS = 16;
+
+    // `buffer` holds width * ROWS pixels and is owned by the caller
+    BandCanvas(int16_t width, int16_t height, uint16_t* buffer)
+        : Arduino_GFX(width, height), _width(width), _buffer(buffer) {}
+
+    bool begin(int32_t = GFX_NOT_DEFINED) override { return true; }
+
+    // Rows [top, top + ROWS) of the frame; call before drawing it again
+    void setBand(int16_t top) { _top = top; }
+
+    void writePixelPreclipped(int16_t x, int16_t y, uint16_t color) override {
+        if (y >= _top && y < _top + ROWS) _buffer[(y - _top) * _width + x] = color;
+    }
+
+    // Fills are most of a page (the background), so skip the per-pixel path
+    void writeFillRectPreclipped(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) override {
+        int16_t y1 = y < _top ? _top : y;
+        int16_t y2 = y + h > _top + ROWS ? _top + ROWS : y + h;
+        for (int16_t row = y1; row < y2; row++) {
+            uint16_t* out = _buffer + (row - _top) * _width + x;
+            for (int16_t i = 0; i < w; i++) out[i] = color;
+        }
+    }
+
+private:
+    int16_t _width;
+    int16_t _top = 0;
+    uint16_t* _buffer;
+};
+
+#endif
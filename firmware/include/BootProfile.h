@@ -0,0 +1,102 @@
+#ifndef BOOT_PROFILE_H
+#define BOOT_PROFILE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// Boot phases in the order they normally start. WiFi and MQTT finish in
+// loop(), after setup() has returned.
+enum BootPhase : uint8_t {
+    BOOT_SD,
+    BOOT_GFX,
+    BOOT_LITTLEFS,
+    BOOT_HISTORY,
+    BOOT_CONFIG,
+    BOOT_FIRST_FRAME,
+    BOOT_BLE,
+    BOOT_WIFI,
+    BOOT_MQTT,
+    NUM_BOOT_PHASES
+};
+
+/*
+ * Start and end times (micros() since power-on) of each boot phase, for
+ * tracking startup regressions across releases and card/flash variants.
+ *
+ * Reported as one JSON line:
+ * {"type":"BootProfile","data":{"version":"1.2.0","total_us":412000,
+ *  "phases":{"sd":[1200,80400],...,"mqtt":null}}}
+ * where each phase is [start_us, duration_us], or null if it hasn't
+ * finished.
+ */
+class BootProfile {
+public:
+    static const size_t LINE_SIZE = 384;
+
+    BootProfile() {
+        for (uint8_t i = 0; i < NUM_BOOT_PHASES; i++) {
+            _start[i] = 0;
+            _end[i] = 0;
+        }
+        _finished = 0;
+    }
+
+    void start(BootPhase phase, uint32_t us) { _start[phase] = us; }
+
+    void finish(BootPhase phase, uint32_t us) {
+        _end[phase] = us;
+        _finished |= 1u << phase;
+    }
+
+    bool finished(BootPhase phase) const { return _finished & (1u << phase); }
+    bool complete() const { return _finished == (1u << NUM_BOOT_PHASES) - 1; }
+
+    uint32_t duration(BootPhase phase) const { return finished(phase) ? _end[phase] - _start[phase] : 0; }
+
+    // Latest end time of any finished phase
+    uint32_t total() const {
+        uint32_t latest = 0;
+        for (uint8_t i = 0; i < NUM_BOOT_PHASES; i++) {
+            if (finished(static_cast<BootPhase>(i)) && _end[i] > latest) latest = _end[i];
+        }
+        return latest;
+    }
+
+    // Writes the JSON line (without newline); returns false if it didn't fit
+    bool format(const char* version, char* out, size_t size) const {
+        static const char* const names[NUM_BOOT_PHASES] = {
+            "sd", "gfx", "littlefs", "history", "config", "first_frame", "ble", "wifi", "mqtt"
+        };
+        size_t length = 0;
+        bool ok = append(out, size, length,
+                         "{\"type\":\"BootProfile\",\"data\":{\"version\":\"%s\",\"total_us\":%lu,\"phases\":{",
+                         version, (unsigned long)total());
+        for (uint8_t i = 0; i < NUM_BOOT_PHASES; i++) {
+            BootPhase phase = static_cast<BootPhase>(i);
+            const char* separator = i > 0 ? "," : "";
+            if (finished(phase)) {
+                ok = ok && append(out, size, length, "%s\"%s\":[%lu,%lu]", separator, names[i],
+                                  (unsigned long)_start[i], (unsigned long)duration(phase));
+            } else {
+                ok = ok && append(out, size, length, "%s\"%s\":null", separator, names[i]);
+            }
+        }
+        return ok && append(out, size, length, "}}}");
+    }
+
+private:
+    template <typename... Args>
+    static bool append(char* out, size_t size, size_t& length, const char* format, Args... args) {
+        int n = snprintf(out + length, size - length, format, args...);
+        if (n < 0 || (size_t)n >= size - length) return false;
+        length += n;
+        return true;
+    }
+
+    uint32_t _start[NUM_BOOT_PHASES];
+    uint32_t _end[NUM_BOOT_PHASES];
+    uint16_t _finished;
+};
+
+#endif
@@ -0,0 +1,189 @@
+#ifndef CONFIG_STORE_H
+#define CONFIG_STORE_H
+
+#include <Arduino.h>
+#include <LittleFS.h>
+#include <stddef.h>
+#include "Crc32.h"
+
+// Everything persisted across reboots: broker settings and display settings.
+// Laid out without implicit padding, and zeroed on construction, so equal
+// settings are equal byte for byte. Changing it means bumping
+// ConfigStore::VERSION.
+struct ConfigData {
+    uint32_t cycle_duration;
+    uint8_t brightness;
+    uint8_t rotation;
+    uint8_t cpu_warning;
+    uint8_t cpu_critical;
+    uint8_t ram_warning;
+    uint8_t ram_critical;
+    uint8_t graph_range;
+    uint8_t reserved[3];
+
+    char mqtt_server[40];
+    char mqtt_port[6];
+    char mqtt_user[40];
+    char mqtt_pass[40];
+    char mqtt_topic_prefix[40];
+    char mqtt_discovery_prefix[40];
+
+    ConfigData() { memset(static_cast<void*>(this), 0, sizeof(*this)); }
+
+    bool operator==(const ConfigData& other) const { return memcmp(this, &other, sizeof(*this)) == 0; }
+    bool operator!=(const ConfigData& other) const { return !(*this == other); }
+};
+
+static_assert(sizeof(ConfigData) == 14 + 6 + 5 * 40, "ConfigData must not contain padding");
+
+/*
+ * Keeps ConfigData in a fixed binary record on LittleFS.
+ *
+ * Changes are debounced: request() only remembers the latest settings, and
+ * update() writes them once no further change has come in for the debounce
+ * time (or the maximum delay has passed since the first one), so a slider
+ * drag costs one flash write instead of dozens. Settings equal to what's
+ * already stored are never written.
+ *
+ * Records alternate between two files, each with a sequence number and a
+ * CRC; load takes the newest that verifies, so a torn write falls back to
+ * the previous settings. Loading is a single read of the whole record.
+ */
+class ConfigStore {
+public:
+    static const uint32_t MAGIC = 0x43455953; // "SYEC"
+    static const uint16_t VERSION = 1;
+    static const uint8_t SLOTS = 2;
+
+    explicit ConfigStore(unsigned long debounce = 2000, unsigned long maxDelay = 10000)
+        : _debounce(debounce), _maxDelay(maxDelay) {}
+
+    // Loads the newest valid record into `data`. Returns false, leaving it
+    // untouched, if there is none.
+    bool load(ConfigData& data) {
+        bool found = false;
+        for (uint8_t slot = 0; slot < SLOTS; slot++) {
+            Record record;
+            if (read(slot, record) && (!found || (int32_t)(record.sequence - _sequence) > 0)) {
+                found = true;
+                _sequence = record.sequence;
+                _stored = record.data;
+            }
+        }
+        if (!found) return false;
+        _hasStored = true;
+        data = _stored;
+        return true;
+    }
+
+    // Schedules `data` to be written. Returns false if it matches what's
+    // stored, in which case any pending write is dropped.
+    bool request(const ConfigData& data, unsigned long now) {
+        if (_hasStored && data == _stored) {
+            _pending = false;
+            return false;
+        }
+        if (!_pending) _firstRequest = now;
+        _pending = true;
+        _lastRequest = now;
+        _requested = data;
+        return true;
+    }
+
+    // Call every loop(); returns true when a record was written
+    bool update(unsigned long now) {
+        if (!_pending) return false;
+        if (now - _lastRequest < _debounce && now - _firstRequest < _maxDelay) return false;
+        return flush();
+    }
+
+    // Writes a pending change now (shutdown and first-boot migration)
+    bool flush() {
+        if (!_pending) return false;
+        _pending = false; // A failing filesystem is retried on the next change, not every loop
+        return write(_requested);
+    }
+
+    // Removes every record, e.g. on a settings reset
+    void clear() {
+        char path[20];
+        for (uint8_t slot = 0; slot < SLOTS; slot++) {
+            slotPath(slot, path, sizeof(path));
+            LittleFS.remove(path);
+        }
+        _pending = false;
+        _hasStored = false;
+    }
+
+    bool pending() const { return _pending; }
+    uint32_t sequence() const { return _sequence; }
+    uint32_t writes() const { return _writes; }
+
+    static void slotPath(uint8_t slot, char* out, size_t size) {
+        snprintf(out, size, "/config%u.bin", (unsigned)slot);
+    }
+
+private:
+    struct Record {
+        uint32_t magic;
+        uint16_t version;
+        uint16_t size;
+        uint32_t sequence;
+        ConfigData data;
+        uint32_t crc; // Of everything before it
+    };
+
+    static uint32_t recordCrc(const Record& record) {
+        return crc32Update(0, &record, offsetof(Record, crc));
+    }
+
+    bool read(uint8_t slot, Record& record) {
+        char path[20];
+        slotPath(slot, path, sizeof(path));
+        if (!LittleFS.exists(path)) return false;
+        File file = LittleFS.open(path, "r");
+        if (!file) return false;
+        bool valid = file.size() == sizeof(record) &&
+            file.read(reinterpret_cast<uint8_t*>(&record), sizeof(record)) == sizeof(record);
+        file.close();
+        return valid && record.magic == MAGIC && record.version == VERSION &&
+            record.size == sizeof(ConfigData) && record.crc == recordCrc(record);
+    }
+
+    bool write(const ConfigData& data) {
+        Record record;
+        record.magic = MAGIC;
+        record.version = VERSION;
+        record.size = sizeof(ConfigData);
+        record.sequence = _sequence + 1;
+        record.data = data;
+        record.crc = recordCrc(record);
+
+        char path[20];
+        slotPath(record.sequence % SLOTS, path, sizeof(path));
+        File file = LittleFS.open(path, "w");
+        if (!file) return false;
+        bool ok = file.write(reinterpret_cast<const uint8_t*>(&record), sizeof(record)) == sizeof(record);
+        file.close();
+        if (!ok) return false;
+
+        _sequence = record.sequence;
+        _stored = data;
+        _hasStored = true;
+        _writes++;
+        return true;
+    }
+
+    unsigned long _debounce;
+    unsigned long _maxDelay;
+    unsigned long _firstRequest = 0;
+    unsigned long _lastRequest = 0;
+    ConfigData _stored;
+    ConfigData _requested;
+    uint32_t _sequence = 0;
+    uint32_t _writes = 0;
+    bool _hasStored = false;
+    bool _pending = false;
+};
+
+#endif
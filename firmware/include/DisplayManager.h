@@ -5,7 +5,12 @@
 #include <Arduino_GFX_Library.h>
 #include <WiFi.h>
 #include "catppuccin_colors.h"
-#include "HistoryBuffer.h"
+#include "StaticString.h"
+#include "TelemetryHistory.h"
+#include "Scheduler.h"
+#include "StaticLayerCache.h"
+#include "BandCanvas.h"
+#include "Trace.h"
 #include <SD.h>
 
 /* 
@@ -29,51 +34,71 @@ enum Page {
     NUM_PAGES
 };
 
+enum SyncStatus : uint8_t {
+    SYNC_IDLE,
+    SYNC_ACTIVE,
+    SYNC_ERROR
+};
+
+inline const char* syncStatusLabel(uint8_t status) {
+    switch (status) {
+        case SYNC_ACTIVE: return "Syncing...";
+        case SYNC_ERROR: return "Error!";
+        default: return "Idle";
+    }
+}
+
+/*
+ * Everything the pages render. Fixed size and heap-free: the fields written
+ * by every Stats message and read by every frame come first, then settings,
+ * then the identity strings that change once per connection.
+ *
+ * Sizes are stored in MiB and rates in bytes/s so they fit in 32 bits.
+ */
 struct SystemState {
-    String hostname = "Unknown";
-    String ip = "No IP";
-    String mac = "No MAC";
-    String os = "Unknown";
-    String user = "Unknown";
     float cpu_percent = 0;
-    uint64_t ram_used = 0;
-    uint64_t ram_total = 0;
-    uint64_t disk_used = 0;
-    uint64_t disk_total = 0;
-    uint64_t net_up = 0;
-    uint64_t net_down = 0;
-    HistoryBuffer<uint64_t, 60> net_up_history;
-    HistoryBuffer<uint64_t, 60> net_down_history;
-    uint64_t uptime = 0;
-    uint64_t sd_used = 0;
-    uint64_t sd_total = 0;
-    String sd_sync_status = "Idle";
     float thermal_c = 0;
     float gpu_percent = 0;
+    uint32_t ram_used_mb = 0;
+    uint32_t ram_total_mb = 0;
+    uint32_t disk_used_mb = 0;
+    uint32_t disk_total_mb = 0;
+    uint32_t net_up = 0;
+    uint32_t net_down = 0;
+    uint32_t uptime = 0;
     uint8_t alert_level = 0;
+    uint8_t sd_sync_status = SYNC_IDLE;
     bool has_data = false;
     bool connected = false;
-    String ble_status = "Disabled";
-    bool ble_present = false;
 
     // Configurable Settings
+    uint32_t cycle_duration = 5000;
     uint8_t brightness = 255;
-    int rotation = 1;
-    unsigned long cycle_duration = 5000;
+    uint8_t rotation = 1;
     uint8_t cpu_warning = 50;
     uint8_t cpu_critical = 80;
     uint8_t ram_warning = 50;
     uint8_t ram_critical = 80;
+    uint8_t graph_range = RANGE_MINUTE;
+
+    StaticString<32> hostname = "Unknown";
+    StaticString<40> ip = "No IP"; // Fits a full IPv6 address
+    StaticString<18> mac = "No MAC";
+    StaticString<32> os = "Unknown";
+    StaticString<32> user = "Unknown";
 };
 
+static_assert(sizeof(SystemState) <= 256, "SystemState should fit in four cache lines");
+
 class DisplayManager {
 public:
     DisplayManager() : 
         bus(LCD_DC, LCD_CS, LCD_SCK, LCD_MOSI, LCD_MISO),
-        gfx(&bus, LCD_RST, 0 /* rotation */, true /* IPS */,
+        panel(&bus, LCD_RST, 0 /* rotation */, true /* IPS */,
             135 /* width */, 240 /* height */,
             52 /* col offset 1 */, 40 /* row offset 1 */,
-            53 /* col offset 2 */, 40 /* row offset 2 */)
+            53 /* col offset 2 */, 40 /* row offset 2 */),
+        gfx(&panel)
     {}
 
     ~DisplayManager() {}
@@ -87,14 +112,14 @@ public:
             pinMode(LCD_BL, OUTPUT);
             setBacklight(state, true);
         }
-        gfx.begin();
-        gfx.setRotation(currentRotation);
-        gfx.fillScreen(CATPPUCCIN_BASE);
+        gfx->begin();
+        gfx->setRotation(currentRotation);
+        gfx->fillScreen(CATPPUCCIN_BASE);
     }
 
     void setRotation(int rotation) {
         currentRotation = rotation;
-        gfx.setRotation(currentRotation);
+        gfx->setRotation(currentRotation);
     }
 
     int getRotation() {
@@ -102,29 +127,45 @@ public:
     }
 
     void setBacklight(const SystemState& state, bool on) {
-        analogWrite(LCD_BL, on ? state.brightness : 0);
+        uint8_t level = on ? state.brightness : 0;
+        _backlight.set(level);
+        analogWrite(LCD_BL, level);
     }
 
+    // Starts a backlight fade and returns immediately. The LEDC peripheral
+    // ramps the duty cycle in hardware; the tween only tracks where the fade
+    // is so a reversed fade can start from the current level.
     void fadeBacklight(uint8_t target, uint16_t duration_ms) {
-        static uint8_t current_brightness = 255;
-        int steps = 20;
-        int delay_step = duration_ms / steps;
-        int delta = (target - current_brightness) / steps;
-
-        for (int i = 0; i < steps; i++) {
-            current_brightness += delta;
-            analogWrite(LCD_BL, current_brightness);
-            delay(delay_step);
+        unsigned long now = millis();
+        int32_t from = _backlight.value(now);
+        _backlight.start(from, target, duration_ms, now);
+        if (!ledcFade(LCD_BL, from, target, duration_ms)) {
+            _backlight.set(target);
+            analogWrite(LCD_BL, target);
         }
-        current_brightness = target;
-        analogWrite(LCD_BL, current_brightness);
+    }
+
+    uint8_t getBacklightLevel() const {
+        return (uint8_t)_backlight.value(millis());
+    }
+
+    // Advances timers and animations. Call once per loop(); returns true when
+    // an overlay has expired and the screen underneath needs repainting.
+    bool update() {
+        unsigned long now = millis();
+        _backlight.update(now);
+        _scheduler.update(now);
+        bool expired = _overlayExpired;
+        _overlayExpired = false;
+        return expired;
     }
 
     void fillScreen(uint16_t color) {
-        gfx.fillScreen(color);
+        gfx->fillScreen(color);
     }
 
     void drawBanner(const char* title, uint8_t alert_level = 0) {
+        TRACE_SCOPE(TRACE_DRAW_BANNER, alert_level);
         uint16_t bg_color = CATPPUCCIN_MAUVE;
         if (alert_level == 1) {
             bg_color = CATPPUCCIN_YELLOW;
@@ -133,118 +174,129 @@ public:
             bg_color = ((millis() / 500) % 2 == 0) ? CATPPUCCIN_RED : CATPPUCCIN_BASE;
         }
 
-        gfx.fillRect(0, 0, 240, 20, bg_color);
-        gfx.setTextColor(bg_color == CATPPUCCIN_BASE ? CATPPUCCIN_RED : CATPPUCCIN_CRUST);
-        gfx.setTextSize(1);
+        gfx->fillRect(0, 0, 240, 20, bg_color);
+        gfx->setTextColor(bg_color == CATPPUCCIN_BASE ? CATPPUCCIN_RED : CATPPUCCIN_CRUST);
+        gfx->setTextSize(1);
         
         int16_t x1, y1;
         uint16_t w, h;
-        gfx.getTextBounds(title, 0, 0, &x1, &y1, &w, &h);
-        gfx.setCursor((240 - w) / 2, 6);
-        gfx.println(title);
+        gfx->getTextBounds(title, 0, 0, &x1, &y1, &w, &h);
+        gfx->setCursor((240 - w) / 2, 6);
+        gfx->println(title);
     }
 
     void drawWiFiStatus() {
         int x = (currentRotation == 1) ? 225 : 15;
         int y = 10;
         if (WiFi.status() == WL_CONNECTED) {
-            gfx.fillCircle(x, y, 3, CATPPUCCIN_GREEN);
+            gfx->fillCircle(x, y, 3, CATPPUCCIN_GREEN);
         } else {
-            gfx.fillCircle(x, y, 3, CATPPUCCIN_RED);
+            gfx->fillCircle(x, y, 3, CATPPUCCIN_RED);
         }
     }
 
     void drawProgressBar(int x, int y, int w, int h, float percent, uint16_t color) {
-        gfx.drawRect(x, y, w, h, CATPPUCCIN_SURFACE0);
+        gfx->drawRect(x, y, w, h, CATPPUCCIN_SURFACE0);
         int fill_w = (int)((w - 2) * (percent / 100.0));
         if (fill_w < 0) fill_w = 0;
         if (fill_w > w - 2) fill_w = w - 2;
-        gfx.fillRect(x + 1, y + 1, w - 2, h - 2, CATPPUCCIN_BASE);
-        gfx.fillRect(x + 1, y + 1, fill_w, h - 2, color);
+        gfx->fillRect(x + 1, y + 1, w - 2, h - 2, CATPPUCCIN_BASE);
+        gfx->fillRect(x + 1, y + 1, fill_w, h - 2, color);
     }
 
-    template <typename T, size_t Size>
-    void drawSparkline(int x, int y, int w, int h, const HistoryBuffer<T, Size>& buffer, uint16_t color) {
-        gfx.drawRect(x, y, w, h, CATPPUCCIN_SURFACE0);
-        gfx.fillRect(x + 1, y + 1, w - 2, h - 2, CATPPUCCIN_BASE);
+    // Mean line over a min/max band for one tier of a rollup series.
+    void drawRollupGraph(int x, int y, int w, int h, const RollupSeries& series, GraphRange range, uint16_t color) {
+        gfx->drawRect(x, y, w, h, CATPPUCCIN_SURFACE0);
+        gfx->fillRect(x + 1, y + 1, w - 2, h - 2, CATPPUCCIN_BASE);
 
-        size_t count = buffer.count();
+        size_t count = series.count(range);
         if (count < 2) return;
 
-        T max_val = buffer.max();
-        if (max_val == 0) max_val = 1; // Avoid division by zero
+        float max_val = series.peak(range);
+        if (max_val <= 0) max_val = 1; // Avoid division by zero
+        size_t slots = series.capacity(range);
 
         int prev_x = -1;
         int prev_y = -1;
 
         for (size_t i = 0; i < count; i++) {
-            int cur_x = x + 1 + (int)(i * (w - 2) / (Size - 1));
-            T val = buffer.get(i);
-            int cur_y = y + h - 1 - (int)(val * (h - 2) / max_val);
-
+            int cur_x = x + 1 + (int)(i * (w - 2) / (slots - 1));
+            Rollup r = series.get(range, i);
+            int cur_y = y + h - 1 - (int)(r.mean * (h - 2) / max_val);
+
+            if (r.max > r.min) {
+                int top = y + h - 1 - (int)(r.max * (h - 2) / max_val);
+                int bottom = y + h - 1 - (int)(r.min * (h - 2) / max_val);
+                gfx->drawFastVLine(cur_x, top, bottom - top + 1, CATPPUCCIN_SURFACE1);
+            }
             if (prev_x != -1) {
-                gfx.drawLine(prev_x, prev_y, cur_x, cur_y, color);
+                gfx->drawLine(prev_x, prev_y, cur_x, cur_y, color);
             }
             prev_x = cur_x;
             prev_y = cur_y;
         }
     }
 
+    // Rollup history shown by the graphs; owned by the caller.
+    void setHistory(const TelemetryHistory* history) {
+        _history = history;
+    }
+
     void drawIdentityPage(const SystemState& state, bool labelsOnly) {
         if (labelsOnly) {
-            gfx.setTextColor(CATPPUCCIN_BLUE);
-            gfx.setCursor(start_x, start_y + line_h * 1.5);
-            gfx.print("Host: ");
+            gfx->setTextColor(CATPPUCCIN_BLUE);
+            gfx->setCursor(start_x, start_y + line_h * 1.5);
+            gfx->print("Host: ");
 
-            gfx.setCursor(start_x, start_y + line_h * 2.5);
-            gfx.setTextColor(CATPPUCCIN_GREEN);
-            gfx.print("IP:   ");
+            gfx->setCursor(start_x, start_y + line_h * 2.5);
+            gfx->setTextColor(CATPPUCCIN_GREEN);
+            gfx->print("IP:   ");
 
-            gfx.setCursor(start_x, start_y + line_h * 3.5);
-            gfx.setTextColor(CATPPUCCIN_FLAMINGO);
-            gfx.print("MAC:  ");
+            gfx->setCursor(start_x, start_y + line_h * 3.5);
+            gfx->setTextColor(CATPPUCCIN_FLAMINGO);
+            gfx->print("MAC:  ");
         } else {
-            gfx.setTextColor(CATPPUCCIN_TEXT);
+            gfx->setTextColor(CATPPUCCIN_TEXT);
             
-            gfx.fillRect(value_x, (int)(start_y + line_h * 1.5), 180, 8, CATPPUCCIN_BASE);
-            gfx.setCursor(value_x, (int)(start_y + line_h * 1.5));
-            gfx.println(state.hostname);
+            gfx->fillRect(value_x, (int)(start_y + line_h * 1.5), 180, 8, CATPPUCCIN_BASE);
+            gfx->setCursor(value_x, (int)(start_y + line_h * 1.5));
+            gfx->println(state.hostname.c_str());
 
-            gfx.fillRect(value_x, (int)(start_y + line_h * 2.5), 180, 8, CATPPUCCIN_BASE);
-            gfx.setCursor(value_x, (int)(start_y + line_h * 2.5));
-            gfx.println(state.ip);
+            gfx->fillRect(value_x, (int)(start_y + line_h * 2.5), 180, 8, CATPPUCCIN_BASE);
+            gfx->setCursor(value_x, (int)(start_y + line_h * 2.5));
+            gfx->println(state.ip.c_str());
 
-            gfx.fillRect(value_x, (int)(start_y + line_h * 3.5), 180, 8, CATPPUCCIN_BASE);
-            gfx.setCursor(value_x, (int)(start_y + line_h * 3.5));
-            gfx.println(state.mac);
+            gfx->fillRect(value_x, (int)(start_y + line_h * 3.5), 180, 8, CATPPUCCIN_BASE);
+            gfx->setCursor(value_x, (int)(start_y + line_h * 3.5));
+            gfx->println(state.mac.c_str());
         }
     }
 
     void drawResourcesPage(const SystemState& state, bool labelsOnly) {
         if (labelsOnly) {
-            gfx.setCursor(start_x, start_y + line_h * 1.5);
-            gfx.setTextColor(CATPPUCCIN_PEACH);
-            gfx.print("CPU:  ");
+            gfx->setCursor(start_x, start_y + line_h * 1.5);
+            gfx->setTextColor(CATPPUCCIN_PEACH);
+            gfx->print("CPU:  ");
 
-            gfx.setCursor(start_x, start_y + line_h * 3.5);
-            gfx.setTextColor(CATPPUCCIN_SAPPHIRE);
-            gfx.print("RAM:  ");
+            gfx->setCursor(start_x, start_y + line_h * 3.5);
+            gfx->setTextColor(CATPPUCCIN_SAPPHIRE);
+            gfx->print("RAM:  ");
         } else {
-            gfx.setTextColor(CATPPUCCIN_TEXT);
+            gfx->setTextColor(CATPPUCCIN_TEXT);
 
             // CPU
-            gfx.fillRect(value_x, (int)(start_y + line_h * 1.5), 100, 8, CATPPUCCIN_BASE);
-            gfx.setCursor(value_x, (int)(start_y + line_h * 1.5));
-            gfx.print(state.cpu_percent, 1);
-            gfx.println("%");
+            gfx->fillRect(value_x, (int)(start_y + line_h * 1.5), 100, 8, CATPPUCCIN_BASE);
+            gfx->setCursor(value_x, (int)(start_y + line_h * 1.5));
+            gfx->print(state.cpu_percent, 1);
+            gfx->println("%");
             uint16_t cpu_col = (state.cpu_percent > 80) ? CATPPUCCIN_RED : (state.cpu_percent > 50) ? CATPPUCCIN_YELLOW : CATPPUCCIN_GREEN;
             drawProgressBar(start_x, start_y + line_h * 2.5, 220, 8, state.cpu_percent, cpu_col);
 
             // RAM
-            gfx.fillRect(value_x, (int)(start_y + line_h * 3.5), 180, 8, CATPPUCCIN_BASE);
-            gfx.setCursor(value_x, (int)(start_y + line_h * 3.5));
-            gfx.printf("%llu / %llu MB", state.ram_used / 1024 / 1024, state.ram_total / 1024 / 1024);
-            float ram_p = (state.ram_total > 0) ? (float)state.ram_used / state.ram_total * 100.0 : 0;
+            gfx->fillRect(value_x, (int)(start_y + line_h * 3.5), 180, 8, CATPPUCCIN_BASE);
+            gfx->setCursor(value_x, (int)(start_y + line_h * 3.5));
+            gfx->printf("%lu / %lu MB", (unsigned long)state.ram_used_mb, (unsigned long)state.ram_total_mb);
+            float ram_p = (state.ram_total_mb > 0) ? (float)state.ram_used_mb / state.ram_total_mb * 100.0 : 0;
             uint16_t ram_col = (ram_p > 80) ? CATPPUCCIN_RED : (ram_p > 50) ? CATPPUCCIN_YELLOW : CATPPUCCIN_GREEN;
             drawProgressBar(start_x, start_y + line_h * 4.5, 220, 8, ram_p, ram_col);
         }
@@ -252,91 +304,91 @@ public:
 
     void drawStatusPage(const SystemState& state, bool labelsOnly) {
         if (labelsOnly) {
-            gfx.setCursor(start_x, start_y + line_h * 1.5);
-            gfx.setTextColor(CATPPUCCIN_TEAL);
-            gfx.print("Disk: ");
+            gfx->setCursor(start_x, start_y + line_h * 1.5);
+            gfx->setTextColor(CATPPUCCIN_TEAL);
+            gfx->print("Disk: ");
 
-            gfx.setCursor(start_x, start_y + line_h * 3.5);
-            gfx.setTextColor(CATPPUCCIN_SUBTEXT0);
-            gfx.print("Uptime: ");
+            gfx->setCursor(start_x, start_y + line_h * 3.5);
+            gfx->setTextColor(CATPPUCCIN_SUBTEXT0);
+            gfx->print("Uptime: ");
         } else {
-            gfx.setTextColor(CATPPUCCIN_TEXT);
+            gfx->setTextColor(CATPPUCCIN_TEXT);
 
             // Disk
-            gfx.fillRect(value_x, (int)(start_y + line_h * 1.5), 180, 8, CATPPUCCIN_BASE);
-            gfx.setCursor(value_x, (int)(start_y + line_h * 1.5));
-            gfx.printf("%llu / %llu GB", state.disk_used / 1024 / 1024 / 1024, state.disk_total / 1024 / 1024 / 1024);
-            float disk_p = (state.disk_total > 0) ? (float)state.disk_used / state.disk_total * 100.0 : 0;
+            gfx->fillRect(value_x, (int)(start_y + line_h * 1.5), 180, 8, CATPPUCCIN_BASE);
+            gfx->setCursor(value_x, (int)(start_y + line_h * 1.5));
+            gfx->printf("%lu / %lu GB", (unsigned long)(state.disk_used_mb / 1024), (unsigned long)(state.disk_total_mb / 1024));
+            float disk_p = (state.disk_total_mb > 0) ? (float)state.disk_used_mb / state.disk_total_mb * 100.0 : 0;
             uint16_t disk_col = (disk_p > 80) ? CATPPUCCIN_RED : (disk_p > 50) ? CATPPUCCIN_YELLOW : CATPPUCCIN_GREEN;
             drawProgressBar(start_x, start_y + line_h * 2.5, 220, 8, disk_p, disk_col);
 
             // Uptime
-            gfx.fillRect(value_x + 20, (int)(start_y + line_h * 3.5), 160, 8, CATPPUCCIN_BASE);
+            gfx->fillRect(value_x + 20, (int)(start_y + line_h * 3.5), 160, 8, CATPPUCCIN_BASE);
             uint32_t h_up = state.uptime / 3600;
             uint32_t m_up = (state.uptime % 3600) / 60;
-            gfx.setCursor(value_x + 20, (int)(start_y + line_h * 3.5));
-            gfx.printf("%luh %lum", (unsigned long)h_up, (unsigned long)m_up);
+            gfx->setCursor(value_x + 20, (int)(start_y + line_h * 3.5));
+            gfx->printf("%luh %lum", (unsigned long)h_up, (unsigned long)m_up);
         }
     }
 
     void drawSDPage(const SystemState& state, bool labelsOnly) {
         if (labelsOnly) {
-            gfx.setCursor(start_x, start_y + line_h * 1.5);
-            gfx.setTextColor(CATPPUCCIN_MAUVE);
-            gfx.print("SD Card:");
+            gfx->setCursor(start_x, start_y + line_h * 1.5);
+            gfx->setTextColor(CATPPUCCIN_MAUVE);
+            gfx->print("SD Card:");
 
-            gfx.setCursor(start_x, start_y + line_h * 3.5);
-            gfx.setTextColor(CATPPUCCIN_YELLOW);
-            gfx.print("Sync:");
+            gfx->setCursor(start_x, start_y + line_h * 3.5);
+            gfx->setTextColor(CATPPUCCIN_YELLOW);
+            gfx->print("Sync:");
         } else {
-            gfx.setTextColor(CATPPUCCIN_TEXT);
+            gfx->setTextColor(CATPPUCCIN_TEXT);
 
             // SD Storage
             uint64_t total = SD.totalBytes();
             uint64_t used = SD.usedBytes();
-            gfx.fillRect(value_x + 20, (int)(start_y + line_h * 1.5), 160, 8, CATPPUCCIN_BASE);
-            gfx.setCursor(value_x + 20, (int)(start_y + line_h * 1.5));
-            gfx.printf("%llu / %llu MB", used / 1024 / 1024, total / 1024 / 1024);
+            gfx->fillRect(value_x + 20, (int)(start_y + line_h * 1.5), 160, 8, CATPPUCCIN_BASE);
+            gfx->setCursor(value_x + 20, (int)(start_y + line_h * 1.5));
+            gfx->printf("%llu / %llu MB", used / 1024 / 1024, total / 1024 / 1024);
             // cppcheck-suppress knownConditionTrueFalse
             float sd_p = (total > 0) ? (float)used / total * 100.0 : 0;
             drawProgressBar(start_x, start_y + line_h * 2.5, 220, 8, sd_p, CATPPUCCIN_MAUVE);
 
             // Sync Status
-            gfx.fillRect(value_x + 10, (int)(start_y + line_h * 3.5), 170, 8, CATPPUCCIN_BASE);
-            gfx.setCursor(value_x + 10, (int)(start_y + line_h * 3.5));
+            gfx->fillRect(value_x + 10, (int)(start_y + line_h * 3.5), 170, 8, CATPPUCCIN_BASE);
+            gfx->setCursor(value_x + 10, (int)(start_y + line_h * 3.5));
             if (state.connected) {
-                gfx.print(state.sd_sync_status);
+                gfx->print(syncStatusLabel(state.sd_sync_status));
             } else {
-                gfx.print("Disconnected");
+                gfx->print("Disconnected");
             }
         }
     }
 
     void drawThermalPage(const SystemState& state, bool labelsOnly) {
         if (labelsOnly) {
-            gfx.setCursor(start_x, start_y + line_h * 1.5);
-            gfx.setTextColor(CATPPUCCIN_RED);
-            gfx.print("Temp: ");
+            gfx->setCursor(start_x, start_y + line_h * 1.5);
+            gfx->setTextColor(CATPPUCCIN_RED);
+            gfx->print("Temp: ");
 
-            gfx.setCursor(start_x, start_y + line_h * 3.5);
-            gfx.setTextColor(CATPPUCCIN_GREEN);
-            gfx.print("GPU:  ");
+            gfx->setCursor(start_x, start_y + line_h * 3.5);
+            gfx->setTextColor(CATPPUCCIN_GREEN);
+            gfx->print("GPU:  ");
         } else {
-            gfx.setTextColor(CATPPUCCIN_TEXT);
+            gfx->setTextColor(CATPPUCCIN_TEXT);
 
             // Thermal
-            gfx.fillRect(value_x, (int)(start_y + line_h * 1.5), 100, 8, CATPPUCCIN_BASE);
-            gfx.setCursor(value_x, (int)(start_y + line_h * 1.5));
-            gfx.print(state.thermal_c, 1);
-            gfx.println(" C");
+            gfx->fillRect(value_x, (int)(start_y + line_h * 1.5), 100, 8, CATPPUCCIN_BASE);
+            gfx->setCursor(value_x, (int)(start_y + line_h * 1.5));
+            gfx->print(state.thermal_c, 1);
+            gfx->println(" C");
             uint16_t temp_col = (state.thermal_c > 80) ? CATPPUCCIN_RED : (state.thermal_c > 65) ? CATPPUCCIN_YELLOW : CATPPUCCIN_GREEN;
             drawProgressBar(start_x, start_y + line_h * 2.5, 220, 8, state.thermal_c, temp_col);
 
             // GPU
-            gfx.fillRect(value_x, (int)(start_y + line_h * 3.5), 100, 8, CATPPUCCIN_BASE);
-            gfx.setCursor(value_x, (int)(start_y + line_h * 3.5));
-            gfx.print(state.gpu_percent, 1);
-            gfx.println("%");
+            gfx->fillRect(value_x, (int)(start_y + line_h * 3.5), 100, 8, CATPPUCCIN_BASE);
+            gfx->setCursor(value_x, (int)(start_y + line_h * 3.5));
+            gfx->print(state.gpu_percent, 1);
+            gfx->println("%");
             uint16_t gpu_col = (state.gpu_percent > 80) ? CATPPUCCIN_RED : (state.gpu_percent > 50) ? CATPPUCCIN_YELLOW : CATPPUCCIN_GREEN;
             drawProgressBar(start_x, start_y + line_h * 4.5, 220, 8, state.gpu_percent, gpu_col);
         }
@@ -344,27 +396,46 @@ public:
 
     void drawNetworkPage(const SystemState& state, bool labelsOnly) {
         if (labelsOnly) {
-            gfx.setCursor(start_x, start_y + line_h * 1.5);
-            gfx.setTextColor(CATPPUCCIN_GREEN);
-            gfx.print("Down:");
+            gfx->setCursor(start_x, start_y + line_h * 1.5);
+            gfx->setTextColor(CATPPUCCIN_GREEN);
+            gfx->print("Down:");
 
-            gfx.setCursor(start_x, start_y + line_h * 4.5);
-            gfx.setTextColor(CATPPUCCIN_MAUVE);
-            gfx.print("Up:");
+            gfx->setCursor(start_x, start_y + line_h * 4.5);
+            gfx->setTextColor(CATPPUCCIN_MAUVE);
+            gfx->print("Up:");
         } else {
-            gfx.setTextColor(CATPPUCCIN_TEXT);
+            gfx->setTextColor(CATPPUCCIN_TEXT);
 
             // Download
-            gfx.fillRect(value_x, (int)(start_y + line_h * 1.5), 180, 8, CATPPUCCIN_BASE);
-            gfx.setCursor(value_x, (int)(start_y + line_h * 1.5));
-            gfx.print(formatSpeed(state.net_down));
-            drawSparkline(start_x, start_y + line_h * 2.5, 220, 20, state.net_down_history, CATPPUCCIN_GREEN);
+            gfx->fillRect(value_x, (int)(start_y + line_h * 1.5), 180, 8, CATPPUCCIN_BASE);
+            gfx->setCursor(value_x, (int)(start_y + line_h * 1.5));
+            gfx->print(formatSpeed(state.net_down));
+            drawNetworkGraph(start_x, start_y + line_h * 2.5, state, _history ? &_history->net_down : nullptr, CATPPUCCIN_GREEN);
 
             // Upload
-            gfx.fillRect(value_x, (int)(start_y + line_h * 4.5), 180, 8, CATPPUCCIN_BASE);
-            gfx.setCursor(value_x, (int)(start_y + line_h * 4.5));
-            gfx.print(formatSpeed(state.net_up));
-            drawSparkline(start_x, start_y + line_h * 5.5, 220, 20, state.net_up_history, CATPPUCCIN_MAUVE);
+            gfx->fillRect(value_x, (int)(start_y + line_h * 4.5), 180, 8, CATPPUCCIN_BASE);
+            gfx->setCursor(value_x, (int)(start_y + line_h * 4.5));
+            gfx->print(formatSpeed(state.net_up));
+            drawNetworkGraph(start_x, start_y + line_h * 5.5, state, _history ? &_history->net_up : nullptr, CATPPUCCIN_MAUVE);
+
+            // Range tag; drawn with the values since the range can change
+            // without the page's static layer changing
+            static const char* const rangeTags[NUM_RANGES] = {"1m", "1h", "24h"};
+            uint8_t range = state.graph_range < NUM_RANGES ? state.graph_range : RANGE_MINUTE;
+            gfx->fillRect(204, (int)(start_y + line_h * 1.5), 18, 8, CATPPUCCIN_BASE);
+            gfx->setTextColor(CATPPUCCIN_SUBTEXT0);
+            gfx->setCursor(204, (int)(start_y + line_h * 1.5));
+            gfx->print(rangeTags[range]);
+        }
+    }
+
+    void drawNetworkGraph(int x, int y, const SystemState& state, const RollupSeries* series, uint16_t color) {
+        GraphRange range = state.graph_range < NUM_RANGES ? (GraphRange)state.graph_range : RANGE_MINUTE;
+        if (series) {
+            drawRollupGraph(x, y, 220, 20, *series, range, color);
+        } else {
+            gfx->drawRect(x, y, 220, 20, CATPPUCCIN_SURFACE0);
+            gfx->fillRect(x + 1, y + 1, 218, 18, CATPPUCCIN_BASE);
         }
     }
 
@@ -374,51 +445,57 @@ public:
         return String(bytesPerSec / (1024.0 * 1024.0), 1) + " MB/s";
     }
 
+    // Page switches blit a cached, RLE-compressed copy of the page background
+    // and labels in one address window instead of clearing and reprinting.
+    // The banner is only cached when it isn't flashing; the WiFi dot is
+    // always drawn live since it changes independently of the page.
     void drawStaticUI(const SystemState& state, Page currentPage, const char* version) {
-        gfx.fillScreen(CATPPUCCIN_BASE);
-        drawBanner("SIDEEYE MONITOR", state.alert_level);
-        drawWiFiStatus();
-
-        gfx.setTextSize(1);
-        
-        gfx.setTextColor(CATPPUCCIN_YELLOW);
-        gfx.setCursor(start_x, start_y);
-        gfx.print("Status:");
+        TRACE_SCOPE(TRACE_DRAW_STATIC, currentPage);
+        bool bannerCached = state.alert_level < 2;
+        uint32_t key = (uint32_t)currentPage | (state.connected ? 0x10 : 0) | ((uint32_t)(bannerCached ? state.alert_level : 3) << 5);
 
-        if (state.connected || currentPage == PAGE_SD) {
-            switch (currentPage) {
-                case PAGE_IDENTITY: if (state.connected) drawIdentityPage(state, true); break;
-                case PAGE_RESOURCES: if (state.connected) drawResourcesPage(state, true); break;
-                case PAGE_STATUS: if (state.connected) drawStatusPage(state, true); break;
-                case PAGE_SD: drawSDPage(state, true); break;
-                case PAGE_THERMAL: if (state.connected) drawThermalPage(state, true); break;
-                case PAGE_NETWORK: if (state.connected) drawNetworkPage(state, true); break;
-                default: break;
+        StaticLayerCache::Layer layer;
+        if (_layers.find(key, layer) || (rasterizeStaticLayer(state, currentPage, version, key) && _layers.find(key, layer))) {
+            blitLayer(layer);
+        } else {
+            if (!_cacheFallbackLogged) {
+                Serial.println("Static layer cache unavailable; drawing pages directly");
+                _cacheFallbackLogged = true;
             }
+            drawStaticLayer(state, currentPage, version);
         }
 
-        // Version back in bottom right corner
-        gfx.setTextColor(CATPPUCCIN_SURFACE1);
-        gfx.setCursor(200, 120);
-        gfx.print(version);
+        if (!bannerCached) {
+            drawBanner("SIDEEYE MONITOR", state.alert_level);
+        }
+        drawWiFiStatus();
+    }
+
+    void invalidateStaticLayers() {
+        _layers.clear();
+    }
+
+    size_t staticLayerCount() const {
+        return _layers.size();
     }
 
     void updateDynamicValues(const SystemState& state, Page currentPage, bool forceRedraw, bool waitingMessageActive, const char* version) {
+        TRACE_SCOPE(TRACE_DRAW_VALUES, currentPage);
         if (forceRedraw || waitingMessageActive) {
             drawStaticUI(state, currentPage, version);
         }
 
-        gfx.setTextSize(1);
+        gfx->setTextSize(1);
 
         // Status value
-        gfx.fillRect(value_x, start_y, 140, 8, CATPPUCCIN_BASE);
-        gfx.setCursor(value_x, start_y);
+        gfx->fillRect(value_x, start_y, 140, 8, CATPPUCCIN_BASE);
+        gfx->setCursor(value_x, start_y);
         if (state.connected) {
-            gfx.setTextColor(CATPPUCCIN_GREEN);
-            gfx.println("Connected");
+            gfx->setTextColor(CATPPUCCIN_GREEN);
+            gfx->println("Connected");
         } else {
-            gfx.setTextColor(CATPPUCCIN_PEACH);
-            gfx.println("Waiting...");
+            gfx->setTextColor(CATPPUCCIN_PEACH);
+            gfx->println("Waiting...");
         }
 
         if (state.connected || currentPage == PAGE_SD) {
@@ -435,7 +512,7 @@ public:
     }
 
     void drawBootScreen(const char* version) {
-        gfx.fillScreen(CATPPUCCIN_BASE);
+        gfx->fillScreen(CATPPUCCIN_BASE);
         drawBanner("BOOTING...");
         
         int16_t x1, y1;
@@ -443,107 +520,195 @@ public:
         int screen_w = 240; // Landscape width
         
         // Draw SideEye name
-        gfx.setTextSize(2);
-        gfx.setTextColor(CATPPUCCIN_MAUVE);
+        gfx->setTextSize(2);
+        gfx->setTextColor(CATPPUCCIN_MAUVE);
         const char* name = "SideEye";
-        gfx.getTextBounds(name, 0, 0, &x1, &y1, &w, &h);
-        gfx.setCursor((screen_w - w) / 2, 55);
-        gfx.println(name);
+        gfx->getTextBounds(name, 0, 0, &x1, &y1, &w, &h);
+        gfx->setCursor((screen_w - w) / 2, 55);
+        gfx->println(name);
         
         // Draw Version
-        gfx.setTextSize(1);
-        gfx.setTextColor(CATPPUCCIN_SUBTEXT0);
+        gfx->setTextSize(1);
+        gfx->setTextColor(CATPPUCCIN_SUBTEXT0);
         char v_str[32];
         snprintf(v_str, sizeof(v_str), "v%s", version);
-        gfx.getTextBounds(v_str, 0, 0, &x1, &y1, &w, &h);
-        gfx.setCursor((screen_w - w) / 2, 85);
-        gfx.println(v_str);
+        gfx->getTextBounds(v_str, 0, 0, &x1, &y1, &w, &h);
+        gfx->setCursor((screen_w - w) / 2, 85);
+        gfx->println(v_str);
     }
 
     void drawConfigMode(const char* apName, const String& ip) {
-        gfx.fillScreen(CATPPUCCIN_BASE);
+        gfx->fillScreen(CATPPUCCIN_BASE);
         drawBanner("SETUP MODE", 1);
         
-        gfx.setTextColor(CATPPUCCIN_TEXT);
-        gfx.setTextSize(1);
-        gfx.setCursor(15, 45);
-        gfx.println("Connect to WiFi AP:");
+        gfx->setTextColor(CATPPUCCIN_TEXT);
+        gfx->setTextSize(1);
+        gfx->setCursor(15, 45);
+        gfx->println("Connect to WiFi AP:");
         
-        gfx.setTextColor(CATPPUCCIN_YELLOW);
-        gfx.setCursor(15, 60);
-        gfx.println(apName);
+        gfx->setTextColor(CATPPUCCIN_YELLOW);
+        gfx->setCursor(15, 60);
+        gfx->println(apName);
         
-        gfx.setTextColor(CATPPUCCIN_TEXT);
-        gfx.setCursor(15, 90);
-        gfx.print("Then visit:");
+        gfx->setTextColor(CATPPUCCIN_TEXT);
+        gfx->setCursor(15, 90);
+        gfx->print("Then visit:");
         
-        gfx.setTextColor(CATPPUCCIN_GREEN);
-        gfx.setCursor(90, 90);
-        gfx.println(ip);
+        gfx->setTextColor(CATPPUCCIN_GREEN);
+        gfx->setCursor(90, 90);
+        gfx->println(ip);
     }
 
     void drawWiFiOnline() {
-        gfx.fillScreen(CATPPUCCIN_BASE);
+        gfx->fillScreen(CATPPUCCIN_BASE);
         drawBanner("CONNECTED");
-        gfx.setCursor(15, start_y);
-        gfx.setTextColor(CATPPUCCIN_GREEN);
-        gfx.println("WiFi Online!");
+        gfx->setCursor(15, start_y);
+        gfx->setTextColor(CATPPUCCIN_GREEN);
+        gfx->println("WiFi Online!");
     }
 
-    void showNotification(const char* message) {
-        // Simple overlay notification
+    // Draws a timed overlay. It stays up until duration_ms has passed, after
+    // which update() reports that the page behind it must be redrawn.
+    void showNotification(const char* message, unsigned long duration_ms = 1500) {
         uint16_t box_w = 200;
         uint16_t box_h = 40;
         uint16_t box_x = (240 - box_w) / 2;
         uint16_t box_y = (135 - box_h) / 2;
 
-        gfx.fillRect(box_x, box_y, box_w, box_h, CATPPUCCIN_SURFACE0);
-        gfx.drawRect(box_x, box_y, box_w, box_h, CATPPUCCIN_MAUVE);
+        gfx->fillRect(box_x, box_y, box_w, box_h, CATPPUCCIN_SURFACE0);
+        gfx->drawRect(box_x, box_y, box_w, box_h, CATPPUCCIN_MAUVE);
         
-        gfx.setTextColor(CATPPUCCIN_TEXT);
-        gfx.setTextSize(1);
+        gfx->setTextColor(CATPPUCCIN_TEXT);
+        gfx->setTextSize(1);
         
         int16_t x1, y1;
         uint16_t w, h;
-        gfx.getTextBounds(message, 0, 0, &x1, &y1, &w, &h);
-        gfx.setCursor(box_x + (box_w - w) / 2, box_y + (box_h - h) / 2);
-        gfx.println(message);
-        
-        delay(1500); // Hold for 1.5s
+        gfx->getTextBounds(message, 0, 0, &x1, &y1, &w, &h);
+        gfx->setCursor(box_x + (box_w - w) / 2, box_y + (box_h - h) / 2);
+        gfx->println(message);
+
+        // Re-arm rather than stack timers when notifications arrive back to back
+        _scheduler.cancel(_notificationTimer);
+        _notificationTimer = _scheduler.schedule(millis(), duration_ms, onNotificationExpired, this);
+        _overlayExpired = false;
+    }
+
+    bool isNotificationActive() const {
+        return _scheduler.isPending(_notificationTimer);
     }
 
     void drawResetScreen(int secondsRemaining, bool forceRedraw = false) {
         if (forceRedraw) {
-            gfx.fillScreen(CATPPUCCIN_BASE);
+            gfx->fillScreen(CATPPUCCIN_BASE);
             drawBanner("FACTORY RESET", 0); // Use alert 0 to avoid banner flashing
             
-            gfx.setTextColor(CATPPUCCIN_TEXT);
-            gfx.setTextSize(1);
-            gfx.setCursor(15, 50);
-            gfx.println("Resetting in:");
+            gfx->setTextColor(CATPPUCCIN_TEXT);
+            gfx->setTextSize(1);
+            gfx->setCursor(15, 50);
+            gfx->println("Resetting in:");
             
-            gfx.setTextColor(CATPPUCCIN_SUBTEXT0);
-            gfx.setTextSize(1);
-            gfx.setCursor(15, 115);
-            gfx.println("Release to cancel");
+            gfx->setTextColor(CATPPUCCIN_SUBTEXT0);
+            gfx->setTextSize(1);
+            gfx->setCursor(15, 115);
+            gfx->println("Release to cancel");
         }
         
         // Clear and update only the number area
-        gfx.fillRect(100, 75, 40, 25, CATPPUCCIN_BASE);
-        gfx.setTextColor(CATPPUCCIN_RED);
-        gfx.setTextSize(3);
-        gfx.setCursor(100, 75);
-        gfx.println(secondsRemaining);
+        gfx->fillRect(100, 75, 40, 25, CATPPUCCIN_BASE);
+        gfx->setTextColor(CATPPUCCIN_RED);
+        gfx->setTextSize(3);
+        gfx->setCursor(100, 75);
+        gfx->println(secondsRemaining);
     }
 
 private:
+    void drawStaticLayer(const SystemState& state, Page currentPage, const char* version) {
+        gfx->fillScreen(CATPPUCCIN_BASE);
+        if (state.alert_level < 2) {
+            drawBanner("SIDEEYE MONITOR", state.alert_level);
+        }
+
+        gfx->setTextSize(1);
+        
+        gfx->setTextColor(CATPPUCCIN_YELLOW);
+        gfx->setCursor(start_x, start_y);
+        gfx->print("Status:");
+
+        if (state.connected || currentPage == PAGE_SD) {
+            switch (currentPage) {
+                case PAGE_IDENTITY: if (state.connected) drawIdentityPage(state, true); break;
+                case PAGE_RESOURCES: if (state.connected) drawResourcesPage(state, true); break;
+                case PAGE_STATUS: if (state.connected) drawStatusPage(state, true); break;
+                case PAGE_SD: drawSDPage(state, true); break;
+                case PAGE_THERMAL: if (state.connected) drawThermalPage(state, true); break;
+                case PAGE_NETWORK: if (state.connected) drawNetworkPage(state, true); break;
+                default: break;
+            }
+        }
+
+        // Version back in bottom right corner
+        gfx->setTextColor(CATPPUCCIN_SURFACE1);
+        gfx->setCursor(200, 120);
+        gfx->print(version);
+    }
+
+    // Draws the static layer off screen and caches the compressed result,
+    // one BandCanvas band at a time, so the only scratch memory is a 7.5 KB
+    // band rather than a 64 KB framebuffer. The layer is drawn once per band,
+    // twice over (build() sizes, then fills). The canvas is unrotated; the
+    // panel applies the current rotation when the layer is blitted, so one
+    // entry serves both.
+    bool rasterizeStaticLayer(const SystemState& state, Page currentPage, const char* version, uint32_t key) {
+        uint16_t* band = static_cast<uint16_t*>(malloc((size_t)SCREEN_W * BandCanvas::ROWS * sizeof(uint16_t)));
+        if (!band) return false;
+        BandCanvas canvas(SCREEN_W, SCREEN_H, band);
+        canvas.begin();
+
+        bool stored = _layers.build(key, [&](StaticLayerCache::RunEncoder& encoder) {
+            for (int16_t top = 0; top < SCREEN_H; top += BandCanvas::ROWS) {
+                int16_t rows = SCREEN_H - top < BandCanvas::ROWS ? SCREEN_H - top : BandCanvas::ROWS;
+                canvas.setBand(top);
+                gfx = &canvas;
+                drawStaticLayer(state, currentPage, version);
+                gfx = &panel;
+                encoder.push(band, (size_t)SCREEN_W * rows);
+            }
+        });
+        free(band);
+        return stored;
+    }
+
+    void blitLayer(const StaticLayerCache::Layer& layer) {
+        panel.startWrite();
+        panel.writeAddrWindow(0, 0, SCREEN_W, SCREEN_H);
+        for (size_t i = 0; i < layer.pairs; i++) {
+            panel.writeRepeat(layer.runs[i * 2 + 1], layer.runs[i * 2]);
+        }
+        panel.endWrite();
+    }
+
+    static void onNotificationExpired(void* ctx) {
+        static_cast<DisplayManager*>(ctx)->_overlayExpired = true;
+    }
+
     Arduino_HWSPI bus;
-    Arduino_ST7789 gfx;
+    Arduino_ST7789 panel;
+    Arduino_GFX* gfx; // Draw target: the panel, or a canvas while caching
+    StaticLayerCache _layers;
+    bool _cacheFallbackLogged = false;
+    const TelemetryHistory* _history = nullptr;
+    static const int16_t SCREEN_W = 240;
+    static const int16_t SCREEN_H = 135;
     int currentRotation = 1;
     const int start_x = 10;
     const int start_y = 30;
     const int line_h = 12;
     const int value_x = 55;
+
+    Tween _backlight;
+    Scheduler<4> _scheduler;
+    int _notificationTimer = Scheduler<4>::INVALID_ID;
+    bool _overlayExpired = false;
 };
 
 #endif
@@ -2,15 +2,64 @@
 #define HISTORY_BUFFER_H
 
 #include <stddef.h>
+#include <stdint.h>
+#include <type_traits>
 
+// Wraps a ring index known to be below 2 * Size. Power-of-two sizes mask;
+// others subtract once, so no access pays for a division.
+template <size_t Size, bool Pow2 = (Size & (Size - 1)) == 0>
+struct HistoryIndex {
+    static size_t wrap(size_t i) { return i >= Size ? i - Size : i; }
+};
+
+template <size_t Size>
+struct HistoryIndex<Size, true> {
+    static size_t wrap(size_t i) { return i & (Size - 1); }
+};
+
+/*
+ * Fixed-size ring of the last Size samples.
+ *
+ * Sliding min and max are kept in monotonic queues of slot indices and the
+ * sum is kept running, so min(), max(), sum() and mean() are O(1) and a push
+ * is O(1) amortized.
+ */
 template <typename T, size_t Size>
 class HistoryBuffer {
+    static_assert(Size > 0 && Size <= 65535, "HistoryBuffer slots are indexed with uint16_t");
+
 public:
+    // Floats accumulate in double; integers in 64 bits of the same signedness
+    typedef typename std::conditional<std::is_floating_point<T>::value, double,
+        typename std::conditional<std::is_signed<T>::value, int64_t, uint64_t>::type>::type SumType;
+
+    // The window as at most two contiguous runs, oldest first.
+    struct Span {
+        const T* first;
+        size_t firstLength;
+        const T* second;
+        size_t secondLength;
+    };
+
     HistoryBuffer() : _head(0), _count(0) {}
 
     void push(T value) {
+        if (_count == Size) {
+            // The oldest sample is about to be overwritten
+            _sum -= _buffer[_head];
+            if (_maxQueue[_maxFront] == _head) popFront(_maxFront, _maxLength);
+            if (_minQueue[_minFront] == _head) popFront(_minFront, _minLength);
+        }
+
+        while (_maxLength > 0 && _buffer[back(_maxQueue, _maxFront, _maxLength)] <= value) _maxLength--;
+        while (_minLength > 0 && _buffer[back(_minQueue, _minFront, _minLength)] >= value) _minLength--;
+
         _buffer[_head] = value;
-        _head = (_head + 1) % Size;
+        _sum += value;
+        pushBack(_maxQueue, _maxFront, _maxLength, _head);
+        pushBack(_minQueue, _minFront, _minLength, _head);
+
+        _head = Index::wrap(_head + 1);
         if (_count < Size) {
             _count++;
         }
@@ -18,10 +67,17 @@ public:
 
     T get(size_t index) const {
         if (index >= _count) return T();
-        size_t pos = (_head + Size - _count + index) % Size;
+        size_t pos = Index::wrap(_head + (Size - _count) + index);
         return _buffer[pos];
     }
 
+    Span spans() const {
+        size_t start = Index::wrap(_head + (Size - _count));
+        size_t firstLength = (start + _count <= Size) ? _count : Size - start;
+        Span span = { _buffer + start, firstLength, _buffer, _count - firstLength };
+        return span;
+    }
+
     size_t count() const {
         return _count;
     }
@@ -32,17 +88,51 @@ public:
 
     T max() const {
         if (_count == 0) return T();
-        T m = _buffer[0];
-        for (size_t i = 1; i < _count; i++) {
-            if (_buffer[i] > m) m = _buffer[i];
-        }
-        return m;
+        return _buffer[_maxQueue[_maxFront]];
+    }
+
+    T min() const {
+        if (_count == 0) return T();
+        return _buffer[_minQueue[_minFront]];
+    }
+
+    SumType sum() const {
+        return _sum;
+    }
+
+    double mean() const {
+        if (_count == 0) return 0;
+        return (double)_sum / _count;
     }
 
 private:
+    typedef HistoryIndex<Size> Index;
+
+    static size_t back(const uint16_t* queue, size_t front, size_t length) {
+        return queue[Index::wrap(front + length - 1)];
+    }
+
+    static void pushBack(uint16_t* queue, size_t front, size_t& length, size_t slot) {
+        queue[Index::wrap(front + length)] = (uint16_t)slot;
+        length++;
+    }
+
+    static void popFront(size_t& front, size_t& length) {
+        front = Index::wrap(front + 1);
+        length--;
+    }
+
     T _buffer[Size] = {};
     size_t _head;
     size_t _count;
+    SumType _sum = 0;
+
+    uint16_t _maxQueue[Size] = {};
+    size_t _maxFront = 0;
+    size_t _maxLength = 0;
+    uint16_t _minQueue[Size] = {};
+    size_t _minFront = 0;
+    size_t _minLength = 0;
 };
 
 #endif
@@ -0,0 +1,171 @@
+#ifndef HISTORY_STORE_H
+#define HISTORY_STORE_H
+
+#include <Arduino.h>
+#include <LittleFS.h>
+#include "Crc32.h"
+#include "TelemetryHistory.h"
+
+/*
+ * Snapshots TelemetryHistory to LittleFS so the graphs survive a reboot.
+ *
+ * Snapshots rotate through SLOTS files, each with a sequence number and a
+ * trailing CRC; restore takes the newest one that verifies. A torn write
+ * costs at most one interval of history, and wear is spread over several
+ * files instead of rewriting one in place. Nothing is written while no new
+ * samples have arrived.
+ *
+ * Layout (little endian): Header, then each series' tiers as written by
+ * RollupTier::save, then CRC-32 of everything before it.
+ */
+class HistoryStore {
+public:
+    static const uint8_t SLOTS = 3;
+    static const uint16_t VERSION = 1;
+    static const uint32_t MAGIC = 0x53484953; // "SIHS"
+
+    explicit HistoryStore(unsigned long interval = 15UL * 60 * 1000) : _interval(interval) {}
+
+    // Call after pushing samples so the next update() has something to save.
+    void markDirty() { _dirty = true; }
+
+    bool update(const TelemetryHistory& history, unsigned long now) {
+        if (!_dirty || now - _lastSave < _interval) return false;
+        return save(history, now);
+    }
+
+    // Saves now if anything changed since the last snapshot (shutdown path).
+    bool flush(const TelemetryHistory& history, unsigned long now) {
+        return _dirty && save(history, now);
+    }
+
+    bool save(const TelemetryHistory& history, unsigned long now) {
+        _lastSave = now; // A failing filesystem is retried next interval, not every loop
+
+        uint32_t sequence = _sequence + 1;
+        char path[20];
+        slotPath(sequence % SLOTS, path, sizeof(path));
+        File file = LittleFS.open(path, "w");
+        if (!file) return false;
+
+        Writer out(file);
+        Header header = { MAGIC, VERSION, TelemetryHistory::SERIES, sequence };
+        out.put(&header, sizeof(header));
+        history.save(out);
+        uint32_t crc = out.crc;
+        out.put(&crc, sizeof(crc));
+        file.close();
+        if (!out.ok) return false;
+
+        _sequence = sequence;
+        _dirty = false;
+        return true;
+    }
+
+    // Loads the newest valid snapshot. Returns false, leaving history empty,
+    // if there is none.
+    bool restore(TelemetryHistory& history, unsigned long now) {
+        if (!LittleFS.begin()) return false;
+
+        bool found = false;
+        uint32_t newest = 0;
+        uint8_t newestSlot = 0;
+        for (uint8_t slot = 0; slot < SLOTS; slot++) {
+            uint32_t sequence;
+            if (verify(slot, sequence) && (!found || (int32_t)(sequence - newest) > 0)) {
+                found = true;
+                newest = sequence;
+                newestSlot = slot;
+            }
+        }
+        if (!found) return false;
+
+        char path[20];
+        slotPath(newestSlot, path, sizeof(path));
+        File file = LittleFS.open(path, "r");
+        Reader in(file);
+        Header header;
+        if (!file || !in.get(&header, sizeof(header)) || !history.load(in, now)) {
+            file.close();
+            history.clear();
+            return false;
+        }
+        file.close();
+
+        _sequence = newest;
+        _lastSave = now;
+        return true;
+    }
+
+    uint32_t sequence() const { return _sequence; }
+
+    static void slotPath(uint8_t slot, char* out, size_t size) {
+        snprintf(out, size, "/history%u.bin", (unsigned)slot);
+    }
+
+private:
+    struct Header {
+        uint32_t magic;
+        uint16_t version;
+        uint16_t series;
+        uint32_t sequence;
+    };
+
+    struct Writer {
+        explicit Writer(File& f) : file(f) {}
+        void put(const void* data, size_t length) {
+            crc = crc32Update(crc, data, length);
+            if (file.write(static_cast<const uint8_t*>(data), length) != length) ok = false;
+        }
+        File& file;
+        uint32_t crc = 0;
+        bool ok = true;
+    };
+
+    struct Reader {
+        explicit Reader(File& f) : file(f) {}
+        bool get(void* data, size_t length) {
+            return file.read(static_cast<uint8_t*>(data), length) == length;
+        }
+        File& file;
+    };
+
+    bool verify(uint8_t slot, uint32_t& sequence) {
+        char path[20];
+        slotPath(slot, path, sizeof(path));
+        if (!LittleFS.exists(path)) return false;
+        File file = LittleFS.open(path, "r");
+        if (!file) return false;
+
+        size_t size = file.size();
+        Header header = { 0, 0, 0, 0 };
+        bool valid = size >= sizeof(header) + sizeof(uint32_t) &&
+            file.read(reinterpret_cast<uint8_t*>(&header), sizeof(header)) == sizeof(header) &&
+            header.magic == MAGIC && header.version == VERSION && header.series == TelemetryHistory::SERIES;
+
+        if (valid) {
+            uint32_t crc = crc32Update(0, &header, sizeof(header));
+            size_t remaining = size - sizeof(header) - sizeof(uint32_t);
+            uint8_t chunk[64];
+            while (valid && remaining > 0) {
+                size_t n = remaining < sizeof(chunk) ? remaining : sizeof(chunk);
+                valid = file.read(chunk, n) == n;
+                crc = crc32Update(crc, chunk, n);
+                remaining -= n;
+            }
+            uint32_t stored = 0;
+            valid = valid && file.read(reinterpret_cast<uint8_t*>(&stored), sizeof(stored)) == sizeof(stored) &&
+                stored == crc;
+        }
+        file.close();
+        sequence = header.sequence;
+        return valid;
+    }
+
+    unsigned long _interval;
+    unsigned long _lastSave = 0;
+    uint32_t _sequence = 0;
+    bool _dirty = false;
+};
+
+#endif
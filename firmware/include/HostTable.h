@@ -0,0 +1,141 @@
+#ifndef HOST_TABLE_H
+#define HOST_TABLE_H
+
+#include <stdint.h>
+#include <string.h>
+#include "DisplayManager.h"
+#include "StaticString.h"
+
+/*
+ * Per-host SystemState slots for machines reporting over UDP.
+ *
+ * Host IDs are hashed into an open-addressed index twice the slot count, so
+ * finding a packet's slot is a hash and, typically, one probe. A new host
+ * takes a free slot or, when full, the one silent longest, provided it has
+ * been silent for at least the expiry time; otherwise it's ignored.
+ */
+class HostTable {
+public:
+    static const uint8_t MAX_HOSTS = 12;
+    static const uint8_t INDEX_SIZE = 32; // Power of two, >= 2 * MAX_HOSTS
+    static const int8_t NONE = -1;
+    typedef StaticString<24> HostId; // Longer IDs are truncated
+
+    explicit HostTable(unsigned long expiry = 10000) : _expiry(expiry) { clear(); }
+
+    void clear() {
+        memset(_index, NONE, sizeof(_index));
+        _count = 0;
+    }
+
+    int8_t find(const char* id) const {
+        HostId key(id);
+        uint32_t hash = hashId(key.c_str());
+        for (uint8_t probe = 0; probe < INDEX_SIZE; probe++) {
+            int8_t slot = _index[(hash + probe) & (INDEX_SIZE - 1)];
+            if (slot == NONE) return NONE;
+            if (_hosts[slot].hash == hash && _hosts[slot].id == key) return slot;
+        }
+        return NONE;
+    }
+
+    // Slot for a packet from `id`, claiming one for a new host if possible.
+    // Marks the host as heard from now.
+    int8_t touch(const char* id, unsigned long now) {
+        if (!id || !*id) return NONE;
+        int8_t slot = find(id);
+        if (slot == NONE) {
+            if (_count < MAX_HOSTS) {
+                slot = _count++;
+            } else {
+                slot = stalest(now);
+                if (slot == NONE) return NONE;
+                _hosts[slot].state = SystemState();
+            }
+            _hosts[slot].id = id;
+            _hosts[slot].hash = hashId(_hosts[slot].id.c_str());
+            reindex();
+        }
+        _hosts[slot].lastSeen = now;
+        _hosts[slot].state.connected = true;
+        return slot;
+    }
+
+    // Marks hosts silent for longer than the expiry time as disconnected
+    void expire(unsigned long now) {
+        for (uint8_t i = 0; i < _count; i++) {
+            if (now - _hosts[i].lastSeen > _expiry) _hosts[i].state.connected = false;
+        }
+    }
+
+    // Next connected slot after `current` (NONE starts from the beginning),
+    // or NONE once the end is reached
+    int8_t nextConnected(int8_t current) const {
+        for (int8_t i = current + 1; i < _count; i++) {
+            if (_hosts[i].state.connected) return i;
+        }
+        return NONE;
+    }
+
+    SystemState& state(uint8_t slot) { return _hosts[slot].state; }
+    const SystemState& state(uint8_t slot) const { return _hosts[slot].state; }
+    const char* id(uint8_t slot) const { return _hosts[slot].id.c_str(); }
+    uint8_t count() const { return _count; }
+
+    // FNV-1a
+    static uint32_t hashId(const char* id) {
+        uint32_t hash = 2166136261u;
+        while (*id) {
+            hash ^= static_cast<uint8_t>(*id++);
+            hash *= 16777619u;
+        }
+        return hash;
+    }
+
+private:
+    struct Host {
+        HostId id;
+        uint32_t hash;
+        unsigned long lastSeen;
+        SystemState state;
+    };
+
+    int8_t stalest(unsigned long now) const {
+        int8_t oldest = NONE;
+        for (uint8_t i = 0; i < _count; i++) {
+            if (now - _hosts[i].lastSeen <= _expiry) continue;
+            if (oldest == NONE || now - _hosts[i].lastSeen > now - _hosts[oldest].lastSeen) oldest = i;
+        }
+        return oldest;
+    }
+
+    // Rebuilt only when the set of hosts changes
+    void reindex() {
+        memset(_index, NONE, sizeof(_index));
+        for (uint8_t i = 0; i < _count; i++) {
+            uint32_t hash = _hosts[i].hash;
+            uint8_t pos = hash & (INDEX_SIZE - 1);
+            while (_index[pos] != NONE) pos = (pos + 1) & (INDEX_SIZE - 1);
+            _index[pos] = i;
+        }
+    }
+
+    Host _hosts[MAX_HOSTS];
+    int8_t _index[INDEX_SIZE];
+    uint8_t _count;
+    unsigned long _expiry;
+};
+
+// Shows a remote host's telemetry with this device's settings
+inline void copySettings(SystemState& to, const SystemState& from) {
+    to.cycle_duration = from.cycle_duration;
+    to.brightness = from.brightness;
+    to.rotation = from.rotation;
+    to.cpu_warning = from.cpu_warning;
+    to.cpu_critical = from.cpu_critical;
+    to.ram_warning = from.ram_warning;
+    to.ram_critical = from.ram_critical;
+    to.graph_range = from.graph_range;
+}
+
+#endif
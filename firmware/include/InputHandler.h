@@ -93,7 +93,7 @@ public:
         _lastActivityTime = millis();
     }
 
-    bool update(SystemState& state, Page& currentPage, unsigned long& lastPageChange, bool& needsStaticDraw, const char* version, bool isConfigMode = false) {
+    bool update(SystemState& state, Page& currentPage, unsigned long& lastPageChange, bool& needsStaticDraw, bool isConfigMode = false) {
         Button::Event ev = _button.update();
         bool resetTriggered = false;
         bool isPressed = _button.isPressed();
@@ -111,8 +111,7 @@ public:
                 if (!isConfigMode) {
                     currentPage = static_cast<Page>((currentPage + 1) % NUM_PAGES);
                     lastPageChange = millis();
-                    needsStaticDraw = true;
-                    _display.updateDynamicValues(state, currentPage, needsStaticDraw, false, version);
+                    needsStaticDraw = true; // Rendered by the loop's render scheduler
                 }
             }
         } else if (ev == Button::DOUBLE_CLICK) {
@@ -121,7 +120,6 @@ public:
             state.rotation = newRotation;
             if (!isConfigMode) {
                 needsStaticDraw = true;
-                _display.updateDynamicValues(state, currentPage, needsStaticDraw, false, version);
             }
         } else if (ev == Button::HOLD) {
             if (!_isScreenOn) {
@@ -0,0 +1,84 @@
+#ifndef JSON_BUFFER_H
+#define JSON_BUFFER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/*
+ * Builds a small JSON document in a fixed char array, for hot paths where
+ * a JsonDocument's heap pool isn't wanted. The caller supplies structure
+ * ("{", ",", "}"); string values are quoted and escaped. Output that doesn't
+ * fit is dropped and ok() turns false, so a truncated document is never
+ * mistaken for a complete one.
+ */
+template <size_t N>
+class JsonBuffer {
+public:
+    JsonBuffer() { clear(); }
+
+    void clear() {
+        _length = 0;
+        _ok = true;
+        _data[0] = '\0';
+    }
+
+    JsonBuffer& raw(const char* s) {
+        while (*s) put(*s++);
+        return *this;
+    }
+
+    // "key":
+    JsonBuffer& key(const char* name) {
+        string(name);
+        put(':');
+        return *this;
+    }
+
+    JsonBuffer& string(const char* s) {
+        put('"');
+        for (; *s; s++) {
+            unsigned char c = static_cast<unsigned char>(*s);
+            if (c == '"' || c == '\\') {
+                put('\\');
+                put(c);
+            } else if (c < 0x20) {
+                char escaped[7];
+                snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+                raw(escaped);
+            } else {
+                put(c);
+            }
+        }
+        put('"');
+        return *this;
+    }
+
+    JsonBuffer& number(long value) {
+        char digits[12];
+        snprintf(digits, sizeof(digits), "%ld", value);
+        return raw(digits);
+    }
+
+    JsonBuffer& boolean(bool value) { return raw(value ? "true" : "false"); }
+
+    const char* c_str() const { return _data; }
+    size_t length() const { return _length; }
+    bool ok() const { return _ok; }
+
+private:
+    void put(char c) {
+        if (_length + 1 < N) {
+            _data[_length++] = c;
+            _data[_length] = '\0';
+        } else {
+            _ok = false;
+        }
+    }
+
+    char _data[N];
+    size_t _length;
+    bool _ok;
+};
+
+#endif
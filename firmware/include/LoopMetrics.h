@@ -0,0 +1,153 @@
+#ifndef LOOP_METRICS_H
+#define LOOP_METRICS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <Esp.h>
+
+// Sections of loop() that are timed separately; STAGE_LOOP is the whole pass
+enum LoopStage : uint8_t {
+    STAGE_INPUT,
+    STAGE_NETWORK,
+    STAGE_BLE,
+    STAGE_UDP,
+    STAGE_SERIAL,
+    STAGE_RENDER,
+    STAGE_LOOP,
+    NUM_LOOP_STAGES
+};
+
+/*
+ * Latency histogram in CPU cycles with log2 buckets: bucket 0 counts zero,
+ * bucket b counts [2^(b-1), 2^b). Recording is a count-leading-zeros and
+ * two increments, so it can sit in the hot path. Percentiles are reported
+ * as the upper edge of their bucket (capped at the max), i.e. within 2x.
+ */
+class LatencyHistogram {
+public:
+    static const uint8_t BUCKETS = 33;
+
+    LatencyHistogram() { clear(); }
+
+    void clear() {
+        for (uint8_t i = 0; i < BUCKETS; i++) _buckets[i] = 0;
+        _count = 0;
+        _max = 0;
+    }
+
+    void record(uint32_t cycles) {
+        _buckets[bucketOf(cycles)]++;
+        _count++;
+        if (cycles > _max) _max = cycles;
+    }
+
+    // Upper bound, in cycles, below which `percent` of samples fall
+    uint32_t percentile(uint8_t percent) const {
+        if (_count == 0) return 0;
+        uint32_t rank = (uint32_t)(((uint64_t)_count * percent + 99) / 100);
+        if (rank == 0) rank = 1;
+        uint32_t seen = 0;
+        for (uint8_t b = 0; b < BUCKETS; b++) {
+            seen += _buckets[b];
+            if (seen >= rank) {
+                uint32_t upper = b == 0 ? 0 : (b == 32 ? 0xFFFFFFFFUL : (1UL << b) - 1);
+                return upper < _max ? upper : _max;
+            }
+        }
+        return _max;
+    }
+
+    uint32_t count() const { return _count; }
+    uint32_t max() const { return _max; }
+    uint32_t bucket(uint8_t b) const { return _buckets[b]; }
+
+    static uint8_t bucketOf(uint32_t cycles) {
+        return cycles == 0 ? 0 : 32 - __builtin_clz(cycles);
+    }
+
+private:
+    uint32_t _buckets[BUCKETS];
+    uint32_t _count;
+    uint32_t _max;
+};
+
+/*
+ * One histogram per loop stage. Reported over serial by GetMetrics:
+ * {"type":"Metrics","data":{"cpu_mhz":160,"stages":{"input":{"count":9120,
+ *  "p50_us":3,"p99_us":12,"max_us":40,"buckets":[0,0,...]},...}}}
+ * where buckets are the raw log2 cycle counts, trailing zeros trimmed.
+ */
+class LoopMetrics {
+public:
+    explicit LoopMetrics(uint32_t cpuMhz = 160) : _cpuMhz(cpuMhz ? cpuMhz : 1) {}
+
+    void setCpuMhz(uint32_t mhz) { _cpuMhz = mhz ? mhz : 1; }
+    uint32_t cpuMhz() const { return _cpuMhz; }
+
+    void record(LoopStage stage, uint32_t cycles) { _stages[stage].record(cycles); }
+    const LatencyHistogram& stage(LoopStage stage) const { return _stages[stage]; }
+    uint32_t toMicros(uint32_t cycles) const { return cycles / _cpuMhz; }
+
+    void clear() {
+        for (uint8_t i = 0; i < NUM_LOOP_STAGES; i++) _stages[i].clear();
+    }
+
+    static const char* stageName(LoopStage stage) {
+        static const char* const names[NUM_LOOP_STAGES] = {
+            "input", "network", "ble", "udp", "serial", "render", "loop"
+        };
+        return names[stage];
+    }
+
+    template <typename Out>
+    void write(Out& out) const {
+        char chunk[96];
+        snprintf(chunk, sizeof(chunk), "{\"type\":\"Metrics\",\"data\":{\"cpu_mhz\":%lu,\"stages\":{",
+                 (unsigned long)_cpuMhz);
+        out.print(chunk);
+        for (uint8_t i = 0; i < NUM_LOOP_STAGES; i++) {
+            const LatencyHistogram& h = _stages[i];
+            snprintf(chunk, sizeof(chunk), "%s\"%s\":{\"count\":%lu,\"p50_us\":%lu,\"p99_us\":%lu,\"max_us\":%lu,\"buckets\":[",
+                     i > 0 ? "," : "", stageName(static_cast<LoopStage>(i)), (unsigned long)h.count(),
+                     (unsigned long)toMicros(h.percentile(50)), (unsigned long)toMicros(h.percentile(99)),
+                     (unsigned long)toMicros(h.max()));
+            out.print(chunk);
+
+            uint8_t used = LatencyHistogram::BUCKETS;
+            while (used > 0 && h.bucket(used - 1) == 0) used--;
+            for (uint8_t b = 0; b < used; b++) {
+                snprintf(chunk, sizeof(chunk), b > 0 ? ",%lu" : "%lu", (unsigned long)h.bucket(b));
+                out.print(chunk);
+            }
+            out.print("]}");
+        }
+        out.print("}}}\n");
+    }
+
+private:
+    LatencyHistogram _stages[NUM_LOOP_STAGES];
+    uint32_t _cpuMhz;
+};
+
+// Times the rest of the enclosing scope into a LoopMetrics stage
+class StageTimer {
+public:
+    StageTimer(LoopMetrics& metrics, LoopStage stage)
+        : _metrics(metrics), _stage(stage), _start(ESP.getCycleCount()) {}
+    ~StageTimer() { _metrics.record(_stage, ESP.getCycleCount() - _start); }
+
+private:
+    LoopMetrics& _metrics;
+    LoopStage _stage;
+    uint32_t _start;
+};
+
+// Instrumentation compiles to nothing unless SIDEEYE_LOOP_METRICS is defined
+#ifdef SIDEEYE_LOOP_METRICS
+#define LOOP_STAGE(metrics, stage) StageTimer loopStageTimer_((metrics), (stage))
+#else
+#define LOOP_STAGE(metrics, stage) do {} while (0)
+#endif
+
+#endif
@@ -4,18 +4,103 @@
 #include <Arduino.h>
 #include <WiFiManager.h>
 #include <PubSubClient.h>
+#include <WiFiUdp.h>
 #include <LittleFS.h>
 #include <ArduinoJson.h>
 #include <esp_mac.h>
+#include <lwip/dns.h>
+#include <lwip/tcpip.h>
+#include <atomic>
 #include "DisplayManager.h"
 #include "BLEPresenceManager.h"
+#include "JsonBuffer.h"
+#include "PublishQueue.h"
+#include "Crc32.h"
+#include "ConfigStore.h"
+#include "HostTable.h"
+#include "TelemetryFrame.h"
+#include "LoopMetrics.h"
+#include "Trace.h"
 
 #if __has_include("secrets.h")
 #include "secrets.h"
 #endif
 
+// Every topic the device publishes or subscribes to, built once per
+// connection so publishing never concatenates strings.
+enum MqttTopic : uint8_t {
+    TOPIC_STATE,
+    TOPIC_BRIGHTNESS,
+    TOPIC_ROTATION,
+    TOPIC_CYCLE_DURATION,
+    TOPIC_CPU_WARNING,
+    TOPIC_CPU_CRITICAL,
+    TOPIC_RAM_WARNING,
+    TOPIC_RAM_CRITICAL,
+    TOPIC_GRAPH_RANGE,
+    TOPIC_BLE_STATUS,
+    TOPIC_PRESENCE,
+    TOPIC_BOOT_PROFILE,
+    TOPIC_METRICS,
+    TOPIC_STATUS,
+    TOPIC_SET,
+    NUM_TOPICS
+};
+
+// Only these two are never queued; QUEUE_SLOTS counts on them being last
+static_assert(TOPIC_STATUS == NUM_TOPICS - 2 && TOPIC_SET == NUM_TOPICS - 1,
+              "Queued topics must come before TOPIC_STATUS and TOPIC_SET");
+
+// WiFi bring-up, run from update() so the display works while it happens
+enum WifiPhase : uint8_t {
+    WIFI_IDLE,    // begin() not called yet
+    WIFI_JOINING, // Saved network, for up to WIFI_JOIN_TIMEOUT_MS
+    WIFI_PORTAL,  // Config portal open until credentials are saved
+    WIFI_UP
+};
+
+// Broker connection progress. update() advances at most one step per call,
+// so no single loop() iteration waits on more than one network operation.
+enum MqttPhase : uint8_t {
+    MQTT_BACKOFF,   // Waiting for the next attempt
+    MQTT_RESOLVE,   // Broker name to IP, polled until lwIP answers
+    MQTT_TCP,       // TCP connect, bounded by STEP_BUDGET_MS
+    MQTT_HANDSHAKE, // MQTT CONNECT/CONNACK, bounded by the socket timeout
+    MQTT_SUBSCRIBE,
+    MQTT_DISCOVERY,
+    MQTT_CONNECTED
+};
+
 class SideEyeNetworkManager {
 public:
+    // Longest is prefix (39) + "/" + device ID + "/state/cycle_duration"
+    static const size_t TOPIC_SIZE = 96;
+
+    // UDP port for telemetry from other machines, and the largest frame
+    // accepted (same as a serial line)
+    static const uint16_t TELEMETRY_PORT = 47800;
+    static const size_t TELEMETRY_FRAME_SIZE = 512;
+
+    // Time to join the saved network before the config portal opens
+    static const unsigned long WIFI_JOIN_TIMEOUT_MS = 20000;
+
+    // Upper bound on the blocking part of any one connection step
+    static const uint16_t STEP_BUDGET_MS = 1000;
+    // Retry delays double from BACKOFF_BASE_MS up to BACKOFF_MAX_MS; each
+    // wait is drawn from the upper half of the current delay
+    static const unsigned long BACKOFF_BASE_MS = 2000;
+    static const unsigned long BACKOFF_MAX_MS = 5UL * 60 * 1000;
+
+    // Outbound publishes held while the broker is away. One slot per topic
+    // that can be queued, so nothing is ever evicted (and the retained boot
+    // profile never lost); payloads fit the state document.
+    static const uint8_t QUEUE_SLOTS = NUM_TOPICS - 2;
+    static const size_t QUEUE_PAYLOAD_SIZE = 384;
+    typedef PublishQueue<QUEUE_SLOTS, QUEUE_PAYLOAD_SIZE> OutboundQueue;
+    // Default drain rate: DRAIN_BURST publishes per DRAIN_INTERVAL_MS
+    static const uint8_t DRAIN_BURST = 4;
+    static const unsigned long DRAIN_INTERVAL_MS = 100;
+
     friend class NetworkManagerTest;
     SideEyeNetworkManager() : _mqttClient(_espClient) {
 #ifdef MQTT_HOST
@@ -39,11 +124,14 @@ public:
         _deviceID = deviceID;
         _version = version;
 
-        // ... (LittleFS code) ...
         if (LittleFS.begin()) {
             Serial.println("mounted file system");
-            if (LittleFS.exists("/config.json")) {
-                Serial.println("reading config file");
+            ConfigData config;
+            if (_config.load(config)) {
+                applyConfig(config, state);
+            } else if (LittleFS.exists("/config.json")) {
+                // Pre-binary config: read once, then replaced by a record
+                Serial.println("migrating config file");
                 File configFile = LittleFS.open("/config.json", "r");
                 if (configFile) {
                     JsonDocument json;
@@ -63,93 +151,165 @@ public:
                         state.cpu_critical = json["cpu_critical"] | 80;
                         state.ram_warning = json["ram_warning"] | 50;
                         state.ram_critical = json["ram_critical"] | 80;
+                        state.graph_range = json["graph_range"] | 0;
                     }
                     configFile.close();
+                    if (!error) {
+                        _config.request(currentConfig(state), millis());
+                        if (_config.flush()) LittleFS.remove("/config.json");
+                    }
                 }
             }
         }
 
-        WiFiManager wm;
-        wm.setSaveConfigCallback(saveCallback);
-        wm.setAPCallback(configCallback);
-        wm.setWebServerCallback(webServerCallback);
-
+        _wm.setSaveConfigCallback(saveCallback);
+        _wm.setAPCallback(configCallback);
+        _wm.setWebServerCallback(webServerCallback);
+        _wm.setConfigPortalBlocking(false);
+
+        _serverParam.setValue(mqtt_server, sizeof(mqtt_server));
+        _portParam.setValue(mqtt_port, sizeof(mqtt_port));
+        _userParam.setValue(mqtt_user, sizeof(mqtt_user));
+        _passParam.setValue(mqtt_pass, sizeof(mqtt_pass));
+        _prefixParam.setValue(mqtt_topic_prefix, sizeof(mqtt_topic_prefix));
+        _discoveryParam.setValue(mqtt_discovery_prefix, sizeof(mqtt_discovery_prefix));
+        _wm.addParameter(&_serverParam);
+        _wm.addParameter(&_portParam);
+        _wm.addParameter(&_userParam);
+        _wm.addParameter(&_passParam);
+        _wm.addParameter(&_prefixParam);
+        _wm.addParameter(&_discoveryParam);
+
+        // Seeded per device so a rack of displays doesn't retry in lockstep
+        _jitter = crc32Update((uint32_t)millis(), _deviceID.c_str(), _deviceID.length()) | 1;
+        _mqttClient.setSocketTimeout((STEP_BUDGET_MS + 999) / 1000);
+
+        // Joining carries on in the background; update() opens the config
+        // portal if it doesn't succeed in time
+        WiFi.mode(WIFI_STA);
+        setWifiPhase(WIFI_JOINING);
+        _wifiStarted = millis();
+        if (_wm.getWiFiIsSaved()) {
+            WiFi.begin();
+        } else {
 #if defined(WIFI_SSID) && defined(WIFI_PASSWORD)
-        wm.preloadWiFi(WIFI_SSID, WIFI_PASSWORD);
+            WiFi.begin(WIFI_SSID, WIFI_PASSWORD);
+#else
+            startPortal();
 #endif
+        }
+    }
 
-        WiFiManagerParameter custom_mqtt_server("server", "mqtt server", mqtt_server, 40);
-        WiFiManagerParameter custom_mqtt_port("port", "mqtt port", mqtt_port, 6);
-        WiFiManagerParameter custom_mqtt_user("user", "mqtt user", mqtt_user, 40);
-        WiFiManagerParameter custom_mqtt_pass("pass", "mqtt pass", mqtt_pass, 40);
-        WiFiManagerParameter custom_mqtt_topic_prefix("prefix", "topic prefix", mqtt_topic_prefix, 40);
-        WiFiManagerParameter custom_mqtt_discovery_prefix("discovery", "discovery prefix", mqtt_discovery_prefix, 40);
+    // Schedules the settings to be stored; the write itself happens from
+    // update() once changes settle, and only if they differ from the record
+    void saveConfig(const SystemState& state, bool shouldSave) {
+        if (shouldSave) _config.request(currentConfig(state), millis());
+    }
 
-        wm.addParameter(&custom_mqtt_server);
-        wm.addParameter(&custom_mqtt_port);
-        wm.addParameter(&custom_mqtt_user);
-        wm.addParameter(&custom_mqtt_pass);
-        wm.addParameter(&custom_mqtt_topic_prefix);
-        wm.addParameter(&custom_mqtt_discovery_prefix);
+    // Writes settings still waiting out the debounce (shutdown path)
+    bool flushConfig() { return _config.flush(); }
 
-        String apName = "SideEye-" + _deviceID;
-        if (!wm.autoConnect(apName.c_str())) {
-            ESP.restart();
-            delay(1000);
-        }
-
-        strcpy(mqtt_server, custom_mqtt_server.getValue());
-        strcpy(mqtt_port, custom_mqtt_port.getValue());
-        strcpy(mqtt_user, custom_mqtt_user.getValue());
-        strcpy(mqtt_pass, custom_mqtt_pass.getValue());
-        strcpy(mqtt_topic_prefix, custom_mqtt_topic_prefix.getValue());
-        strcpy(mqtt_discovery_prefix, custom_mqtt_discovery_prefix.getValue());
+    // Drives the broker connection; call every loop()
+    void update() {
+        unsigned long now = millis();
+        if (_config.update(now)) Serial.println("config saved");
+        if (!updateWiFi(now) || strlen(mqtt_server) == 0) return;
 
-        if (strlen(mqtt_server) > 0) {
-            _mqttClient.setServer(mqtt_server, atoi(mqtt_port));
+        switch (_phase) {
+            case MQTT_BACKOFF:
+                if ((long)(now - _nextAttempt) >= 0) {
+                    buildTopics();
+                    setPhase(MQTT_RESOLVE);
+                }
+                break;
+            case MQTT_RESOLVE:
+                // IP literals skip DNS; a resolved name is reused until a TCP
+                // connect to it fails
+                if (!_brokerResolved && !_brokerIP.fromString(mqtt_server)) {
+                    DnsLookup lookup = resolveBroker();
+                    if (lookup == LOOKUP_PENDING) break;
+                    if (lookup == LOOKUP_FAILED) {
+                        retryLater(now);
+                        break;
+                    }
+                }
+                _brokerResolved = true;
+                _mqttClient.setServer(_brokerIP, atoi(mqtt_port));
+                setPhase(MQTT_TCP);
+                break;
+            case MQTT_TCP:
+                if (_espClient.connect(_brokerIP, atoi(mqtt_port), STEP_BUDGET_MS)) {
+                    setPhase(MQTT_HANDSHAKE);
+                } else {
+                    _brokerResolved = false;
+                    retryLater(now);
+                }
+                break;
+            case MQTT_HANDSHAKE:
+                // PubSubClient reuses the already-open socket
+                if (mqttHandshake()) {
+                    setPhase(MQTT_SUBSCRIBE);
+                } else {
+                    retryLater(now);
+                }
+                break;
+            case MQTT_SUBSCRIBE:
+                mqttSubscribe();
+                setPhase(MQTT_DISCOVERY);
+                break;
+            case MQTT_DISCOVERY:
+                publishHADiscovery();
+                _attempts = 0;
+                setPhase(MQTT_CONNECTED);
+                break;
+            case MQTT_CONNECTED:
+                break;
         }
-    }
 
-    void saveConfig(const SystemState& state, bool shouldSave) {
-        if (shouldSave) {
-            Serial.println("saving config");
-            JsonDocument json;
-            json["mqtt_server"] = mqtt_server;
-            json["mqtt_port"] = mqtt_port;
-            json["mqtt_user"] = mqtt_user;
-            json["mqtt_pass"] = mqtt_pass;
-            json["mqtt_topic_prefix"] = mqtt_topic_prefix;
-            json["mqtt_discovery_prefix"] = mqtt_discovery_prefix;
-
-            json["brightness"] = state.brightness;
-            json["rotation"] = state.rotation;
-            json["cycle_duration"] = state.cycle_duration;
-            json["cpu_warning"] = state.cpu_warning;
-            json["cpu_critical"] = state.cpu_critical;
-            json["ram_warning"] = state.ram_warning;
-            json["ram_critical"] = state.ram_critical;
-
-            File configFile = LittleFS.open("/config.json", "w");
-            if (configFile) {
-                serializeJson(json, configFile);
-                configFile.close();
+        if (_phase >= MQTT_SUBSCRIBE) {
+            if (_mqttClient.connected()) {
+                _mqttClient.loop();
+                drainQueue(now);
+            } else {
+                Serial.println("MQTT connection lost");
+                retryLater(now);
             }
         }
     }
 
-    void update(unsigned long& lastMqttRetry) {
-        if (strlen(mqtt_server) > 0) {
-            if (!_mqttClient.connected()) {
-                unsigned long now = millis();
-                if (now - lastMqttRetry > 5000) {
-                    lastMqttRetry = now;
-                    reconnectMQTT();
-                }
+    // Applies up to maxPackets queued UDP frames to their hosts' slots and
+    // returns how many were applied. Frames are the serial Identity/Stats
+    // messages plus a "host" ID: {"type":"Stats","host":"rack1-a","data":{...}}
+    uint8_t pollTelemetry(HostTable& hosts, unsigned long now, uint8_t maxPackets = 4) {
+        if (!_udpListening) return 0;
+        uint8_t applied = 0;
+        for (uint8_t i = 0; i < maxPackets; i++) {
+            int size = _udp.parsePacket();
+            if (size <= 0) break;
+            if ((size_t)size >= TELEMETRY_FRAME_SIZE) {
+                _udp.flush();
+                continue;
             }
-            _mqttClient.loop();
+
+            char frame[TELEMETRY_FRAME_SIZE];
+            int length = _udp.read(frame, sizeof(frame) - 1);
+            JsonDocument doc;
+            if (length <= 0 || deserializeJson(doc, frame, (size_t)length)) continue;
+
+            const char* type = doc["type"];
+            if (!type || (strcmp(type, "Identity") != 0 && strcmp(type, "Stats") != 0)) continue;
+            int8_t slot = hosts.touch(doc["host"].as<const char*>(), now);
+            if (slot == HostTable::NONE) continue;
+            applyTelemetry(hosts.state(slot), type, doc["data"]);
+            applied++;
         }
+        return applied;
     }
 
+    WifiPhase wifiPhase() const { return _wifiPhase; }
+    MqttPhase mqttPhase() const { return _phase; }
+    unsigned long nextAttempt() const { return _nextAttempt; }
+
     void setCallback(std::function<void(char*, uint8_t*, unsigned int)> callback) {
         _mqttClient.setCallback(callback);
     }
@@ -158,138 +318,163 @@ public:
         strncpy(mqtt_discovery_prefix, prefix.c_str(), sizeof(mqtt_discovery_prefix) - 1);
     }
 
+    // Publishes whatever changed since the last call: each topic's last sent
+    // value is remembered and unchanged ones are skipped. RSSI alone only
+    // republishes the state document once per RSSI interval; everything is
+    // resent after a reconnect. Allocation-free: topics come from the table
+    // built on connect and payloads are formatted on the stack.
+    //
+    // Changes go through the outbound queue, so ones made while the broker
+    // is unreachable are kept (latest value per topic) and sent, rate
+    // limited, once it's back.
     void publishState(const SystemState& state, const BLEPresenceManager& ble) {
-        if (!_mqttClient.connected()) return;
-
-        String stateTopic = String(mqtt_topic_prefix) + "/" + _deviceID + "/state";
-        JsonDocument doc;
-        doc["hostname"] = state.hostname;
-        doc["ip"] = state.ip;
-        doc["mac"] = state.mac;
-        doc["rssi"] = WiFi.RSSI();
-        doc["ble_status"] = ble.getStatusString();
-        doc["ble_present"] = ble.isPresent();
-
-        String payload;
-        serializeJson(doc, payload);
-        _mqttClient.publish(stateTopic.c_str(), payload.c_str());
+        unsigned long now = millis();
+        int rssi = WiFi.RSSI();
+        const char* bleStatus = ble.getStatusString();
+        bool present = ble.isPresent();
+
+        uint32_t identity = crc32Update(0, state.hostname.c_str(), state.hostname.length() + 1);
+        identity = crc32Update(identity, state.ip.c_str(), state.ip.length() + 1);
+        identity = crc32Update(identity, state.mac.c_str(), state.mac.length() + 1);
+        identity = crc32Update(identity, bleStatus, strlen(bleStatus) + 1);
+        identity = crc32Update(identity, &present, sizeof(present));
+
+        bool rssiDue = rssi != _lastRssi && now - _lastRssiPublish >= _rssiInterval;
+        if (changed(TOPIC_STATE, identity) || rssiDue) {
+            JsonBuffer<QUEUE_PAYLOAD_SIZE> doc;
+            doc.raw("{").key("hostname").string(state.hostname.c_str());
+            doc.raw(",").key("ip").string(state.ip.c_str());
+            doc.raw(",").key("mac").string(state.mac.c_str());
+            doc.raw(",").key("rssi").number(rssi);
+            doc.raw(",").key("ble_status").string(bleStatus);
+            doc.raw(",").key("ble_present").boolean(present);
+            doc.raw("}");
+            if (doc.ok() && enqueue(TOPIC_STATE, doc.c_str(), false)) {
+                markPublished(TOPIC_STATE, identity);
+                _lastRssi = rssi;
+                _lastRssiPublish = now;
+            }
+        }
 
         // Publish individual states for HA compatibility
-        _mqttClient.publish((stateTopic + "/brightness").c_str(), String(state.brightness).c_str(), true);
-        _mqttClient.publish((stateTopic + "/rotation").c_str(), String(state.rotation).c_str(), true);
-        _mqttClient.publish((stateTopic + "/cycle_duration").c_str(), String(state.cycle_duration).c_str(), true);
-        _mqttClient.publish((stateTopic + "/cpu_warning").c_str(), String(state.cpu_warning).c_str(), true);
-        _mqttClient.publish((stateTopic + "/cpu_critical").c_str(), String(state.cpu_critical).c_str(), true);
-        _mqttClient.publish((stateTopic + "/ram_warning").c_str(), String(state.ram_warning).c_str(), true);
-        _mqttClient.publish((stateTopic + "/ram_critical").c_str(), String(state.ram_critical).c_str(), true);
-        _mqttClient.publish((stateTopic + "/ble_status").c_str(), ble.getStatusString(), true);
-        _mqttClient.publish((stateTopic + "/presence").c_str(), ble.isPresent() ? "present" : "away", true);
+        publishValue(TOPIC_BRIGHTNESS, state.brightness);
+        publishValue(TOPIC_ROTATION, state.rotation);
+        publishValue(TOPIC_CYCLE_DURATION, state.cycle_duration);
+        publishValue(TOPIC_CPU_WARNING, state.cpu_warning);
+        publishValue(TOPIC_CPU_CRITICAL, state.cpu_critical);
+        publishValue(TOPIC_RAM_WARNING, state.ram_warning);
+        publishValue(TOPIC_RAM_CRITICAL, state.ram_critical);
+        publishValue(TOPIC_GRAPH_RANGE, state.graph_range);
+        publishString(TOPIC_BLE_STATUS, bleStatus);
+        publishString(TOPIC_PRESENCE, present ? "present" : "away");
+
+        drainQueue(now);
     }
 
-    void reconnectMQTT() {
-        String clientId = "SideEye-" + _deviceID;
-        String statusTopic = String(mqtt_topic_prefix) + "/" + _deviceID + "/status";
-        
-        bool connected = false;
-        if (strlen(mqtt_user) > 0) {
-            connected = _mqttClient.connect(clientId.c_str(), mqtt_user, mqtt_pass, statusTopic.c_str(), 1, true, "offline");
-        } else {
-            connected = _mqttClient.connect(clientId.c_str(), statusTopic.c_str(), 1, true, "offline");
-        }
+    // Sends queued publishes while connected, at most `burst` per `interval`
+    // ms, so a reconnect doesn't flush everything at once
+    void setDrainRate(uint8_t burst, unsigned long interval) {
+        _drainBurst = burst;
+        _drainInterval = interval;
+    }
 
-        if (connected) {
-            Serial.println("MQTT connected");
-            _mqttClient.publish(statusTopic.c_str(), "online", true);
-            
-            // Subscribe to all setting topics for this device
-            String setTopic = String(mqtt_topic_prefix) + "/" + _deviceID + "/set/#";
-            _mqttClient.subscribe(setTopic.c_str());
-            Serial.println("Subscribed to " + setTopic);
+    const OutboundQueue::Counters& queueCounters() const { return _queue.counters(); }
+    uint8_t queuedPublishes() const { return _queue.size(); }
 
-            publishHADiscovery();
-        } else {
-            Serial.print("failed, rc=");
-            Serial.print(_mqttClient.state());
+    // Queues this boot's timing report (retained, so the last boot's stays
+    // visible); it goes out with the state once the broker is connected
+    bool publishBootProfile(const char* json) {
+        if (!enqueue(TOPIC_BOOT_PROFILE, json, true)) return false;
+        drainQueue(millis());
+        return true;
+    }
+
+    // Queues each loop stage's p99 and max, in microseconds, for the Home
+    // Assistant loop timing sensors: {"input_p99":12,"input_max":40,...}
+    bool publishMetrics(const LoopMetrics& metrics) {
+        JsonBuffer<QUEUE_PAYLOAD_SIZE> doc;
+        doc.raw("{");
+        for (uint8_t i = 0; i < NUM_LOOP_STAGES; i++) {
+            LoopStage stage = static_cast<LoopStage>(i);
+            char key[24];
+            if (i > 0) doc.raw(",");
+            snprintf(key, sizeof(key), "%s_p99", LoopMetrics::stageName(stage));
+            doc.key(key).number(metrics.toMicros(metrics.stage(stage).percentile(99)));
+            snprintf(key, sizeof(key), "%s_max", LoopMetrics::stageName(stage));
+            doc.raw(",").key(key).number(metrics.toMicros(metrics.stage(stage).max()));
         }
+        doc.raw("}");
+        if (!doc.ok() || !enqueue(TOPIC_METRICS, doc.c_str(), false)) return false;
+        drainQueue(millis());
+        return true;
     }
 
-    void publishHADiscovery() {
-        String baseTopic = String(mqtt_topic_prefix) + "/" + _deviceID;
-        String discoveryPrefix = String(mqtt_discovery_prefix) + "/sensor/side_eye_" + _deviceID;
-        
-        struct Sensor {
-            const char* name;
-            const char* key;
-            const char* icon;
-        };
+    // Minimum time between state publishes caused only by RSSI drifting
+    void setRssiInterval(unsigned long interval) { _rssiInterval = interval; }
 
-        static const Sensor sensors[] = {
-            {"Hostname", "hostname", "mdi:label"},
-            {"IP Address", "ip", "mdi:ip-network"},
-            {"MAC Address", "mac", "mdi:ethernet"},
-            {"WiFi RSSI", "rssi", "mdi:wifi"},
-            {"BLE Status", "ble_status", "mdi:bluetooth"}
+    // Forgets what was sent, so the next publishState sends every topic
+    void requestFullRefresh() { _publishedMask = 0; }
+
+    const char* topic(MqttTopic t) const { return _topics[t]; }
+
+    // Rebuilds the topic table from the current prefix and device ID
+    void buildTopics() {
+        static const char* const suffixes[NUM_TOPICS] = {
+            "/state", "/state/brightness", "/state/rotation", "/state/cycle_duration",
+            "/state/cpu_warning", "/state/cpu_critical", "/state/ram_warning", "/state/ram_critical",
+            "/state/graph_range", "/state/ble_status", "/state/presence", "/boot_profile",
+            "/metrics", "/status", "/set/#"
         };
+        for (uint8_t i = 0; i < NUM_TOPICS; i++) {
+            snprintf(_topics[i], TOPIC_SIZE, "%s/%s%s", mqtt_topic_prefix, _deviceID.c_str(), suffixes[i]);
+        }
+    }
 
-        for (const auto& s : sensors) {
-            JsonDocument doc;
-            doc["name"] = String("SideEye ") + _deviceID + " " + s.name;
-            doc["state_topic"] = baseTopic + "/state";
-            doc["value_template"] = String("{{ value_json.") + s.key + " }}";
-            doc["unique_id"] = String("side_eye_") + _deviceID + "_" + s.key;
-            doc["icon"] = s.icon;
-            
-            JsonObject dev = doc["device"].to<JsonObject>();
-            dev["identifiers"][0] = String("side_eye_") + _deviceID;
-            dev["name"] = String("SideEye ") + _deviceID;
-            dev["model"] = "ESP32-C6 GEEK";
-            dev["manufacturer"] = "Waveshare";
-            dev["sw_version"] = _version;
-
-            String topic = discoveryPrefix + "_" + s.key + "/config";
-            String payload;
-            serializeJson(doc, payload);
-            _mqttClient.publish(topic.c_str(), payload.c_str(), true);
+    // Runs the whole connect sequence at once, blocking until it finishes.
+    // update() does the same work one step per loop.
+    void reconnectMQTT() {
+        buildTopics();
+        if (!mqttHandshake()) return;
+        mqttSubscribe();
+        publishHADiscovery();
+        _attempts = 0;
+        setPhase(MQTT_CONNECTED);
+    }
+
+    // Publishes the Home Assistant discovery configs, unless the exact same
+    // set was already published since boot. Payloads are expanded from
+    // templates and streamed, so neither the heap nor PubSubClient's buffer
+    // ever holds a whole document. Returns true if anything was sent.
+    bool publishHADiscovery() {
+        uint32_t hash = discoveryHash();
+        if (_discoveryPublished && hash == _discoveryHash) return false;
+        TRACE_SCOPE(TRACE_DISCOVERY, DISCOVERY_COUNT);
+
+        bool ok = true;
+        const DiscoveryEntry* entries = discoveryEntries();
+        for (size_t i = 0; i < DISCOVERY_COUNT; i++) {
+            const DiscoveryEntry& entry = entries[i];
+            char topic[TOPIC_SIZE + 32];
+            discoveryTopic(entry, topic, sizeof(topic));
+            LengthSink length;
+            expandTemplate(entry.payload, length);
+
+            MqttSink out(_mqttClient);
+            ok = _mqttClient.beginPublish(topic, length.length, true) && ok;
+            expandTemplate(entry.payload, out);
+            ok = _mqttClient.endPublish() && ok;
         }
 
-        // Presence Binary Sensor
-        JsonDocument presDoc;
-        presDoc["name"] = String("SideEye ") + _deviceID + " Presence";
-        presDoc["state_topic"] = baseTopic + "/state/presence";
-        presDoc["unique_id"] = String("side_eye_") + _deviceID + "_presence";
-        presDoc["device_class"] = "presence";
-        presDoc["payload_on"] = "present";
-        presDoc["payload_off"] = "away";
-        JsonObject presDev = presDoc["device"].to<JsonObject>();
-        presDev["identifiers"][0] = String("side_eye_") + _deviceID;
-
-        String presTopic = String(mqtt_discovery_prefix) + "/binary_sensor/side_eye_" + _deviceID + "_presence/config";
-        String presPayload;
-        serializeJson(presDoc, presPayload);
-        _mqttClient.publish(presTopic.c_str(), presPayload.c_str(), true);
-
-        JsonDocument binDoc;
-        binDoc["name"] = String("SideEye ") + _deviceID + " Status";
-        binDoc["state_topic"] = baseTopic + "/status";
-        binDoc["unique_id"] = String("side_eye_") + _deviceID + "_status";
-        binDoc["device_class"] = "connectivity";
-        binDoc["payload_on"] = "online";
-        binDoc["payload_off"] = "offline";
-
-        JsonObject binDev = binDoc["device"].to<JsonObject>();
-        binDev["identifiers"][0] = String("side_eye_") + _deviceID;
-
-        String binTopic = String(mqtt_discovery_prefix) + "/binary_sensor/side_eye_" + _deviceID + "_status/config";
-        String binPayload;
-        serializeJson(binDoc, binPayload);
-        _mqttClient.publish(binTopic.c_str(), binPayload.c_str(), true);
+        _discoveryPublished = ok;
+        _discoveryHash = hash;
+        return true;
     }
 
     void resetSettings() {
-        WiFiManager wm;
-        wm.resetSettings();
+        _wm.resetSettings();
         if (LittleFS.begin()) {
             LittleFS.remove("/config.json");
+            _config.clear();
         }
         Serial.println("Settings reset, restarting...");
         delay(1000);
@@ -297,8 +482,379 @@ public:
     }
 
 private:
+    struct DiscoveryEntry {
+        const char* component;
+        const char* key;
+        const char* payload;
+    };
+
+#ifdef SIDEEYE_LOOP_METRICS
+    static const size_t DISCOVERY_COUNT = 7 + NUM_LOOP_STAGES;
+#else
+    static const size_t DISCOVERY_COUNT = 7;
+#endif
+
+#define SIDEEYE_DEVICE_FULL \
+    "\"device\":{\"identifiers\":[\"side_eye_\x01\"],\"name\":\"SideEye \x01\"," \
+    "\"model\":\"ESP32-C6 GEEK\",\"manufacturer\":\"Waveshare\",\"sw_version\":\"\x03\"}"
+#define SIDEEYE_DEVICE_REF "\"device\":{\"identifiers\":[\"side_eye_\x01\"]}"
+#define SIDEEYE_SENSOR(name, key, icon) \
+    { "sensor", key, \
+      "{\"name\":\"SideEye \x01 " name "\",\"state_topic\":\"\x02/state\"," \
+      "\"value_template\":\"{{ value_json." key " }}\",\"unique_id\":\"side_eye_\x01_" key "\"," \
+      "\"icon\":\"" icon "\"," SIDEEYE_DEVICE_FULL "}" }
+#define SIDEEYE_LOOP_SENSOR(name, stage) \
+    { "sensor", "loop_" stage, \
+      "{\"name\":\"SideEye \x01 " name " p99\",\"state_topic\":\"\x02/metrics\"," \
+      "\"value_template\":\"{{ value_json." stage "_p99 }}\",\"unique_id\":\"side_eye_\x01_loop_" stage "\"," \
+      "\"unit_of_measurement\":\"\xce\xbcs\",\"device_class\":\"duration\",\"state_class\":\"measurement\"," \
+      "\"entity_category\":\"diagnostic\"," SIDEEYE_DEVICE_REF "}" }
+
+    // Discovery templates: '\x01' expands to the device ID, '\x02' to the
+    // state base topic (prefix/ID) and '\x03' to the firmware version.
+    static const DiscoveryEntry* discoveryEntries() {
+        static const DiscoveryEntry entries[DISCOVERY_COUNT] = {
+            SIDEEYE_SENSOR("Hostname", "hostname", "mdi:label"),
+            SIDEEYE_SENSOR("IP Address", "ip", "mdi:ip-network"),
+            SIDEEYE_SENSOR("MAC Address", "mac", "mdi:ethernet"),
+            SIDEEYE_SENSOR("WiFi RSSI", "rssi", "mdi:wifi"),
+            SIDEEYE_SENSOR("BLE Status", "ble_status", "mdi:bluetooth"),
+            { "binary_sensor", "presence",
+              "{\"name\":\"SideEye \x01 Presence\",\"state_topic\":\"\x02/state/presence\","
+              "\"unique_id\":\"side_eye_\x01_presence\",\"device_class\":\"presence\","
+              "\"payload_on\":\"present\",\"payload_off\":\"away\"," SIDEEYE_DEVICE_REF "}" },
+            { "binary_sensor", "status",
+              "{\"name\":\"SideEye \x01 Status\",\"state_topic\":\"\x02/status\","
+              "\"unique_id\":\"side_eye_\x01_status\",\"device_class\":\"connectivity\","
+              "\"payload_on\":\"online\",\"payload_off\":\"offline\"," SIDEEYE_DEVICE_REF "}" },
+#ifdef SIDEEYE_LOOP_METRICS
+            SIDEEYE_LOOP_SENSOR("Input", "input"),
+            SIDEEYE_LOOP_SENSOR("Network", "network"),
+            SIDEEYE_LOOP_SENSOR("BLE", "ble"),
+            SIDEEYE_LOOP_SENSOR("UDP", "udp"),
+            SIDEEYE_LOOP_SENSOR("Serial", "serial"),
+            SIDEEYE_LOOP_SENSOR("Render", "render"),
+            SIDEEYE_LOOP_SENSOR("Loop", "loop"),
+#endif
+        };
+        return entries;
+    }
+
+#undef SIDEEYE_LOOP_SENSOR
+#undef SIDEEYE_SENSOR
+#undef SIDEEYE_DEVICE_REF
+#undef SIDEEYE_DEVICE_FULL
+
+    struct LengthSink {
+        void write(const char*, size_t n) { length += n; }
+        size_t length = 0;
+    };
+
+    struct CrcSink {
+        void write(const char* s, size_t n) { crc = crc32Update(crc, s, n); }
+        uint32_t crc = 0;
+    };
+
+    struct MqttSink {
+        explicit MqttSink(PubSubClient& c) : client(c) {}
+        void write(const char* s, size_t n) { client.write(reinterpret_cast<const uint8_t*>(s), n); }
+        PubSubClient& client;
+    };
+
+    template <typename Out>
+    void expandTemplate(const char* tmpl, Out& out) const {
+        const char* run = tmpl;
+        for (const char* p = tmpl;; p++) {
+            char c = *p;
+            if (c != '\0' && (c < '\x01' || c > '\x03')) continue;
+            out.write(run, p - run);
+            if (c == '\0') break;
+            run = p + 1;
+            if (c == '\x01') writeEscaped(_deviceID.c_str(), out);
+            else if (c == '\x03') writeEscaped(_version.c_str(), out);
+            else {
+                writeEscaped(mqtt_topic_prefix, out);
+                out.write("/", 1);
+                writeEscaped(_deviceID.c_str(), out);
+            }
+        }
+    }
+
+    // Settings are user input, so escape what would break a JSON string
+    template <typename Out>
+    static void writeEscaped(const char* s, Out& out) {
+        const char* run = s;
+        for (; *s; s++) {
+            if (*s != '"' && *s != '\\') continue;
+            out.write(run, s - run);
+            out.write("\\", 1);
+            run = s;
+        }
+        out.write(run, s - run);
+    }
+
+    void discoveryTopic(const DiscoveryEntry& entry, char* out, size_t size) const {
+        snprintf(out, size, "%s/%s/side_eye_%s_%s/config", mqtt_discovery_prefix, entry.component,
+                 _deviceID.c_str(), entry.key);
+    }
+
+    uint32_t discoveryHash() const {
+        CrcSink crc;
+        const DiscoveryEntry* entries = discoveryEntries();
+        for (size_t i = 0; i < DISCOVERY_COUNT; i++) {
+            const DiscoveryEntry& entry = entries[i];
+            char topic[TOPIC_SIZE + 32];
+            discoveryTopic(entry, topic, sizeof(topic));
+            crc.write(topic, strlen(topic) + 1);
+            expandTemplate(entry.payload, crc);
+        }
+        return crc.crc;
+    }
+
+    bool mqttHandshake() {
+        char clientId[48];
+        snprintf(clientId, sizeof(clientId), "SideEye-%s", _deviceID.c_str());
+        const char* statusTopic = _topics[TOPIC_STATUS];
+
+        bool connected = false;
+        if (strlen(mqtt_user) > 0) {
+            connected = _mqttClient.connect(clientId, mqtt_user, mqtt_pass, statusTopic, 1, true, "offline");
+        } else {
+            connected = _mqttClient.connect(clientId, statusTopic, 1, true, "offline");
+        }
+
+        if (!connected) {
+            Serial.print("failed, rc=");
+            Serial.print(_mqttClient.state());
+            return false;
+        }
+        Serial.println("MQTT connected");
+        requestFullRefresh();
+        _mqttClient.publish(statusTopic, "online", true);
+        return true;
+    }
+
+    void mqttSubscribe() {
+        // Subscribe to all setting topics for this device
+        _mqttClient.subscribe(_topics[TOPIC_SET]);
+        Serial.print("Subscribed to ");
+        Serial.println(_topics[TOPIC_SET]);
+    }
+
+    ConfigData currentConfig(const SystemState& state) const {
+        ConfigData config;
+        copyField(config.mqtt_server, mqtt_server, sizeof(config.mqtt_server));
+        copyField(config.mqtt_port, mqtt_port, sizeof(config.mqtt_port));
+        copyField(config.mqtt_user, mqtt_user, sizeof(config.mqtt_user));
+        copyField(config.mqtt_pass, mqtt_pass, sizeof(config.mqtt_pass));
+        copyField(config.mqtt_topic_prefix, mqtt_topic_prefix, sizeof(config.mqtt_topic_prefix));
+        copyField(config.mqtt_discovery_prefix, mqtt_discovery_prefix, sizeof(config.mqtt_discovery_prefix));
+        config.cycle_duration = state.cycle_duration;
+        config.brightness = state.brightness;
+        config.rotation = state.rotation;
+        config.cpu_warning = state.cpu_warning;
+        config.cpu_critical = state.cpu_critical;
+        config.ram_warning = state.ram_warning;
+        config.ram_critical = state.ram_critical;
+        config.graph_range = state.graph_range;
+        return config;
+    }
+
+    void applyConfig(const ConfigData& config, SystemState& state) {
+        copyField(mqtt_server, config.mqtt_server, sizeof(mqtt_server));
+        copyField(mqtt_port, config.mqtt_port, sizeof(mqtt_port));
+        copyField(mqtt_user, config.mqtt_user, sizeof(mqtt_user));
+        copyField(mqtt_pass, config.mqtt_pass, sizeof(mqtt_pass));
+        copyField(mqtt_topic_prefix, config.mqtt_topic_prefix, sizeof(mqtt_topic_prefix));
+        copyField(mqtt_discovery_prefix, config.mqtt_discovery_prefix, sizeof(mqtt_discovery_prefix));
+        state.cycle_duration = config.cycle_duration;
+        state.brightness = config.brightness;
+        state.rotation = config.rotation;
+        state.cpu_warning = config.cpu_warning;
+        state.cpu_critical = config.cpu_critical;
+        state.ram_warning = config.ram_warning;
+        state.ram_critical = config.ram_critical;
+        state.graph_range = config.graph_range;
+    }
+
+    // Copies a string field, always terminated; the rest stays zeroed
+    static void copyField(char* to, const char* from, size_t size) {
+        strncpy(to, from, size - 1);
+        to[size - 1] = '\0';
+    }
+
+    // Advances WiFi bring-up by at most one step; true once associated
+    bool updateWiFi(unsigned long now) {
+        switch (_wifiPhase) {
+            case WIFI_IDLE:
+                return false;
+            case WIFI_JOINING:
+                if (WiFi.status() != WL_CONNECTED) {
+                    if (now - _wifiStarted >= WIFI_JOIN_TIMEOUT_MS) startPortal();
+                    return false;
+                }
+                break;
+            case WIFI_PORTAL:
+                if (!_wm.process()) return false;
+                copyField(mqtt_server, _serverParam.getValue(), sizeof(mqtt_server));
+                copyField(mqtt_port, _portParam.getValue(), sizeof(mqtt_port));
+                copyField(mqtt_user, _userParam.getValue(), sizeof(mqtt_user));
+                copyField(mqtt_pass, _passParam.getValue(), sizeof(mqtt_pass));
+                copyField(mqtt_topic_prefix, _prefixParam.getValue(), sizeof(mqtt_topic_prefix));
+                copyField(mqtt_discovery_prefix, _discoveryParam.getValue(), sizeof(mqtt_discovery_prefix));
+                break;
+            case WIFI_UP:
+                return true;
+        }
+
+        Serial.println("WiFi connected");
+        setWifiPhase(WIFI_UP);
+        _udpListening = _udp.begin(TELEMETRY_PORT);
+        return true;
+    }
+
+    // Opens the config portal without blocking; update() services it
+    void startPortal() {
+        Serial.println("WiFi not joined, starting config portal");
+        String apName = "SideEye-" + _deviceID;
+        _wm.startConfigPortal(apName.c_str());
+        setWifiPhase(WIFI_PORTAL);
+    }
+
+    enum DnsLookup : uint8_t {
+        LOOKUP_IDLE,
+        LOOKUP_PENDING,
+        LOOKUP_DONE,
+        LOOKUP_FAILED
+    };
+
+    // Starts a lookup of the broker name, or reports on the one in flight.
+    // lwIP answers from its own task, so a slow resolver costs polls rather
+    // than the seconds WiFi.hostByName() would block the loop for.
+    DnsLookup resolveBroker() {
+        DnsLookup lookup = (DnsLookup)_dnsLookup.load(std::memory_order_acquire);
+        if (lookup == LOOKUP_PENDING) return lookup;
+        if (lookup != LOOKUP_IDLE) {
+            _dnsLookup.store(LOOKUP_IDLE, std::memory_order_relaxed);
+            if (lookup == LOOKUP_DONE) _brokerIP = IPAddress(_dnsAddress.load(std::memory_order_relaxed));
+            return lookup;
+        }
+
+        // Pending first: the callback can run before dns_gethostbyname returns
+        ip_addr_t addr;
+        _dnsLookup.store(LOOKUP_PENDING, std::memory_order_relaxed);
+#if LWIP_TCPIP_CORE_LOCKING
+        LOCK_TCPIP_CORE();
+#endif
+        err_t err = dns_gethostbyname(mqtt_server, &addr, onDnsFound, this);
+#if LWIP_TCPIP_CORE_LOCKING
+        UNLOCK_TCPIP_CORE();
+#endif
+        if (err == ERR_INPROGRESS) return LOOKUP_PENDING;
+        _dnsLookup.store(LOOKUP_IDLE, std::memory_order_relaxed);
+        if (err != ERR_OK) return LOOKUP_FAILED;
+        _brokerIP = IPAddress(ip_addr_get_ip4_u32(&addr)); // Cached by lwIP
+        return LOOKUP_DONE;
+    }
+
+    // Runs on the lwIP task; ipaddr is NULL when the name didn't resolve
+    static void onDnsFound(const char*, const ip_addr_t* ipaddr, void* arg) {
+        SideEyeNetworkManager* self = static_cast<SideEyeNetworkManager*>(arg);
+        if (ipaddr) self->_dnsAddress.store(ip_addr_get_ip4_u32(ipaddr), std::memory_order_relaxed);
+        self->_dnsLookup.store(ipaddr ? LOOKUP_DONE : LOOKUP_FAILED, std::memory_order_release);
+    }
+
+    void setPhase(MqttPhase phase) {
+        _phase = phase;
+        TRACE_INSTANT(TRACE_MQTT_PHASE, phase);
+    }
+
+    void setWifiPhase(WifiPhase phase) {
+        _wifiPhase = phase;
+        TRACE_INSTANT(TRACE_WIFI_PHASE, phase);
+    }
+
+    // Closes any half-open connection and schedules the next attempt
+    void retryLater(unsigned long now) {
+        _mqttClient.disconnect();
+        _espClient.stop();
+        if (_attempts < 31) _attempts++;
+
+        unsigned long wait = BACKOFF_MAX_MS;
+        if (_attempts <= 16 && (BACKOFF_BASE_MS << (_attempts - 1)) < BACKOFF_MAX_MS) {
+            wait = BACKOFF_BASE_MS << (_attempts - 1);
+        }
+        // xorshift32
+        _jitter ^= _jitter << 13;
+        _jitter ^= _jitter >> 17;
+        _jitter ^= _jitter << 5;
+        _nextAttempt = now + wait / 2 + _jitter % (wait / 2 + 1);
+        setPhase(MQTT_BACKOFF);
+    }
+
+    bool changed(MqttTopic t, uint32_t value) const {
+        return !(_publishedMask & (1u << t)) || _lastValue[t] != value;
+    }
+
+    void markPublished(MqttTopic t, uint32_t value) {
+        _publishedMask |= 1u << t;
+        _lastValue[t] = value;
+    }
+
+    // Values are marked once queued; one evicted before it was sent is
+    // unmarked again, so the next publishState queues it afresh
+    void publishValue(MqttTopic t, uint32_t value) {
+        if (!changed(t, value)) return;
+        char payload[12];
+        snprintf(payload, sizeof(payload), "%lu", (unsigned long)value);
+        if (enqueue(t, payload, true)) markPublished(t, value);
+    }
+
+    void publishString(MqttTopic t, const char* payload) {
+        uint32_t hash = crc32Update(0, payload, strlen(payload));
+        if (!changed(t, hash)) return;
+        if (enqueue(t, payload, true)) markPublished(t, hash);
+    }
+
+    bool enqueue(MqttTopic t, const char* payload, bool retained) {
+        int16_t evicted;
+        if (!_queue.push(t, payload, retained, &evicted)) return false;
+        if (evicted >= 0) _publishedMask &= ~(1u << evicted);
+        return true;
+    }
+
+    // Topics are looked up at send time, so entries queued before the first
+    // connect go out under the topics built for it. A failed publish stays
+    // at the front for the next call.
+    void drainQueue(unsigned long now) {
+        if (_phase != MQTT_CONNECTED) return;
+        if (now - _drainWindowStart >= _drainInterval) {
+            _drainWindowStart = now;
+            _drainSent = 0;
+        }
+        while (_drainSent < _drainBurst && _queue.size() > 0) {
+            const OutboundQueue::Entry* entry = _queue.front();
+            if (!_mqttClient.publish(_topics[entry->key], entry->payload, entry->retained)) break;
+            TRACE_INSTANT(TRACE_PUBLISH, entry->key);
+            _queue.sent();
+            _drainSent++;
+        }
+    }
+
+    WiFiManager _wm;
+    WiFiManagerParameter _serverParam{"server", "mqtt server", "", 40};
+    WiFiManagerParameter _portParam{"port", "mqtt port", "", 6};
+    WiFiManagerParameter _userParam{"user", "mqtt user", "", 40};
+    WiFiManagerParameter _passParam{"pass", "mqtt pass", "", 40};
+    WiFiManagerParameter _prefixParam{"prefix", "topic prefix", "", 40};
+    WiFiManagerParameter _discoveryParam{"discovery", "discovery prefix", "", 40};
+    WifiPhase _wifiPhase = WIFI_IDLE;
+    unsigned long _wifiStarted = 0;
+
     WiFiClient _espClient;
     PubSubClient _mqttClient;
+    WiFiUDP _udp;
+    bool _udpListening = false;
     String _deviceID;
     String _version;
 
@@ -308,6 +864,37 @@ private:
     char mqtt_pass[40] = "";
     char mqtt_topic_prefix[40] = "side-eye";
     char mqtt_discovery_prefix[40] = "homeassistant";
+
+    char _topics[NUM_TOPICS][TOPIC_SIZE] = {};
+
+    // Change tracking for publishState; bit t of the mask means _lastValue[t]
+    // holds what the broker last received on topic t
+    uint32_t _lastValue[NUM_TOPICS] = {};
+    uint16_t _publishedMask = 0;
+    int _lastRssi = 0;
+    unsigned long _lastRssiPublish = 0;
+    unsigned long _rssiInterval = 60000;
+
+    OutboundQueue _queue;
+    uint8_t _drainBurst = DRAIN_BURST;
+    uint8_t _drainSent = 0;
+    unsigned long _drainInterval = DRAIN_INTERVAL_MS;
+    unsigned long _drainWindowStart = 0;
+
+    ConfigStore _config;
+
+    uint32_t _discoveryHash = 0;
+    bool _discoveryPublished = false;
+
+    MqttPhase _phase = MQTT_BACKOFF;
+    unsigned long _nextAttempt = 0;
+    uint8_t _attempts = 0;
+    uint32_t _jitter = 1;
+    IPAddress _brokerIP;
+    bool _brokerResolved = false;
+    std::atomic<uint8_t> _dnsLookup{LOOKUP_IDLE};
+    std::atomic<uint32_t> _dnsAddress{0};
 };
 
+
 #endif
@@ -0,0 +1,184 @@
+#ifndef PRESENCE_TRACKER_H
+#define PRESENCE_TRACKER_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <mbedtls/aes.h>
+#include "Crc32.h"
+
+/*
+ * Decides whether a known phone or watch is nearby, and when the radio
+ * should listen for it.
+ *
+ * Targets are a small allowlist: public/static MACs stored only as CRC-32
+ * hashes, and identity resolving keys (IRKs) for devices that advertise
+ * resolvable private addresses. Other advertisers are ignored.
+ *
+ * A matching device's RSSI is smoothed with an EWMA; it becomes present
+ * once the smoothed value reaches enterRssi and stays present until it
+ * drops below exitRssi or nothing is heard for a few scan periods.
+ *
+ * Scanning is duty cycled: a window of windowMs every period. The period
+ * starts at searchPeriodMs, doubles after each window that confirms
+ * presence (up to maxPeriodMs), and drops back once presence is lost.
+ */
+class PresenceTracker {
+public:
+    static const uint8_t MAX_MACS = 8;
+    static const uint8_t MAX_IRKS = 4;
+    static const uint8_t MISSED_PERIODS = 2; // Scan periods without a sighting before presence is dropped
+
+    struct Settings {
+        int8_t enterRssi = -75;
+        int8_t exitRssi = -85;
+        uint16_t windowMs = 1000;
+        uint16_t searchPeriodMs = 4000;
+        uint16_t maxPeriodMs = 16000;
+    };
+
+    PresenceTracker() { clearTargets(); }
+
+    void setSettings(const Settings& settings) { _settings = settings; }
+    const Settings& settings() const { return _settings; }
+
+    bool addMac(const uint8_t mac[6]) {
+        if (_macCount >= MAX_MACS) return false;
+        _macHashes[_macCount++] = macHash(mac);
+        return true;
+    }
+
+    bool addMacHash(uint32_t hash) {
+        if (_macCount >= MAX_MACS) return false;
+        _macHashes[_macCount++] = hash;
+        return true;
+    }
+
+    bool addIrk(const uint8_t irk[16]) {
+        if (_irkCount >= MAX_IRKS) return false;
+        memcpy(_irks[_irkCount++], irk, 16);
+        return true;
+    }
+
+    void clearTargets() {
+        _macCount = 0;
+        _irkCount = 0;
+        reset();
+    }
+
+    uint8_t macCount() const { return _macCount; }
+    uint8_t irkCount() const { return _irkCount; }
+    uint32_t macHashAt(uint8_t i) const { return _macHashes[i]; }
+    const uint8_t* irkAt(uint8_t i) const { return _irks[i]; }
+    bool hasTargets() const { return _macCount > 0 || _irkCount > 0; }
+
+    // Addresses are in display order: addr[0] is the most significant byte
+    static uint32_t macHash(const uint8_t mac[6]) { return crc32Update(0, mac, 6); }
+
+    // True if `addr` is a resolvable private address generated from `irk`
+    // (Core spec Vol 6 Part B 1.3.2.2: hash = ah(IRK, prand))
+    static bool resolves(const uint8_t irk[16], const uint8_t addr[6]) {
+        if ((addr[0] & 0xC0) != 0x40) return false;
+        uint8_t block[16] = {0};
+        memcpy(block + 13, addr, 3);
+        uint8_t out[16];
+        mbedtls_aes_context aes;
+        mbedtls_aes_init(&aes);
+        mbedtls_aes_setkey_enc(&aes, irk, 128);
+        mbedtls_aes_crypt_ecb(&aes, MBEDTLS_AES_ENCRYPT, block, out);
+        mbedtls_aes_free(&aes);
+        return memcmp(out + 13, addr + 3, 3) == 0;
+    }
+
+    bool matches(const uint8_t addr[6]) const {
+        uint32_t hash = macHash(addr);
+        for (uint8_t i = 0; i < _macCount; i++) {
+            if (_macHashes[i] == hash) return true;
+        }
+        for (uint8_t i = 0; i < _irkCount; i++) {
+            if (resolves(_irks[i], addr)) return true;
+        }
+        return false;
+    }
+
+    // One advertisement; returns true if it came from a target
+    bool observe(const uint8_t addr[6], int rssi, unsigned long now) {
+        if (!matches(addr)) return false;
+        // EWMA with alpha = 1/4, in 1/16 dBm so small steps aren't lost
+        int32_t sample = rssi * 16;
+        _rssi16 = _heard ? _rssi16 + (sample - _rssi16) / 4 : sample;
+        _heard = true;
+        _lastSeen = now;
+        _heardThisWindow = true;
+
+        int16_t smoothed = smoothedRssi();
+        if (!_present && smoothed >= _settings.enterRssi) _present = true;
+        if (_present && smoothed < _settings.exitRssi) _present = false;
+        return true;
+    }
+
+    // Call every loop; returns whether the radio should be scanning now
+    bool update(unsigned long now) {
+        if (!_started) {
+            _started = true;
+            _windowStart = now;
+        }
+        if (_present && now - _lastSeen > (unsigned long)MISSED_PERIODS * _period + _settings.windowMs) {
+            _present = false;
+            _heard = false; // The next sighting restarts the average
+        }
+
+        unsigned long elapsed = now - _windowStart;
+        if (_scanning && elapsed >= _settings.windowMs) {
+            _scanning = false;
+            // Back off while presence keeps being confirmed
+            if (_present && _heardThisWindow) {
+                _period = _period * 2 > _settings.maxPeriodMs ? _settings.maxPeriodMs : _period * 2;
+            }
+            _heardThisWindow = false;
+        }
+        // Search eagerly while nobody is there
+        if (!_present) _period = _settings.searchPeriodMs;
+        if (!_scanning && elapsed >= _period) {
+            _scanning = true;
+            _windowStart = now;
+        }
+        return _scanning;
+    }
+
+    void reset() {
+        _present = false;
+        _heard = false;
+        _heardThisWindow = false;
+        _scanning = true;
+        _started = false;
+        _rssi16 = 0;
+        _lastSeen = 0;
+        _windowStart = 0;
+        _period = _settings.searchPeriodMs;
+    }
+
+    bool present() const { return _present; }
+    bool scanning() const { return _scanning; }
+    int16_t smoothedRssi() const { return _heard ? (int16_t)(_rssi16 / 16) : -127; }
+    unsigned long period() const { return _period; }
+
+private:
+    Settings _settings;
+    uint32_t _macHashes[MAX_MACS];
+    uint8_t _irks[MAX_IRKS][16];
+    uint8_t _macCount;
+    uint8_t _irkCount;
+
+    int32_t _rssi16;
+    unsigned long _lastSeen;
+    unsigned long _windowStart;
+    unsigned long _period;
+    bool _present;
+    bool _heard;
+    bool _heardThisWindow;
+    bool _scanning;
+    bool _started;
+};
+
+#endif
@@ -0,0 +1,103 @@
+#ifndef PUBLISH_QUEUE_H
+#define PUBLISH_QUEUE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/*
+ * Fixed ring of publishes waiting for the broker.
+ *
+ * Entries are keyed by topic and hold only the latest payload: pushing a key
+ * that's already queued replaces its payload in place, keeping its position,
+ * so an outage leaves at most one message per topic. When the ring is full
+ * the oldest entry is evicted.
+ */
+template <uint8_t Capacity, size_t PayloadSize>
+class PublishQueue {
+public:
+    struct Entry {
+        uint8_t key;
+        bool retained;
+        char payload[PayloadSize];
+    };
+
+    struct Counters {
+        uint32_t queued;    // Accepted into a free slot
+        uint32_t coalesced; // Replaced a pending payload for the same key
+        uint32_t dropped;   // Evicted, or too long to queue
+        uint32_t sent;
+    };
+
+    PublishQueue() { clear(); }
+
+    void clear() {
+        _head = 0;
+        _count = 0;
+        memset(&_counters, 0, sizeof(_counters));
+    }
+
+    // Returns false if the payload doesn't fit. If an older entry had to go,
+    // its key is stored in *evicted (otherwise -1) so the caller can resend
+    // it later.
+    bool push(uint8_t key, const char* payload, bool retained, int16_t* evicted = nullptr) {
+        if (evicted) *evicted = -1;
+        size_t length = strlen(payload);
+        if (length >= PayloadSize) {
+            _counters.dropped++;
+            return false;
+        }
+
+        Entry* entry = find(key);
+        if (entry) {
+            _counters.coalesced++;
+        } else {
+            if (_count == Capacity) {
+                if (evicted) *evicted = _entries[_head].key;
+                pop();
+                _counters.dropped++;
+            }
+            entry = &_entries[(_head + _count) % Capacity];
+            _count++;
+            _counters.queued++;
+        }
+        entry->key = key;
+        entry->retained = retained;
+        memcpy(entry->payload, payload, length + 1);
+        return true;
+    }
+
+    const Entry* front() const { return _count > 0 ? &_entries[_head] : nullptr; }
+
+    // Removes the front entry after it was published
+    void sent() {
+        pop();
+        _counters.sent++;
+    }
+
+    uint8_t size() const { return _count; }
+    static uint8_t capacity() { return Capacity; }
+    const Counters& counters() const { return _counters; }
+
+private:
+    Entry* find(uint8_t key) {
+        for (uint8_t i = 0; i < _count; i++) {
+            Entry* entry = &_entries[(_head + i) % Capacity];
+            if (entry->key == key) return entry;
+        }
+        return nullptr;
+    }
+
+    void pop() {
+        if (_count == 0) return;
+        _head = (_head + 1) % Capacity;
+        _count--;
+    }
+
+    Entry _entries[Capacity];
+    uint8_t _head;
+    uint8_t _count;
+    Counters _counters;
+};
+
+#endif
@@ -0,0 +1,64 @@
+#ifndef RENDER_SCHEDULER_H
+#define RENDER_SCHEDULER_H
+
+#include <stdint.h>
+
+/*
+ * Collects redraw requests from every producer (serial ingest, buttons, MQTT,
+ * timers) and hands the loop at most one frame per budget. Value updates are
+ * throttled to the frame interval; static redraws (page switches, rotation)
+ * go out on the next poll. While the screen can't be drawn to, requests are
+ * held back and a single full redraw is issued when it comes back.
+ */
+class RenderScheduler {
+public:
+    enum Dirty : uint8_t {
+        NONE = 0,
+        VALUES = 1 << 0, // Dynamic values on the current page
+        STATIC = 1 << 1, // Full page: background, labels and values
+        BANNER = 1 << 2  // Banner only (critical alert flashing)
+    };
+
+    explicit RenderScheduler(unsigned long frameInterval = 50) : _frameInterval(frameInterval) {}
+
+    void invalidate(uint8_t flags) {
+        if (_dirty & flags) _coalesced++;
+        _dirty |= flags;
+    }
+
+    // Returns the set of layers to draw now and clears them, or NONE when
+    // nothing is due. canRender is false while the backlight is off or
+    // another screen (reset countdown, overlay) owns the display.
+    uint8_t poll(unsigned long now, bool canRender) {
+        if (!canRender) {
+            _suspended = true;
+            return NONE;
+        }
+        if (_suspended) {
+            _suspended = false;
+            _dirty |= STATIC; // Catch up on everything missed while hidden
+        }
+        if (_dirty == NONE) return NONE;
+        if (!(_dirty & STATIC) && now - _lastFrame < _frameInterval) return NONE;
+
+        uint8_t frame = _dirty;
+        _dirty = NONE;
+        _lastFrame = now;
+        _frames++;
+        return frame;
+    }
+
+    bool isDirty() const { return _dirty != NONE; }
+    uint32_t frameCount() const { return _frames; }
+    uint32_t coalescedCount() const { return _coalesced; }
+
+private:
+    unsigned long _frameInterval;
+    unsigned long _lastFrame = 0;
+    uint8_t _dirty = NONE;
+    bool _suspended = false;
+    uint32_t _frames = 0;
+    uint32_t _coalesced = 0;
+};
+
+#endif
@@ -0,0 +1,122 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Cooperative timing primitives driven from loop().
+ *
+ * Nothing in here blocks: callers pass the current millis() value and the
+ * primitives work out what is due. This keeps serial ingest, button polling
+ * and the MQTT keepalive running while the UI animates.
+ */
+
+// Linear interpolation between two values over a fixed duration.
+class Tween {
+public:
+    void start(int32_t from, int32_t to, unsigned long duration, unsigned long now) {
+        _from = from;
+        _to = to;
+        _start = now;
+        _duration = duration;
+        _active = duration > 0;
+    }
+
+    // Jump straight to a value, cancelling any running tween.
+    void set(int32_t value) {
+        _from = value;
+        _to = value;
+        _active = false;
+    }
+
+    int32_t value(unsigned long now) const {
+        if (!_active) return _to;
+        unsigned long elapsed = now - _start;
+        if (elapsed >= _duration) return _to;
+        return _from + (int32_t)((int64_t)(_to - _from) * (int64_t)elapsed / (int64_t)_duration);
+    }
+
+    // Returns true while the tween is still running.
+    bool update(unsigned long now) {
+        if (_active && now - _start >= _duration) {
+            _active = false;
+        }
+        return _active;
+    }
+
+    bool isActive() const { return _active; }
+    int32_t target() const { return _to; }
+
+private:
+    int32_t _from = 0;
+    int32_t _to = 0;
+    unsigned long _start = 0;
+    unsigned long _duration = 0;
+    bool _active = false;
+};
+
+// Fixed-capacity one-shot and periodic timers. No heap, no std::function.
+template <size_t Capacity>
+class Scheduler {
+public:
+    typedef void (*Callback)(void* ctx);
+
+    static const int INVALID_ID = -1;
+
+    // Schedule cb to run `delay` ms after `now`. A non-zero period makes the
+    // timer repeat. Returns a slot id, or INVALID_ID when all slots are busy.
+    int schedule(unsigned long now, unsigned long delay, Callback cb, void* ctx, unsigned long period = 0) {
+        for (size_t i = 0; i < Capacity; i++) {
+            if (!_slots[i].cb) {
+                _slots[i].due = now + delay;
+                _slots[i].period = period;
+                _slots[i].cb = cb;
+                _slots[i].ctx = ctx;
+                return (int)i;
+            }
+        }
+        return INVALID_ID;
+    }
+
+    void cancel(int id) {
+        if (id >= 0 && (size_t)id < Capacity) {
+            _slots[id].cb = nullptr;
+        }
+    }
+
+    bool isPending(int id) const {
+        return id >= 0 && (size_t)id < Capacity && _slots[id].cb != nullptr;
+    }
+
+    // Run every timer whose deadline has passed. Callbacks may schedule or
+    // cancel timers, including their own slot.
+    void update(unsigned long now) {
+        for (size_t i = 0; i < Capacity; i++) {
+            Slot& s = _slots[i];
+            if (!s.cb || (long)(now - s.due) < 0) continue;
+
+            Callback cb = s.cb;
+            void* ctx = s.ctx;
+            if (s.period > 0) {
+                s.due += s.period;
+                if ((long)(now - s.due) >= 0) s.due = now + s.period; // Don't replay missed ticks
+            } else {
+                s.cb = nullptr;
+            }
+            cb(ctx);
+        }
+    }
+
+private:
+    struct Slot {
+        unsigned long due = 0;
+        unsigned long period = 0;
+        Callback cb = nullptr;
+        void* ctx = nullptr;
+    };
+
+    Slot _slots[Capacity];
+};
+
+#endif
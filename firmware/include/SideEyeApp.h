@@ -0,0 +1,625 @@
+#ifndef SIDE_EYE_APP_H
+#define SIDE_EYE_APP_H
+
+#include <Arduino.h>
+#include "AppClock.h"
+#include "DisplayManager.h"
+#include "InputHandler.h"
+#include "NetworkManager.h"
+#include "SyncManager.h"
+#include "BLEPresenceManager.h"
+#include "BLETelemetry.h"
+#include "RenderScheduler.h"
+#include "HistoryStore.h"
+#include "StatsLog.h"
+#include "TelemetryFrame.h"
+#include "HostTable.h"
+#include "BootProfile.h"
+#include "LoopMetrics.h"
+#include "Trace.h"
+#include "SpscRing.h"
+
+/*
+ * SideEye orchestrator: owns the telemetry state, page cycling and serial
+ * protocol, and drives the managers from loop(). The clock, serial port,
+ * display and network are injected, so the native build can run the real
+ * loop against the mocks at virtual time (see test/test_bench).
+ */
+class SideEyeApp {
+public:
+    static const uint8_t BUTTON_PIN = 9;
+    static const size_t INPUT_LIMIT = 512; // Longer serial lines are dropped
+    static const unsigned long CONNECTION_TIMEOUT = 10000;
+    static const unsigned long METRICS_PUBLISH_INTERVAL = 60000;
+    static const unsigned long BOOT_REPORT_TIMEOUT = 60000; // Report without phases that haven't finished by then
+
+    // What the loop has done since boot, for the replay harness
+    struct Counters {
+        uint32_t loops = 0;
+        uint32_t frames = 0;        // Serial and BLE lines handled
+        uint32_t rejected = 0;      // Lines that weren't valid JSON
+        uint32_t overflows = 0;     // Lines over INPUT_LIMIT, dropped unread
+        uint32_t staticRenders = 0; // Full page redraws
+        uint32_t valueRenders = 0;  // Value-only redraws
+        uint32_t bannerRenders = 0;
+    };
+
+    SideEyeApp(AppClock& clock, Stream& serial, DisplayManager& display, SideEyeNetworkManager& network,
+               const char* version)
+        : _clock(clock), _serial(serial), _display(display), _network(network), _version(version),
+          _input(BUTTON_PIN, display), _renderer(50) {} // 20 fps cap for value updates
+
+    SideEyeApp(const SideEyeApp&) = delete;
+    SideEyeApp& operator=(const SideEyeApp&) = delete;
+
+    // Everything setup() does after the pins, serial port and SPI bus are up.
+    // The callbacks are handed to WiFiManager, which only takes plain functions.
+    void begin(const String& deviceID, void (*saveCallback)(), void (*configCallback)(WiFiManager*),
+               void (*configLoopCallback)()) {
+        _deviceID = deviceID;
+
+        // SD Initialization (Handled by SyncManager using dedicated SPI)
+        _bootProfile.start(BOOT_SD, _clock.micros());
+        _syncManager.begin();
+        if (!_statsLog.begin()) {
+            _serial.println("Stats log disabled (no SD card)");
+        }
+        _bootProfile.finish(BOOT_SD, _clock.micros());
+
+        _bootProfile.start(BOOT_GFX, _clock.micros());
+        _display.begin(_state);
+        _display.setHistory(&_history);
+        _bootProfile.finish(BOOT_GFX, _clock.micros());
+
+        _bootProfile.start(BOOT_LITTLEFS, _clock.micros());
+        LittleFS.begin();
+        _bootProfile.finish(BOOT_LITTLEFS, _clock.micros());
+
+        _bootProfile.start(BOOT_HISTORY, _clock.micros());
+        if (_historyStore.restore(_history, _clock.millis())) {
+            _serial.printf("Restored history snapshot #%u\n", (unsigned)_historyStore.sequence());
+        }
+        _bootProfile.finish(BOOT_HISTORY, _clock.micros());
+        _input.begin();
+        _serial.printf("\n--- SideEye Firmware v%s starting ---\n", _version);
+
+        // Only loads settings and starts joining; WiFi, MQTT and BLE come up
+        // from loop() while serial telemetry is already on screen
+        _bootProfile.start(BOOT_CONFIG, _clock.micros());
+        _bootProfile.start(BOOT_WIFI, _clock.micros());
+        _network.setCallback([this](char* topic, uint8_t* payload, unsigned int length) {
+            onMqttMessage(topic, payload, length);
+        });
+        _network.begin(_deviceID, _version, _state, saveCallback, configCallback, configLoopCallback);
+        _bootProfile.finish(BOOT_CONFIG, _clock.micros());
+
+        _bootProfile.start(BOOT_FIRST_FRAME, _clock.micros());
+        _display.drawStaticUI(_state, _currentPage, _version);
+        _display.updateDynamicValues(_state, _currentPage, true, true, _version);
+        _bootProfile.finish(BOOT_FIRST_FRAME, _clock.micros());
+        _lastRotation = _display.getRotation();
+        _needsStaticDraw = false;
+    }
+
+    void loop() {
+        LOOP_STAGE(_loopMetrics, STAGE_LOOP);
+        _counters.loops++;
+
+        if (_state.sd_sync_status == SYNC_ACTIVE && _clock.millis() - _lastPageChange > 2000) {
+            _state.sd_sync_status = SYNC_IDLE;
+            _needsStaticDraw = true;
+        }
+
+        {
+            LOOP_STAGE(_loopMetrics, STAGE_INPUT);
+            if (_input.update(_state, _currentPage, _lastPageChange, _needsStaticDraw)) {
+                _network.resetSettings();
+            }
+        }
+        {
+            LOOP_STAGE(_loopMetrics, STAGE_NETWORK);
+            _network.update();
+            drainEvents();
+            bringUpServices();
+        }
+        {
+            LOOP_STAGE(_loopMetrics, STAGE_BLE);
+            _blePresence.update(_network, _state);
+        }
+        {
+            LOOP_STAGE(_loopMetrics, STAGE_UDP);
+            if (_network.pollTelemetry(_hosts, _clock.millis()) > 0 && _shownHost != HostTable::NONE) {
+                _renderer.invalidate(RenderScheduler::VALUES);
+            }
+            _hosts.expire(_clock.millis());
+        }
+
+        _historyStore.update(_history, _clock.millis());
+
+        // Timers and fades; an expired overlay leaves stale pixels behind
+        if (_display.update()) {
+            _needsStaticDraw = true;
+        }
+
+        // Timeout for connection status
+        if (_state.has_data) {
+            _lastDataReceived = _clock.millis();
+            _input.notifyActivity();
+            _state.has_data = false;
+        }
+
+        if (_state.connected && _clock.millis() - _lastDataReceived > CONNECTION_TIMEOUT) {
+            _state.connected = false;
+            _needsStaticDraw = true;
+        }
+
+        // Page cycling
+        if (_input.isScreenOn() && !_input.isResetActive()) {
+            unsigned long now = _clock.millis();
+            if (now - _lastPageChange > _state.cycle_duration) {
+                _currentPage = static_cast<Page>((_currentPage + 1) % NUM_PAGES);
+                if (_currentPage == PAGE_IDENTITY) nextHost();
+                _lastPageChange = now;
+                _needsStaticDraw = true;
+            }
+        }
+
+        // Refresh banner for flashing effect if in critical alert
+        const SystemState& shown = shownState();
+        if (shown.alert_level >= 2 && _clock.millis() - _lastFlashUpdate > 500) {
+            _renderer.invalidate(RenderScheduler::BANNER);
+            _lastFlashUpdate = _clock.millis();
+        }
+
+        if (_needsStaticDraw) {
+            _renderer.invalidate(RenderScheduler::STATIC);
+            _needsStaticDraw = false;
+        }
+
+        {
+            LOOP_STAGE(_loopMetrics, STAGE_RENDER);
+            // The config portal's instructions stay up until there's telemetry to show
+            bool portalShown = _network.wifiPhase() == WIFI_PORTAL && !_state.connected;
+            bool canRender = _input.isScreenOn() && !_input.isResetActive() && !_display.isNotificationActive() && !portalShown;
+            uint8_t frame = _renderer.poll(_clock.millis(), canRender);
+            if (frame & (RenderScheduler::STATIC | RenderScheduler::VALUES)) {
+                _display.updateDynamicValues(shown, _currentPage, frame & RenderScheduler::STATIC, false, _version);
+                if (frame & RenderScheduler::STATIC) _counters.staticRenders++;
+                else _counters.valueRenders++;
+            }
+            if ((frame & RenderScheduler::BANNER) && !(frame & RenderScheduler::STATIC)) {
+                _display.drawBanner("SIDEEYE MONITOR", shown.alert_level);
+                _display.drawWiFiStatus();
+                _counters.bannerRenders++;
+            }
+        }
+
+        {
+            LOOP_STAGE(_loopMetrics, STAGE_SERIAL);
+            pollInput(_serial, _serialLine);
+            _bleTelemetry.ack(pollInput(_bleTelemetry, _bleLine));
+            _statsLog.stepQuery(); // A QueryHistory reply, a few blocks a pass
+        }
+
+#ifdef SIDEEYE_LOOP_METRICS
+        if (_clock.millis() - _lastMetricsPublish >= METRICS_PUBLISH_INTERVAL) {
+            _network.publishMetrics(_loopMetrics);
+            _lastMetricsPublish = _clock.millis();
+        }
+#endif
+    }
+
+    // One line of the serial protocol, without its newline; replies go to
+    // `reply`, the transport the line came in on. QueryHistory keeps
+    // streaming to it over later loop passes.
+    void handleJson(const String& json) { handleJson(json, _serial); }
+
+    void handleJson(const String& json, Print& reply) {
+        TRACE_SCOPE(TRACE_HANDLE_JSON, json.length());
+        JsonDocument doc;
+        DeserializationError error = deserializeJson(doc, json);
+
+        if (error) {
+            _counters.rejected++;
+            return;
+        }
+        _counters.frames++;
+
+        const char* type = doc["type"] | "";
+        JsonObject data = doc["data"];
+
+        bool was_connected = _state.connected;
+
+        if (strcmp(type, "Identity") == 0) {
+            applyIdentity(_state, data);
+        } else if (strcmp(type, "Stats") == 0) {
+            uint8_t old_alert = _state.alert_level;
+            applyStats(_state, data);
+
+            unsigned long now = _clock.millis();
+            _history.net_up.push(_state.net_up, now);
+            _history.net_down.push(_state.net_down, now);
+            _history.cpu_percent.push(_state.cpu_percent, now);
+            _history.ram_percent.push(_state.ram_total_mb > 0 ? 100.0f * _state.ram_used_mb / _state.ram_total_mb : 0, now);
+            _history.thermal_c.push(_state.thermal_c, now);
+            _historyStore.markDirty();
+
+            // The SD log needs wall-clock time; skip samples until NTP has synced
+            time_t wallClock = _clock.wallClock();
+            if (wallClock > 1600000000) {
+                int32_t columns[StatsLog::COLUMNS];
+                StatsLog::toColumns(_state.cpu_percent, _state.ram_used_mb, _state.ram_total_mb, _state.gpu_percent,
+                                    _state.thermal_c, _state.net_up, _state.net_down, columns);
+                _statsLog.append((uint32_t)wallClock, columns);
+            }
+
+            // Alert Priority: Jump to resources page if alert level increases to Warning or Critical
+            if (_state.alert_level > 0 && _state.alert_level > old_alert) {
+                if (_currentPage != PAGE_RESOURCES) {
+                    _currentPage = PAGE_RESOURCES;
+                    _needsStaticDraw = true;
+                    _lastPageChange = _clock.millis();
+                }
+            }
+
+            if (_state.alert_level != old_alert) {
+                _needsStaticDraw = true;
+            }
+        } else if (strcmp(type, "ListFiles") == 0) {
+            String path = data["path"] | "/";
+            String list = _syncManager.listFiles(path.c_str());
+            reply.print("{\"type\":\"FileList\",\"data\":");
+            reply.print(list);
+            reply.println("}");
+        } else if (strcmp(type, "QueryHistory") == 0) {
+            uint32_t to = data["to"] | (uint32_t)_clock.wallClock();
+            uint32_t from = data["from"] | (to > 3600 ? to - 3600 : 0);
+            uint16_t points = data["points"] | 60;
+            _statsLog.beginQuery(from, to, points, reply);
+        } else if (strcmp(type, "WriteChunk") == 0) {
+            _state.sd_sync_status = SYNC_ACTIVE;
+            _currentPage = PAGE_SD;
+            _lastPageChange = _clock.millis();
+            _input.notifyActivity();
+            _needsStaticDraw = true;
+
+            bool success = _syncManager.handleWriteChunk(data);
+            _state.sd_sync_status = success ? SYNC_ACTIVE : SYNC_ERROR;
+
+            reply.print("{\"type\":\"OperationResult\",\"data\":{\"success\":");
+            reply.print(success ? "true" : "false");
+            reply.println(",\"message\":\"Chunk written\"}}");
+        }
+
+        if (_state.connected && !was_connected) {
+            _needsStaticDraw = true;
+        }
+
+        if (_state.connected) {
+            _network.publishState(_state, _blePresence);
+        }
+
+        if (strcmp(type, "GetVersion") == 0) {
+            JsonDocument res;
+            res["type"] = "Version";
+            res["version"] = _version;
+            serializeJson(res, reply);
+            reply.println();
+        } else if (strcmp(type, "GetMetrics") == 0) {
+#ifdef SIDEEYE_LOOP_METRICS
+            _loopMetrics.write(reply);
+            if (data["reset"] | false) _loopMetrics.clear();
+#else
+            reply.println("{\"type\":\"Error\",\"data\":\"loop metrics disabled\"}");
+#endif
+        } else if (strcmp(type, "GetBootProfile") == 0) {
+            char line[BootProfile::LINE_SIZE];
+            if (_bootProfile.format(_version, line, sizeof(line))) reply.println(line);
+        } else if (strcmp(type, "DumpTrace") == 0) {
+#ifdef SIDEEYE_TRACE
+            traceBuffer().dump(reply);
+            if (data["clear"] | false) traceBuffer().clear();
+#else
+            reply.println("{\"type\":\"Error\",\"data\":\"trace disabled\"}");
+#endif
+        } else if (strcmp(type, "SetPresence") == 0) {
+            bool success = _blePresence.configure(data);
+            reply.print("{\"type\":\"OperationResult\",\"data\":{\"success\":");
+            reply.print(success ? "true" : "false");
+            reply.println(",\"message\":\"Presence targets updated\"}}");
+        }
+
+        // Rendering is left to the loop so a burst of frames costs one redraw
+        _renderer.invalidate(_needsStaticDraw ? RenderScheduler::STATIC : RenderScheduler::VALUES);
+        _needsStaticDraw = false;
+    }
+
+    // PubSubClient callback, run from inside _network.update(). Only parses
+    // and queues; drainEvents() applies the setting once the client's
+    // loop() has returned, so publishes never nest inside it.
+    void onMqttMessage(char* topic, uint8_t* payload, unsigned int length) {
+        String topicStr = String(topic);
+        String payloadStr = "";
+        for (unsigned int i = 0; i < length; i++) {
+            payloadStr += (char)payload[i];
+        }
+
+        _serial.println("MQTT Message: " + topicStr + " -> " + payloadStr);
+
+        // Extract the setting name from topic: side-eye/DEVICE_ID/set/SETTING
+        int lastSlash = topicStr.lastIndexOf('/');
+        if (lastSlash == -1) return;
+        String setting = topicStr.substring(lastSlash + 1);
+
+        SettingEvent event;
+        event.setting = NUM_SETTINGS;
+        for (uint8_t i = 0; i < NUM_SETTINGS; i++) {
+            if (setting == settingName(i)) event.setting = i;
+        }
+        if (event.setting == NUM_SETTINGS) return;
+        event.value = payloadStr.toInt();
+        strncpy(event.text, payloadStr.c_str(), sizeof(event.text) - 1);
+        event.text[sizeof(event.text) - 1] = '\0';
+        if (!_settingEvents.push(event)) {
+            _serial.println("MQTT setting dropped: queue full");
+        }
+    }
+
+    // Shutdown path: keeps the graphs, the last partial block of the SD log
+    // and any settings not yet saved
+    void flush() {
+        _historyStore.flush(_history, _clock.millis());
+        _statsLog.flush();
+        _network.flushConfig();
+    }
+
+    // WiFiManager callbacks, forwarded by the plain functions given to begin()
+    void requestConfigSave() {
+        _serial.println("Should save config");
+        _shouldSaveConfig = true;
+    }
+
+    void showConfigPortal() {
+        _display.drawConfigMode(("SideEye-" + _deviceID).c_str(), WiFi.softAPIP().toString());
+    }
+
+    void serviceConfigPortal() {
+        _input.update(_state, _currentPage, _lastPageChange, _needsStaticDraw, true);
+        // Rotating the screen clears it; redraw the portal instructions
+        if (_display.getRotation() != _lastRotation) {
+            _lastRotation = _display.getRotation();
+            showConfigPortal();
+        }
+    }
+
+    const SystemState& state() const { return _state; }
+    Page currentPage() const { return _currentPage; }
+    const Counters& counters() const { return _counters; }
+#ifdef SIDEEYE_LOOP_METRICS
+    LoopMetrics& loopMetrics() { return _loopMetrics; }
+#endif
+    const BootProfile& bootProfile() const { return _bootProfile; }
+    const BLETelemetry& bleTelemetry() const { return _bleTelemetry; }
+
+private:
+    // Settings accepted on <prefix>/<device>/set/<name>
+    enum SettingId : uint8_t {
+        SET_BRIGHTNESS,
+        SET_ROTATION,
+        SET_CYCLE_DURATION,
+        SET_GRAPH_RANGE,
+        SET_CPU_WARNING,
+        SET_CPU_CRITICAL,
+        SET_RAM_WARNING,
+        SET_RAM_CRITICAL,
+        SET_DISCOVERY_PREFIX,
+        NUM_SETTINGS
+    };
+    static const char* settingName(uint8_t id) {
+        static const char* const NAMES[NUM_SETTINGS] = {
+            "brightness", "rotation", "cycle_duration", "graph_range", "cpu_warning",
+            "cpu_critical", "ram_warning", "ram_critical", "discovery_prefix"};
+        return NAMES[id];
+    }
+
+    // One /set message: the integer value, and the raw text for the
+    // discovery prefix
+    struct SettingEvent {
+        uint8_t setting;
+        int32_t value;
+        char text[40];
+    };
+
+    // One-shot steps of the background bring-up that begin() leaves to loop()
+    void bringUpServices() {
+        // begin() has already drawn the first frame, so BLE init doesn't delay it
+        if (!_bleStarted) {
+            _bootProfile.start(BOOT_BLE, _clock.micros());
+            _blePresence.begin(_deviceID.c_str());
+            _bleTelemetry.begin(_blePresence.server());
+            _bootProfile.finish(BOOT_BLE, _clock.micros());
+            _bleStarted = true;
+        }
+
+        if (!_wifiAnnounced && _network.wifiPhase() == WIFI_UP) {
+            _bootProfile.finish(BOOT_WIFI, _clock.micros());
+            _bootProfile.start(BOOT_MQTT, _clock.micros());
+            _clock.startWallClockSync(); // Timestamps for the SD log
+            _display.showNotification("WiFi Online");
+            _needsStaticDraw = true; // Status dot, once the notification expires
+            _wifiAnnounced = true;
+        }
+
+        if (_wifiAnnounced && !_bootProfile.finished(BOOT_MQTT) && _network.mqttPhase() == MQTT_CONNECTED) {
+            _bootProfile.finish(BOOT_MQTT, _clock.micros());
+        }
+
+        // Once per boot; the MQTT copy waits in the publish queue if needed
+        if (!_bootReported && (_bootProfile.complete() || _clock.millis() > BOOT_REPORT_TIMEOUT)) {
+            char line[BootProfile::LINE_SIZE];
+            if (_bootProfile.format(_version, line, sizeof(line))) {
+                _serial.println(line);
+                _network.publishBootProfile(line);
+            }
+            _bootReported = true;
+        }
+
+        if (_shouldSaveConfig) {
+            _network.saveConfig(_state, true);
+            _shouldSaveConfig = false;
+        }
+    }
+
+    // Applies what the callbacks queued since the last pass. One save and
+    // publish covers a burst of settings.
+    void drainEvents() {
+        SettingEvent event;
+        bool changed = false;
+        while (_settingEvents.pop(event)) {
+            if (applySetting(event)) changed = true;
+        }
+
+        if (changed) {
+            _network.saveConfig(_state, true);
+            _network.publishState(_state, _blePresence);
+            _display.showNotification("Settings Updated");
+            _needsStaticDraw = true; // Refresh UI once the notification expires
+        }
+    }
+
+    bool applySetting(const SettingEvent& event) {
+        switch (event.setting) {
+            case SET_BRIGHTNESS: {
+                uint8_t val = event.value;
+                _state.brightness = val;
+                _display.setBacklight(_state, true);
+                return true;
+            }
+            case SET_ROTATION:
+                if (event.value != 1 && event.value != 3) return false;
+                _state.rotation = event.value;
+                _display.setRotation(event.value);
+                _needsStaticDraw = true;
+                return true;
+            case SET_CYCLE_DURATION:
+                if (event.value < 1000) return false;
+                _state.cycle_duration = event.value;
+                return true;
+            case SET_GRAPH_RANGE:
+                if (event.value < 0 || event.value >= NUM_RANGES) return false;
+                _state.graph_range = event.value;
+                return true;
+            case SET_CPU_WARNING:
+                _state.cpu_warning = event.value;
+                return true;
+            case SET_CPU_CRITICAL:
+                _state.cpu_critical = event.value;
+                return true;
+            case SET_RAM_WARNING:
+                _state.ram_warning = event.value;
+                return true;
+            case SET_RAM_CRITICAL:
+                _state.ram_critical = event.value;
+                return true;
+            case SET_DISCOVERY_PREFIX:
+                _network.setDiscoveryPrefix(event.text);
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    // A line being assembled from one transport
+    struct LineInput {
+        String buffer;
+        bool overflow = false;
+    };
+
+    // Handles every complete line waiting on `in`, replying on it; returns
+    // how many lines that was
+    uint32_t pollInput(Stream& in, LineInput& line) {
+        uint32_t lines = 0;
+        while (in.available()) {
+            char c = in.read();
+            if (c == '\n' || c == '\r') {
+                if (line.overflow) {
+                    _counters.overflows++;
+                    lines++;
+                } else if (line.buffer.length() > 0) {
+                    handleJson(line.buffer, in);
+                    lines++;
+                }
+                line.buffer = "";
+                line.overflow = false;
+            } else if (line.buffer.length() < INPUT_LIMIT) {
+                line.buffer += c;
+            } else {
+                line.overflow = true;
+            }
+        }
+        return lines;
+    }
+
+    // Advances to the next connected UDP host, or back to the USB host after
+    // the last one. Called each time the page cycle wraps.
+    void nextHost() {
+        int8_t next = _hosts.nextConnected(_shownHost);
+        if (next == HostTable::NONE && !_state.connected) next = _hosts.nextConnected(HostTable::NONE);
+        _shownHost = next;
+        // The graphs only have history for the USB host
+        _display.setHistory(_shownHost == HostTable::NONE ? &_history : nullptr);
+    }
+
+    // The state to render: the shown host's telemetry with this device's settings
+    const SystemState& shownState() {
+        if (_shownHost == HostTable::NONE) return _state;
+        _view = _hosts.state(_shownHost);
+        copySettings(_view, _state);
+        return _view;
+    }
+
+    AppClock& _clock;
+    Stream& _serial;
+    DisplayManager& _display;
+    SideEyeNetworkManager& _network;
+    const char* _version;
+    String _deviceID;
+
+    InputHandler _input;
+    SyncManager _syncManager;
+    BLEPresenceManager _blePresence;
+    BLETelemetry _bleTelemetry; // The serial protocol over GATT
+    RenderScheduler _renderer;
+    HistoryStore _historyStore; // Snapshots every 15 min while samples arrive
+    StatsLog _statsLog;
+    BootProfile _bootProfile;
+#ifdef SIDEEYE_LOOP_METRICS
+    LoopMetrics _loopMetrics;
+#endif
+
+    SystemState _state;
+    SystemState _view;
+    TelemetryHistory _history;
+    HostTable _hosts; // Machines reporting over UDP
+    int8_t _shownHost = HostTable::NONE; // Slot on screen; NONE is the USB host
+    Page _currentPage = PAGE_IDENTITY;
+    unsigned long _lastPageChange = 0;
+    unsigned long _lastDataReceived = 0;
+    unsigned long _lastFlashUpdate = 0;
+#ifdef SIDEEYE_LOOP_METRICS
+    unsigned long _lastMetricsPublish = 0;
+#endif
+    bool _needsStaticDraw = true;
+    bool _shouldSaveConfig = false;
+    bool _bleStarted = false;
+    bool _wifiAnnounced = false;
+    bool _bootReported = false;
+    int _lastRotation = 0;
+
+    SpscRing<SettingEvent, 8> _settingEvents; // MQTT callback to drainEvents()
+    LineInput _serialLine;
+    LineInput _bleLine;
+    Counters _counters;
+};
+
+#endif
@@ -0,0 +1,82 @@
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+
+#ifndef SPSC_CACHE_LINE
+#define SPSC_CACHE_LINE 64
+#endif
+
+/*
+ * Lock-free ring for one producer and one consumer, e.g. a radio callback
+ * on the BLE task posting to the loop. Neither side ever blocks: push()
+ * fails when the ring is full and the producer decides what to drop.
+ *
+ * Indices run free and wrap at 2^32, so Capacity must be a power of two
+ * and every slot is usable. Each index sits on its own cache line next to
+ * its owner's cached copy of the other one, so the two sides only touch
+ * shared lines when the cached view says the ring is full or empty.
+ * Place rings in static or member storage; C++11 `new` ignores the
+ * over-alignment.
+ */
+template <typename T, size_t Capacity>
+class SpscRing {
+    static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+    static_assert(Capacity <= 0x80000000UL, "Capacity must fit the 32-bit indices");
+
+public:
+    SpscRing() : _head(0), _tailCache(0), _tail(0), _headCache(0) {}
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+
+    // Producer side
+    bool push(const T& item) { return push(&item, 1); }
+
+    // All of `items` or none of them
+    bool push(const T* items, size_t count) {
+        uint32_t head = _head.load(std::memory_order_relaxed);
+        if (Capacity - (head - _tailCache) < count) {
+            _tailCache = _tail.load(std::memory_order_acquire);
+            if (Capacity - (head - _tailCache) < count) return false;
+        }
+        for (size_t i = 0; i < count; i++) _slots[(head + i) & (Capacity - 1)] = items[i];
+        _head.store(head + (uint32_t)count, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side
+    bool pop(T& item) {
+        if (!peek(item)) return false;
+        _tail.store(_tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool peek(T& item) {
+        uint32_t tail = _tail.load(std::memory_order_relaxed);
+        if (_headCache == tail) {
+            _headCache = _head.load(std::memory_order_acquire);
+            if (_headCache == tail) return false;
+        }
+        item = _slots[tail & (Capacity - 1)];
+        return true;
+    }
+
+    // Exact from either side only while the other is idle
+    size_t size() const {
+        return _head.load(std::memory_order_acquire) - _tail.load(std::memory_order_acquire);
+    }
+    bool empty() const { return size() == 0; }
+    size_t space() const { return Capacity - size(); }
+    static constexpr size_t capacity() { return Capacity; }
+
+private:
+    alignas(SPSC_CACHE_LINE) std::atomic<uint32_t> _head; // Written by the producer
+    uint32_t _tailCache;                                  // Producer's last view of _tail
+    alignas(SPSC_CACHE_LINE) std::atomic<uint32_t> _tail; // Written by the consumer
+    uint32_t _headCache;                                  // Consumer's last view of _head
+    alignas(SPSC_CACHE_LINE) T _slots[Capacity];
+};
+
+#endif
@@ -0,0 +1,184 @@
+#ifndef STATIC_LAYER_CACHE_H
+#define STATIC_LAYER_CACHE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+/*
+ * RLE-compressed RGB565 snapshots of full-screen static layers.
+ *
+ * A layer is stored as (count, color) pairs of uint16_t, which suits the
+ * dashboard: long runs of the base color broken up by labels. Entries are
+ * evicted least-recently-used once either the slot count or the byte budget
+ * is exceeded, so the cache never grows past a fixed amount of heap.
+ *
+ * build() takes the pixels in pieces, so a layer can be rasterized a band
+ * at a time (see BandCanvas) and never exists uncompressed in full.
+ */
+class StaticLayerCache {
+public:
+    struct Layer {
+        const uint16_t* runs; // Interleaved count, color pairs
+        size_t pairs;
+    };
+
+    // RLE over pixels that arrive in pieces; runs continue across push()
+    // calls. Pairs past `capacity` (or all of them, without an output
+    // buffer) are only counted.
+    class RunEncoder {
+    public:
+        RunEncoder(uint16_t* out = nullptr, size_t capacity = 0) : _out(out), _capacity(capacity) {}
+
+        void push(const uint16_t* pixels, size_t count) {
+            for (size_t i = 0; i < count; i++) {
+                if (_run > 0 && pixels[i] == _color && _run < UINT16_MAX) {
+                    _run++;
+                } else {
+                    close();
+                    _color = pixels[i];
+                    _run = 1;
+                }
+            }
+        }
+
+        // Pairs written (or counted)
+        size_t finish() {
+            close();
+            return _pairs;
+        }
+
+    private:
+        void close() {
+            if (_run == 0) return;
+            if (_pairs < _capacity) {
+                _out[_pairs * 2] = _run;
+                _out[_pairs * 2 + 1] = _color;
+            }
+            _pairs++;
+            _run = 0;
+        }
+
+        uint16_t* _out;
+        size_t _capacity;
+        size_t _pairs = 0;
+        uint16_t _run = 0;
+        uint16_t _color = 0;
+    };
+
+    explicit StaticLayerCache(size_t byteBudget = 48 * 1024) : _budget(byteBudget) {}
+
+    ~StaticLayerCache() { clear(); }
+
+    StaticLayerCache(const StaticLayerCache&) = delete;
+    StaticLayerCache& operator=(const StaticLayerCache&) = delete;
+
+    bool find(uint32_t key, Layer& out) {
+        for (size_t i = 0; i < SLOTS; i++) {
+            if (_slots[i].runs && _slots[i].key == key) {
+                _slots[i].lastUsed = ++_clock;
+                out.runs = _slots[i].runs;
+                out.pairs = _slots[i].pairs;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Stores the layer `render(RunEncoder&)` pushes under key. It is called
+    // twice, to size the entry and then to fill it, and must push the same
+    // pixels. Returns false if the layer could not be stored (allocation
+    // failure, a layer larger than the budget, or a render that changed).
+    template <typename Render>
+    bool build(uint32_t key, Render render) {
+        RunEncoder counter;
+        render(counter);
+        size_t pairs = counter.finish();
+        size_t bytes = pairs * 2 * sizeof(uint16_t);
+        if (bytes > _budget) return false;
+
+        remove(key);
+        while (_used + bytes > _budget || !freeSlot()) {
+            evictOldest();
+        }
+
+        uint16_t* runs = static_cast<uint16_t*>(malloc(bytes));
+        if (!runs) return false;
+        RunEncoder encoder(runs, pairs);
+        render(encoder);
+        if (encoder.finish() != pairs) {
+            free(runs);
+            return false;
+        }
+
+        Slot* slot = freeSlot();
+        slot->key = key;
+        slot->runs = runs;
+        slot->pairs = pairs;
+        slot->lastUsed = ++_clock;
+        _used += bytes;
+        return true;
+    }
+
+    void clear() {
+        for (size_t i = 0; i < SLOTS; i++) release(_slots[i]);
+    }
+
+    size_t bytesUsed() const { return _used; }
+
+    size_t size() const {
+        size_t n = 0;
+        for (size_t i = 0; i < SLOTS; i++) {
+            if (_slots[i].runs) n++;
+        }
+        return n;
+    }
+
+    static const size_t SLOTS = 8;
+
+private:
+    struct Slot {
+        uint32_t key = 0;
+        uint16_t* runs = nullptr;
+        size_t pairs = 0;
+        uint32_t lastUsed = 0;
+    };
+
+    Slot* freeSlot() {
+        for (size_t i = 0; i < SLOTS; i++) {
+            if (!_slots[i].runs) return &_slots[i];
+        }
+        return nullptr;
+    }
+
+    void remove(uint32_t key) {
+        for (size_t i = 0; i < SLOTS; i++) {
+            if (_slots[i].runs && _slots[i].key == key) release(_slots[i]);
+        }
+    }
+
+    void evictOldest() {
+        Slot* oldest = nullptr;
+        for (size_t i = 0; i < SLOTS; i++) {
+            if (_slots[i].runs && (!oldest || _slots[i].lastUsed < oldest->lastUsed)) {
+                oldest = &_slots[i];
+            }
+        }
+        if (oldest) release(*oldest);
+    }
+
+    void release(Slot& slot) {
+        if (!slot.runs) return;
+        _used -= slot.pairs * 2 * sizeof(uint16_t);
+        free(slot.runs);
+        slot.runs = nullptr;
+        slot.pairs = 0;
+    }
+
+    Slot _slots[SLOTS];
+    size_t _budget;
+    size_t _used = 0;
+    uint32_t _clock = 0;
+};
+
+#endif
@@ -0,0 +1,65 @@
+#ifndef STATIC_STRING_H
+#define STATIC_STRING_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/*
+ * Fixed-capacity, NUL-terminated string stored inline.
+ *
+ * Holds at most N - 1 bytes; longer input is truncated on a UTF-8 character
+ * boundary. Assignment copies into the inline buffer and never allocates,
+ * so structs of StaticStrings stay trivially copyable.
+ */
+template <size_t N>
+class StaticString {
+    static_assert(N > 1 && N <= 256, "StaticString length is stored in a uint8_t");
+
+public:
+    StaticString() : _length(0) { _data[0] = '\0'; }
+    // cppcheck-suppress noExplicitConstructor
+    StaticString(const char* s) { assign(s); }
+
+    StaticString& operator=(const char* s) {
+        assign(s);
+        return *this;
+    }
+
+    void assign(const char* s) { assign(s, s ? strlen(s) : 0); }
+
+    void assign(const char* s, size_t length) {
+        if (length > N - 1) {
+            length = N - 1;
+            // Don't leave half of a multi-byte character at the end
+            while (length > 0 && (static_cast<unsigned char>(s[length]) & 0xC0) == 0x80) length--;
+        }
+        if (length > 0) memcpy(_data, s, length);
+        _data[length] = '\0';
+        _length = static_cast<uint8_t>(length);
+    }
+
+    void clear() {
+        _data[0] = '\0';
+        _length = 0;
+    }
+
+    const char* c_str() const { return _data; }
+    size_t length() const { return _length; }
+    bool empty() const { return _length == 0; }
+    static size_t capacity() { return N - 1; }
+
+    bool operator==(const char* s) const { return s && strcmp(_data, s) == 0; }
+    bool operator!=(const char* s) const { return !(*this == s); }
+
+    template <size_t M>
+    bool operator==(const StaticString<M>& other) const {
+        return _length == other.length() && memcmp(_data, other.c_str(), _length) == 0;
+    }
+
+private:
+    char _data[N];
+    uint8_t _length;
+};
+
+#endif
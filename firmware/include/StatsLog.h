@@ -0,0 +1,528 @@
+#ifndef STATS_LOG_H
+#define STATS_LOG_H
+
+#include <Arduino.h>
+#include <SD.h>
+#include <string.h>
+
+/*
+ * Append-only time-series log of Stats samples on the SD card.
+ *
+ * Samples are packed into fixed-size blocks of BLOCK_SAMPLES. A block is
+ * columnar: a header with the first sample as base plus per-column min/max,
+ * then a column of time offsets and one column per metric, each stored as a
+ * fixed-width delta from the base. Blocks are appended to segment files of
+ * SEGMENT_BLOCKS by default; each segment starts with a header carrying its time range
+ * and per-column min/max so queries can skip whole files. The oldest segment
+ * is deleted once MAX_SEGMENTS exist.
+ *
+ *   /stats/index         first and last segment sequence
+ *   /stats/NNNNNNNN.seg  SegmentHeader, then BLOCK_BYTES per block
+ *
+ * The block being filled lives in RAM and is written when full, so a power
+ * cut loses at most one block (about a minute at the default 1 Hz).
+ */
+class StatsLog {
+public:
+    enum Column : uint8_t {
+        COL_CPU = 0,  // 0.01 %
+        COL_RAM,      // 0.01 % of total
+        COL_GPU,      // 0.01 %
+        COL_THERMAL,  // 0.01 C
+        COL_NET_UP,   // B/s, clamped to int32
+        COL_NET_DOWN, // B/s, clamped to int32
+        COLUMNS
+    };
+
+    static const uint16_t BLOCK_SAMPLES = 60;
+    static const uint16_t SEGMENT_BLOCKS = 360;  // 6 h at 1 Hz
+    static const uint16_t MAX_SEGMENTS = 120;    // 30 days
+    static const uint16_t MAX_POINTS = 500;
+    static const uint16_t QUERY_READS_PER_STEP = 16; // Card reads per stepQuery()
+    static const uint8_t POINTS_PER_LINE = 32;
+    static const uint32_t MAGIC = 0x534C4753;    // "SGLS"
+    static const uint16_t VERSION = 1;
+
+    // Laid out without implicit padding so the format is the same on any
+    // little-endian target
+    struct BlockHeader {
+        uint16_t count;
+        uint16_t reserved;
+        uint32_t t0;
+        uint32_t t1;
+        uint32_t reserved2;
+        int64_t sum[COLUMNS]; // Lets queries use a block without its columns
+        int32_t base[COLUMNS];
+        int32_t min[COLUMNS];
+        int32_t max[COLUMNS];
+    };
+
+    struct SegmentHeader {
+        uint32_t magic;
+        uint16_t version;
+        uint16_t blocks;
+        uint32_t sequence;
+        uint32_t t0;
+        uint32_t t1;
+        int32_t min[COLUMNS];
+        int32_t max[COLUMNS];
+    };
+
+    // Narrow columns hold percentages and temperatures, whose deltas fit in
+    // 16 bits; network rates need the full 32.
+    static uint8_t columnWidth(uint8_t column) {
+        return column >= COL_NET_UP ? 4 : 2;
+    }
+
+    static size_t columnOffset(uint8_t column) {
+        size_t offset = sizeof(BlockHeader) + BLOCK_SAMPLES * sizeof(uint16_t);
+        for (uint8_t c = 0; c < column; c++) offset += BLOCK_SAMPLES * columnWidth(c);
+        return offset;
+    }
+
+    static size_t blockBytes() { return columnOffset(COLUMNS); }
+
+    explicit StatsLog(uint16_t segmentBlocks = SEGMENT_BLOCKS, uint16_t maxSegments = MAX_SEGMENTS)
+        : _segmentBlocks(segmentBlocks), _maxSegments(maxSegments) {
+        resetBlock();
+    }
+
+    // Returns false (and stays disabled) when there is no usable card.
+    bool begin() {
+        if (!SD.exists("/stats") && !SD.mkdir("/stats")) return false;
+        _enabled = true;
+
+        File index = SD.open("/stats/index", FILE_READ);
+        if (index) {
+            uint32_t range[2];
+            if (index.read(reinterpret_cast<uint8_t*>(range), sizeof(range)) == sizeof(range) && range[0] <= range[1]) {
+                _first = range[0];
+                _last = range[1];
+            }
+            index.close();
+        }
+
+        SegmentHeader header;
+        if (!readSegmentHeader(_last, header)) {
+            startSegment(_last);
+        } else {
+            _segment = header;
+        }
+        return true;
+    }
+
+    bool isEnabled() const { return _enabled; }
+
+    void append(uint32_t time, const int32_t values[COLUMNS]) {
+        if (!_enabled) return;
+
+        BlockHeader& h = blockHeader();
+        // Time offsets are 16 bit and must not run backwards (NTP step)
+        if (h.count > 0 && (time < h.t0 || time - h.t0 > 0xFFFF)) flush();
+
+        if (h.count == 0) {
+            h.t0 = time;
+            for (uint8_t c = 0; c < COLUMNS; c++) {
+                h.base[c] = h.min[c] = h.max[c] = values[c];
+                h.sum[c] = 0;
+            }
+        }
+
+        uint16_t dt = (uint16_t)(time - h.t0);
+        memcpy(_block + sizeof(BlockHeader) + h.count * sizeof(uint16_t), &dt, sizeof(dt));
+        for (uint8_t c = 0; c < COLUMNS; c++) {
+            int32_t delta = values[c] - h.base[c];
+            uint8_t* cell = _block + columnOffset(c) + h.count * columnWidth(c);
+            if (columnWidth(c) == 2) {
+                int16_t narrow = (int16_t)clamp(delta, INT16_MIN, INT16_MAX);
+                memcpy(cell, &narrow, sizeof(narrow));
+            } else {
+                memcpy(cell, &delta, sizeof(delta));
+            }
+            if (values[c] < h.min[c]) h.min[c] = values[c];
+            if (values[c] > h.max[c]) h.max[c] = values[c];
+            h.sum[c] += values[c];
+        }
+        h.t1 = time;
+        h.count++;
+
+        if (h.count == BLOCK_SAMPLES) flush();
+    }
+
+    // Scales a Stats frame into column units.
+    static void toColumns(float cpu, uint64_t ramUsed, uint64_t ramTotal, float gpu, float thermal,
+                          uint64_t netUp, uint64_t netDown, int32_t out[COLUMNS]) {
+        out[COL_CPU] = (int32_t)(cpu * 100);
+        out[COL_RAM] = ramTotal > 0 ? (int32_t)(ramUsed * 10000 / ramTotal) : 0;
+        out[COL_GPU] = (int32_t)(gpu * 100);
+        out[COL_THERMAL] = (int32_t)(thermal * 100);
+        out[COL_NET_UP] = (int32_t)(netUp > INT32_MAX ? INT32_MAX : netUp);
+        out[COL_NET_DOWN] = (int32_t)(netDown > INT32_MAX ? INT32_MAX : netDown);
+    }
+
+    // Writes the block being filled, even if partial; the next sample starts
+    // a new block. Call before an orderly restart.
+    bool flush() {
+        BlockHeader& h = blockHeader();
+        if (!_enabled || h.count == 0) return true;
+
+        if (_segment.blocks >= _segmentBlocks) rotate();
+
+        char path[32];
+        segmentPath(_last, path, sizeof(path));
+        File file = SD.open(path, FILE_APPEND);
+        bool ok = file && file.write(_block, blockBytes()) == blockBytes();
+        file.close();
+
+        if (ok) {
+            if (_segment.blocks == 0) _segment.t0 = h.t0;
+            _segment.t1 = h.t1;
+            for (uint8_t c = 0; c < COLUMNS; c++) {
+                if (_segment.blocks == 0 || h.min[c] < _segment.min[c]) _segment.min[c] = h.min[c];
+                if (_segment.blocks == 0 || h.max[c] > _segment.max[c]) _segment.max[c] = h.max[c];
+            }
+            _segment.blocks++;
+            ok = writeSegmentHeader();
+        }
+        resetBlock();
+        return ok;
+    }
+
+    // Starts streaming a query to out, which must outlive it; stepQuery()
+    // does the reading. The reply is JSON lines, like DumpTrace:
+    // {"type":"HistoryRange","data":{"from":..,"to":..,"step":..,"columns":["cpu",...]}}
+    // {"type":"HistoryPoints","data":[[bucket start,cpu,ram,gpu,thermal,net_up,net_down],...]}  (repeated)
+    // {"type":"HistoryEnd","data":{"complete":true}}
+    // Points are bucket means over from..to (Unix seconds), up to `points`
+    // of them; empty buckets are left out. A query still running is cut
+    // short, ending with "complete":false.
+    void beginQuery(uint32_t from, uint32_t to, uint16_t points, Print& out) {
+        if (_query.active) endQuery(false);
+        if (points == 0) points = 1;
+        if (points > MAX_POINTS) points = MAX_POINTS;
+        if (to < from) to = from;
+        uint32_t step = (to - from) / points + 1;
+
+        char line[160];
+        snprintf(line, sizeof(line),
+                 "{\"type\":\"HistoryRange\",\"data\":{\"from\":%lu,\"to\":%lu,\"step\":%lu,"
+                 "\"columns\":[\"cpu\",\"ram\",\"gpu\",\"thermal\",\"net_up\",\"net_down\"]}}\n",
+                 (unsigned long)from, (unsigned long)to, (unsigned long)step);
+        out.print(line);
+
+        _query.from = from;
+        _query.to = to;
+        _query.sequence = _first;
+        _query.block = 0;
+        _query.blocks = 0;
+        _query.active = true;
+        _query.bucket.begin(from, step, out);
+    }
+
+    bool queryActive() const { return _query.active; }
+
+    // Advances the running query by at most about `reads` card reads, so a
+    // month-long range is spread over loop passes instead of stalling one.
+    // Segments and blocks outside the range are skipped by header (blocks
+    // by binary search), and blocks inside a single bucket are folded in
+    // from their header sums without reading the columns. Output ends on a
+    // line boundary so other replies can go out in between. Returns true
+    // while there is more to do.
+    bool stepQuery(uint16_t reads = QUERY_READS_PER_STEP) {
+        if (!_query.active) return false;
+
+        uint8_t* buffer = _enabled ? static_cast<uint8_t*>(malloc(blockBytes())) : nullptr;
+        while (buffer && reads > 0 && _query.sequence <= _last) {
+            char path[32];
+            segmentPath(_query.sequence, path, sizeof(path));
+            File file = SD.exists(path) ? SD.open(path, FILE_READ) : File();
+            if (_query.blocks == 0 && !(file && seekRange(file, reads))) {
+                file.close();
+                _query.sequence++;
+                continue;
+            }
+            while (reads > 0 && _query.block < _query.blocks) {
+                if (!readBlock(file, buffer, reads)) _query.block = _query.blocks;
+            }
+            file.close();
+            if (_query.block >= _query.blocks) {
+                _query.sequence++;
+                _query.blocks = 0;
+            }
+        }
+
+        bool done = !buffer || _query.sequence > _last;
+        free(buffer);
+        if (!done) {
+            _query.bucket.endLine();
+            return true;
+        }
+        if (_enabled) decode(_block, _query.from, _query.to, _query.bucket); // Samples not yet on the card
+        endQuery(true);
+        return false;
+    }
+
+    uint32_t firstSegment() const { return _first; }
+    uint32_t lastSegment() const { return _last; }
+    uint16_t pendingSamples() const { return blockHeader().count; }
+
+    static void segmentPath(uint32_t sequence, char* out, size_t size) {
+        snprintf(out, size, "/stats/%08lu.seg", (unsigned long)sequence);
+    }
+
+private:
+    class Downsampler {
+    public:
+        void begin(uint32_t from, uint32_t step, Print& out) {
+            _from = from;
+            _step = step;
+            _out = &out;
+            for (uint8_t c = 0; c < COLUMNS; c++) _sums[c] = 0;
+            _count = 0;
+            _lineCount = 0;
+        }
+
+        void add(uint32_t time, const int32_t values[COLUMNS]) {
+            start(time);
+            for (uint8_t c = 0; c < COLUMNS; c++) _sums[c] += values[c];
+            _count++;
+        }
+
+        void addSums(uint32_t time, const int64_t sums[COLUMNS], uint32_t count) {
+            start(time);
+            for (uint8_t c = 0; c < COLUMNS; c++) _sums[c] += sums[c];
+            _count += count;
+        }
+
+        bool sameBucket(uint32_t a, uint32_t b) const {
+            return (a - _from) / _step == (b - _from) / _step;
+        }
+
+        void finish() {
+            if (_count > 0) emit();
+            endLine();
+        }
+
+        // Closes the HistoryPoints line, if one is open
+        void endLine() {
+            if (_lineCount == 0) return;
+            _out->print("]}\n");
+            _lineCount = 0;
+        }
+
+        Print& out() { return *_out; }
+
+    private:
+        void start(uint32_t time) {
+            uint32_t index = (time - _from) / _step;
+            if (_count > 0 && index != _index) emit();
+            _index = index;
+        }
+
+        void emit() {
+            double mean[COLUMNS];
+            for (uint8_t c = 0; c < COLUMNS; c++) mean[c] = (double)_sums[c] / _count;
+            if (_lineCount == 0) _out->print("{\"type\":\"HistoryPoints\",\"data\":[");
+            char line[128];
+            snprintf(line, sizeof(line), "%s[%lu,%.1f,%.1f,%.1f,%.1f,%.0f,%.0f]", _lineCount > 0 ? "," : "",
+                     (unsigned long)(_from + _index * _step), mean[COL_CPU] / 100, mean[COL_RAM] / 100,
+                     mean[COL_GPU] / 100, mean[COL_THERMAL] / 100, mean[COL_NET_UP], mean[COL_NET_DOWN]);
+            _out->print(line);
+            if (++_lineCount == POINTS_PER_LINE) endLine();
+            for (uint8_t c = 0; c < COLUMNS; c++) _sums[c] = 0;
+            _count = 0;
+        }
+
+        uint32_t _from = 0;
+        uint32_t _step = 1;
+        Print* _out = nullptr;
+        uint32_t _index = 0;
+        int64_t _sums[COLUMNS] = {};
+        uint32_t _count = 0;
+        uint8_t _lineCount = 0;
+    };
+
+    // Where the running query has got to
+    struct QueryCursor {
+        uint32_t from;
+        uint32_t to;
+        uint32_t sequence; // Segment being read
+        uint16_t block;    // Next block in it
+        uint16_t blocks;   // Its block count; 0 until seekRange() found a start
+        bool active;
+        Downsampler bucket;
+    };
+
+    // Reads the segment header and binary-searches for the first block
+    // ending at or after `from`. Blocks in a segment are time-ordered
+    // unless the host clock stepped back, which at worst skips the samples
+    // logged before the step.
+    bool seekRange(File& file, uint16_t& reads) {
+        SegmentHeader header;
+        reads--;
+        if (file.read(reinterpret_cast<uint8_t*>(&header), sizeof(header)) != sizeof(header) ||
+            header.magic != MAGIC || header.version != VERSION || header.blocks == 0 ||
+            header.t1 < _query.from || header.t0 > _query.to) {
+            return false;
+        }
+
+        uint16_t lo = 0;
+        uint16_t hi = header.blocks;
+        while (lo < hi) {
+            uint16_t mid = lo + (hi - lo) / 2;
+            BlockHeader h;
+            if (reads > 0) reads--;
+            if (!readBlockHeader(file, mid, h)) return false;
+            if (h.t1 < _query.from) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+        _query.block = lo;
+        _query.blocks = header.blocks;
+        return lo < header.blocks;
+    }
+
+    // Folds the next block into the query; false once past `to` or on a
+    // read error, which ends the segment.
+    bool readBlock(File& file, uint8_t* buffer, uint16_t& reads) {
+        uint16_t b = _query.block++;
+        BlockHeader h;
+        reads--;
+        if (!readBlockHeader(file, b, h)) return false;
+        if (h.t0 > _query.to) return false;
+        if (h.count == 0 || h.t1 < _query.from) return true;
+
+        if (h.t0 >= _query.from && h.t1 <= _query.to && _query.bucket.sameBucket(h.t0, h.t1)) {
+            _query.bucket.addSums(h.t0, h.sum, h.count);
+            return true;
+        }
+        if (reads > 0) reads--;
+        file.seek(sizeof(SegmentHeader) + (size_t)b * blockBytes());
+        if (file.read(buffer, blockBytes()) != blockBytes()) return false;
+        decode(buffer, _query.from, _query.to, _query.bucket);
+        return true;
+    }
+
+    static bool readBlockHeader(File& file, uint16_t block, BlockHeader& h) {
+        file.seek(sizeof(SegmentHeader) + (size_t)block * blockBytes());
+        return file.read(reinterpret_cast<uint8_t*>(&h), sizeof(h)) == sizeof(h);
+    }
+
+    void endQuery(bool complete) {
+        _query.bucket.finish();
+        _query.bucket.out().print(complete ? "{\"type\":\"HistoryEnd\",\"data\":{\"complete\":true}}\n"
+                                           : "{\"type\":\"HistoryEnd\",\"data\":{\"complete\":false}}\n");
+        _query.active = false;
+    }
+
+    template <typename Sink>
+    static void decode(const uint8_t* block, uint32_t from, uint32_t to, Sink& sink) {
+        BlockHeader h;
+        memcpy(&h, block, sizeof(h));
+        if (h.count == 0 || h.count > BLOCK_SAMPLES || h.t1 < from || h.t0 > to) return;
+
+        for (uint16_t i = 0; i < h.count; i++) {
+            uint16_t dt;
+            memcpy(&dt, block + sizeof(BlockHeader) + i * sizeof(uint16_t), sizeof(dt));
+            uint32_t time = h.t0 + dt;
+            if (time < from || time > to) continue;
+
+            int32_t values[COLUMNS];
+            for (uint8_t c = 0; c < COLUMNS; c++) {
+                const uint8_t* cell = block + columnOffset(c) + i * columnWidth(c);
+                int32_t delta;
+                if (columnWidth(c) == 2) {
+                    int16_t narrow;
+                    memcpy(&narrow, cell, sizeof(narrow));
+                    delta = narrow;
+                } else {
+                    memcpy(&delta, cell, sizeof(delta));
+                }
+                values[c] = h.base[c] + delta;
+            }
+            sink.add(time, values);
+        }
+    }
+
+    static int32_t clamp(int32_t v, int32_t lo, int32_t hi) {
+        return v < lo ? lo : (v > hi ? hi : v);
+    }
+
+    BlockHeader& blockHeader() { return *reinterpret_cast<BlockHeader*>(_block); }
+    const BlockHeader& blockHeader() const { return *reinterpret_cast<const BlockHeader*>(_block); }
+
+    void resetBlock() {
+        memset(_block, 0, sizeof(_block));
+    }
+
+    void rotate() {
+        _last++;
+        while (_last - _first + 1 > _maxSegments) {
+            char path[32];
+            segmentPath(_first, path, sizeof(path));
+            SD.remove(path);
+            _first++;
+        }
+        startSegment(_last);
+        writeIndex();
+    }
+
+    void startSegment(uint32_t sequence) {
+        memset(&_segment, 0, sizeof(_segment));
+        _segment.magic = MAGIC;
+        _segment.version = VERSION;
+        _segment.sequence = sequence;
+
+        char path[32];
+        segmentPath(sequence, path, sizeof(path));
+        File file = SD.open(path, FILE_WRITE);
+        if (file) {
+            file.write(reinterpret_cast<const uint8_t*>(&_segment), sizeof(_segment));
+            file.close();
+        }
+    }
+
+    bool writeSegmentHeader() {
+        char path[32];
+        segmentPath(_last, path, sizeof(path));
+        File file = SD.open(path, "r+");
+        if (!file) return false;
+        file.seek(0);
+        bool ok = file.write(reinterpret_cast<const uint8_t*>(&_segment), sizeof(_segment)) == sizeof(_segment);
+        file.close();
+        return ok;
+    }
+
+    bool readSegmentHeader(uint32_t sequence, SegmentHeader& header) {
+        char path[32];
+        segmentPath(sequence, path, sizeof(path));
+        if (!SD.exists(path)) return false;
+        File file = SD.open(path, FILE_READ);
+        bool ok = file && file.read(reinterpret_cast<uint8_t*>(&header), sizeof(header)) == sizeof(header) &&
+            header.magic == MAGIC && header.version == VERSION;
+        file.close();
+        return ok;
+    }
+
+    void writeIndex() {
+        File index = SD.open("/stats/index", FILE_WRITE);
+        if (!index) return;
+        uint32_t range[2] = { _first, _last };
+        index.write(reinterpret_cast<const uint8_t*>(range), sizeof(range));
+        index.close();
+    }
+
+    // Header plus columns; see columnOffset()
+    alignas(BlockHeader) uint8_t _block[sizeof(BlockHeader) + BLOCK_SAMPLES * (sizeof(uint16_t) + 4 * 2 + 2 * 4)];
+    uint16_t _segmentBlocks;
+    uint16_t _maxSegments;
+    SegmentHeader _segment = {};
+    uint32_t _first = 0;
+    uint32_t _last = 0;
+    bool _enabled = false;
+    QueryCursor _query = {};
+};
+
+#endif
@@ -6,6 +6,7 @@
 #include <SPI.h>
 #include <ArduinoJson.h>
 #include <mbedtls/base64.h>
+#include "Trace.h"
 
 #define SD_SCK 19
 #define SD_MOSI 18
@@ -86,6 +87,7 @@ public:
     bool handleWriteChunk(JsonObject data) {
         String path = data["path"];
         size_t offset = data["offset"];
+        TRACE_SCOPE(TRACE_SYNC_CHUNK, offset);
         String b64data = data["data"];
         
         size_t b64len = b64data.length();
@@ -0,0 +1,59 @@
+#ifndef TELEMETRY_FRAME_H
+#define TELEMETRY_FRAME_H
+
+#include <ArduinoJson.h>
+#include "DisplayManager.h"
+
+/*
+ * Applies Identity and Stats frames to a SystemState. Shared by the USB
+ * serial path and the UDP listener so both accept exactly the same fields.
+ */
+
+inline uint32_t bytesToMiB(uint64_t bytes) {
+    return (uint32_t)(bytes >> 20);
+}
+
+inline uint32_t clampU32(uint64_t value) {
+    return value > UINT32_MAX ? UINT32_MAX : (uint32_t)value;
+}
+
+inline void applyIdentity(SystemState& state, JsonObject data) {
+    state.hostname = data["hostname"] | "";
+    state.ip = data["ip"] | "";
+    state.mac = data["mac"] | "";
+    state.os = data["os"] | "";
+    state.user = data["user"] | "";
+    state.has_data = true;
+    state.connected = true;
+}
+
+inline void applyStats(SystemState& state, JsonObject data) {
+    state.cpu_percent = data["cpu_percent"];
+    state.ram_used_mb = bytesToMiB(data["ram_used"].as<uint64_t>());
+    state.ram_total_mb = bytesToMiB(data["ram_total"].as<uint64_t>());
+    state.disk_used_mb = bytesToMiB(data["disk_used"].as<uint64_t>());
+    state.disk_total_mb = bytesToMiB(data["disk_total"].as<uint64_t>());
+    state.net_up = clampU32(data["net_up"].as<uint64_t>());
+    state.net_down = clampU32(data["net_down"].as<uint64_t>());
+    state.uptime = clampU32(data["uptime"].as<uint64_t>());
+    state.thermal_c = data["thermal_c"];
+    state.gpu_percent = data["gpu_percent"];
+    state.alert_level = data["alert_level"].as<uint8_t>();
+    state.has_data = true;
+    state.connected = true;
+}
+
+// Returns false for frame types other than Identity and Stats
+inline bool applyTelemetry(SystemState& state, const char* type, JsonObject data) {
+    if (!type) return false;
+    if (strcmp(type, "Identity") == 0) {
+        applyIdentity(state, data);
+    } else if (strcmp(type, "Stats") == 0) {
+        applyStats(state, data);
+    } else {
+        return false;
+    }
+    return true;
+}
+
+#endif
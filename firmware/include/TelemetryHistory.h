@@ -0,0 +1,304 @@
+#ifndef TELEMETRY_HISTORY_H
+#define TELEMETRY_HISTORY_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "HistoryBuffer.h" // HistoryIndex
+
+/*
+ * Multi-resolution history for the host metrics.
+ *
+ * Each series keeps three tiers: 60 x 1 s, 60 x 1 min and 48 x 30 min, i.e.
+ * a minute, an hour and a day of trend. Every slot stores the min, max and
+ * mean of the samples that fell into it. Samples go into the open bucket of
+ * the finest tier; when a bucket's period has elapsed it is closed, stored
+ * and folded into the next tier's open bucket, so a push costs O(1).
+ *
+ * Buckets are closed by the first sample after their period, so gaps (host
+ * disconnected) are collapsed rather than filled with empty slots.
+ */
+
+enum GraphRange : uint8_t {
+    RANGE_MINUTE = 0, // 60 x 1 s
+    RANGE_HOUR,       // 60 x 1 min
+    RANGE_DAY,        // 48 x 30 min
+    NUM_RANGES
+};
+
+struct Rollup {
+    float min;
+    float max;
+    float mean;
+};
+
+// Aggregate of a bucket that is still filling
+struct RollupBucket {
+    float min;
+    float max;
+    double sum;
+    uint32_t count;
+};
+
+// Closed buckets are kept as plain {min, max, mean} slots; only the peak
+// the graphs scale to is tracked incrementally, in a monotonic queue of
+// slot indices.
+template <size_t Size>
+class RollupTier {
+    static_assert(Size > 0 && Size <= 255, "RollupTier slots are indexed with uint8_t");
+
+public:
+    explicit RollupTier(unsigned long period) : _period(period) {}
+
+    // Folds an aggregate into the open bucket. If the open bucket's period
+    // had already elapsed it is stored first and returned through closed,
+    // and the aggregate starts a new bucket.
+    bool add(const RollupBucket& in, unsigned long now, RollupBucket& closed) {
+        bool didClose = false;
+        if (_open.count > 0 && now - _start >= _period) {
+            Rollup r = { _open.min, _open.max, (float)(_open.sum / _open.count) };
+            store(r);
+            closed = _open;
+            _open.count = 0;
+            didClose = true;
+        }
+
+        if (_open.count == 0) {
+            // Stay on the period grid while samples keep coming so jitter
+            // in the host interval doesn't drift the buckets
+            bool contiguous = didClose && now - _start < 2 * _period;
+            _start = contiguous ? _start + _period : now;
+            _open = in;
+        } else {
+            if (in.min < _open.min) _open.min = in.min;
+            if (in.max > _open.max) _open.max = in.max;
+            _open.sum += in.sum;
+            _open.count += in.count;
+        }
+        return didClose;
+    }
+
+    // Closed buckets plus the one still filling, newest last, capped at Size.
+    size_t count() const {
+        size_t n = _count + (_open.count > 0 ? 1 : 0);
+        return n < Size ? n : Size;
+    }
+
+    Rollup get(size_t index) const {
+        size_t total = _count + (_open.count > 0 ? 1 : 0);
+        size_t pos = total - count() + index;
+        if (pos < _count) return slot(pos);
+        if (_open.count == 0) {
+            Rollup empty = { 0, 0, 0 };
+            return empty;
+        }
+        Rollup r = { _open.min, _open.max, (float)(_open.sum / _open.count) };
+        return r;
+    }
+
+    // Largest max over the stored buckets and the open one. Once the tier
+    // is full this can include the bucket just scrolled out of view, which
+    // only matters for the scale of one frame.
+    float peak() const {
+        if (_count == 0) return _open.count > 0 ? _open.max : 0;
+        float stored = _slots[_peakQueue[_peakFront]].max;
+        return _open.count > 0 && _open.max > stored ? _open.max : stored;
+    }
+
+    unsigned long period() const { return _period; }
+
+    void clear() {
+        _head = 0;
+        _count = 0;
+        _peakFront = 0;
+        _peakLength = 0;
+        _open.count = 0;
+    }
+
+    // Snapshot support: the stored buckets oldest first, then the open one.
+    // Out only needs put(const void*, size_t); in needs get(void*, size_t).
+    template <typename Writer>
+    void save(Writer& out) const {
+        uint16_t n = _count;
+        out.put(&n, sizeof(n));
+        for (size_t i = 0; i < n; i++) {
+            Rollup r = slot(i);
+            float values[3] = { r.min, r.max, r.mean };
+            out.put(values, sizeof(values));
+        }
+        out.put(&_open.min, sizeof(_open.min));
+        out.put(&_open.max, sizeof(_open.max));
+        out.put(&_open.sum, sizeof(_open.sum));
+        out.put(&_open.count, sizeof(_open.count));
+    }
+
+    // The open bucket restarts its period at now, as after a gap.
+    template <typename Reader>
+    bool load(Reader& in, unsigned long now) {
+        uint16_t n = 0;
+        clear();
+        if (!in.get(&n, sizeof(n)) || n > Size) return false;
+        for (size_t i = 0; i < n; i++) {
+            float values[3];
+            if (!in.get(values, sizeof(values))) return false;
+            Rollup r = { values[0], values[1], values[2] };
+            store(r);
+        }
+        RollupBucket open;
+        if (!in.get(&open.min, sizeof(open.min)) || !in.get(&open.max, sizeof(open.max)) ||
+            !in.get(&open.sum, sizeof(open.sum)) || !in.get(&open.count, sizeof(open.count))) {
+            return false;
+        }
+        _open = open;
+        _start = now;
+        return true;
+    }
+
+private:
+    typedef HistoryIndex<Size> Index;
+
+    Rollup slot(size_t pos) const {
+        return _slots[Index::wrap(_head + (Size - _count) + pos)];
+    }
+
+    void store(const Rollup& r) {
+        if (_count == Size && _peakQueue[_peakFront] == _head) {
+            // The peak is about to be overwritten
+            _peakFront = (uint8_t)Index::wrap(_peakFront + 1);
+            _peakLength--;
+        }
+        while (_peakLength > 0 && _slots[_peakQueue[Index::wrap(_peakFront + _peakLength - 1)]].max <= r.max) {
+            _peakLength--;
+        }
+
+        _slots[_head] = r;
+        _peakQueue[Index::wrap(_peakFront + _peakLength)] = _head;
+        _peakLength++;
+
+        _head = (uint8_t)Index::wrap(_head + 1);
+        if (_count < Size) _count++;
+    }
+
+    Rollup _slots[Size];
+    uint8_t _peakQueue[Size];
+    uint8_t _head = 0;
+    uint8_t _count = 0;
+    uint8_t _peakFront = 0;
+    uint8_t _peakLength = 0;
+    RollupBucket _open = { 0, 0, 0, 0 };
+    unsigned long _start = 0;
+    unsigned long _period;
+};
+
+class RollupSeries {
+public:
+    static const size_t SECONDS = 60;
+    static const size_t MINUTES = 60;
+    static const size_t HALF_HOURS = 48;
+
+    RollupSeries() : _seconds(1000UL), _minutes(60UL * 1000), _halfHours(30UL * 60 * 1000) {}
+
+    void push(float value, unsigned long now) {
+        RollupBucket sample = { value, value, value, 1 };
+        RollupBucket second, minute, halfHour;
+        if (!_seconds.add(sample, now, second)) return;
+        if (!_minutes.add(second, now, minute)) return;
+        _halfHours.add(minute, now, halfHour);
+    }
+
+    size_t count(GraphRange range) const {
+        switch (range) {
+            case RANGE_HOUR: return _minutes.count();
+            case RANGE_DAY: return _halfHours.count();
+            default: return _seconds.count();
+        }
+    }
+
+    size_t capacity(GraphRange range) const {
+        switch (range) {
+            case RANGE_HOUR: return MINUTES;
+            case RANGE_DAY: return HALF_HOURS;
+            default: return SECONDS;
+        }
+    }
+
+    Rollup get(GraphRange range, size_t index) const {
+        switch (range) {
+            case RANGE_HOUR: return _minutes.get(index);
+            case RANGE_DAY: return _halfHours.get(index);
+            default: return _seconds.get(index);
+        }
+    }
+
+    // Largest max in the tier, used to scale graphs.
+    float peak(GraphRange range) const {
+        switch (range) {
+            case RANGE_HOUR: return _minutes.peak();
+            case RANGE_DAY: return _halfHours.peak();
+            default: return _seconds.peak();
+        }
+    }
+
+    void clear() {
+        _seconds.clear();
+        _minutes.clear();
+        _halfHours.clear();
+    }
+
+    template <typename Writer>
+    void save(Writer& out) const {
+        _seconds.save(out);
+        _minutes.save(out);
+        _halfHours.save(out);
+    }
+
+    template <typename Reader>
+    bool load(Reader& in, unsigned long now) {
+        return _seconds.load(in, now) && _minutes.load(in, now) && _halfHours.load(in, now);
+    }
+
+private:
+    RollupTier<SECONDS> _seconds;
+    RollupTier<MINUTES> _minutes;
+    RollupTier<HALF_HOURS> _halfHours;
+};
+
+// Rates are stored as float: bytes/s only need three significant digits on a
+// 220 px graph, and it keeps every series the same size.
+struct TelemetryHistory {
+    RollupSeries net_up;
+    RollupSeries net_down;
+    RollupSeries cpu_percent;
+    RollupSeries ram_percent;
+    RollupSeries thermal_c;
+
+    static const uint16_t SERIES = 5;
+
+    void clear() {
+        net_up.clear();
+        net_down.clear();
+        cpu_percent.clear();
+        ram_percent.clear();
+        thermal_c.clear();
+    }
+
+    template <typename Writer>
+    void save(Writer& out) const {
+        net_up.save(out);
+        net_down.save(out);
+        cpu_percent.save(out);
+        ram_percent.save(out);
+        thermal_c.save(out);
+    }
+
+    template <typename Reader>
+    bool load(Reader& in, unsigned long now) {
+        return net_up.load(in, now) && net_down.load(in, now) && cpu_percent.load(in, now) &&
+            ram_percent.load(in, now) && thermal_c.load(in, now);
+    }
+};
+
+// Five series of a day's trend is meant to cost a few KB of RAM, not a
+// screen buffer's worth.
+static_assert(sizeof(TelemetryHistory) <= 12 * 1024, "TelemetryHistory is over its 12 KB budget");
+
+#endif
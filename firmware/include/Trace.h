@@ -0,0 +1,166 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <Arduino.h>
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+// What happened. Spans record a begin and an end event with the same ID;
+// the rest are instants.
+enum TraceId : uint16_t {
+    TRACE_HANDLE_JSON,   // span, arg = frame length in bytes
+    TRACE_SYNC_CHUNK,    // span, arg = chunk offset
+    TRACE_DRAW_STATIC,   // span, arg = page
+    TRACE_DRAW_VALUES,   // span, arg = page
+    TRACE_DRAW_BANNER,   // span, arg = alert level
+    TRACE_DISCOVERY,     // span, arg = number of configs
+    TRACE_MQTT_PHASE,    // instant, arg = new MqttPhase
+    TRACE_WIFI_PHASE,    // instant, arg = new WifiPhase
+    TRACE_PUBLISH,       // instant, arg = topic index
+    NUM_TRACE_IDS
+};
+
+enum TraceKind : uint8_t {
+    TRACE_KIND_BEGIN,
+    TRACE_KIND_END,
+    TRACE_KIND_INSTANT
+};
+
+// 12 bytes; timestamps are micros() and wrap after ~71 minutes
+struct TraceEvent {
+    uint32_t timestamp;
+    uint16_t id;
+    uint8_t kind;
+    uint8_t reserved;
+    uint32_t arg;
+};
+
+static_assert(sizeof(TraceEvent) == 12, "TraceEvent must stay 12 bytes");
+
+/*
+ * Fixed-size ring of the most recent trace events. Recording claims a slot
+ * with one atomic increment and never blocks, so it is safe from any task;
+ * once full, the oldest events are overwritten. An event being written
+ * while the ring is dumped may come out torn, which the trace tolerates.
+ *
+ * DumpTrace streams it as JSON lines, oldest first:
+ * {"type":"TraceInfo","data":{"events":512,"recorded":9120,"names":["handle_json",...]}}
+ * {"type":"Trace","data":[[timestamp_us,id,"B",arg],...]}   (repeated)
+ * {"type":"TraceEnd"}
+ * scripts/trace_to_chrome.py turns that into Chrome/Perfetto trace JSON.
+ */
+template <uint16_t Capacity>
+class TraceRing {
+    static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+    static const uint8_t EVENTS_PER_LINE = 16;
+
+    TraceRing() : _next(0) {}
+
+    void record(TraceId id, TraceKind kind, uint32_t arg, uint32_t timestamp) {
+        uint32_t index = _next.fetch_add(1, std::memory_order_relaxed);
+        TraceEvent& event = _events[index & (Capacity - 1)];
+        event.timestamp = timestamp;
+        event.id = id;
+        event.kind = kind;
+        event.reserved = 0;
+        event.arg = arg;
+    }
+
+    void record(TraceId id, TraceKind kind, uint32_t arg) { record(id, kind, arg, micros()); }
+
+    // Events ever recorded, including overwritten ones
+    uint32_t recorded() const { return _next.load(std::memory_order_relaxed); }
+    uint16_t size() const { return recorded() < Capacity ? recorded() : Capacity; }
+    uint16_t capacity() const { return Capacity; }
+
+    // i = 0 is the oldest event still held
+    const TraceEvent& at(uint16_t i) const {
+        uint32_t next = recorded();
+        uint32_t first = next < Capacity ? 0 : next - Capacity;
+        return _events[(first + i) & (Capacity - 1)];
+    }
+
+    void clear() { _next.store(0, std::memory_order_relaxed); }
+
+    static const char* name(uint16_t id) {
+        static const char* const names[NUM_TRACE_IDS] = {
+            "handle_json", "sync_chunk", "draw_static", "draw_values", "draw_banner",
+            "discovery", "mqtt_phase", "wifi_phase", "publish"
+        };
+        return id < NUM_TRACE_IDS ? names[id] : "unknown";
+    }
+
+    template <typename Out>
+    void dump(Out& out) const {
+        // Snapshot the bounds so events recorded mid-dump don't shift the window
+        uint32_t next = recorded();
+        uint16_t count = next < Capacity ? next : Capacity;
+        uint32_t first = next - count;
+
+        char chunk[96];
+        snprintf(chunk, sizeof(chunk), "{\"type\":\"TraceInfo\",\"data\":{\"events\":%u,\"recorded\":%lu,\"names\":[",
+                 (unsigned)count, (unsigned long)next);
+        out.print(chunk);
+        for (uint16_t id = 0; id < NUM_TRACE_IDS; id++) {
+            snprintf(chunk, sizeof(chunk), "%s\"%s\"", id > 0 ? "," : "", name(id));
+            out.print(chunk);
+        }
+        out.print("]}}\n");
+
+        static const char kinds[] = {'B', 'E', 'i'};
+        for (uint16_t i = 0; i < count; i++) {
+            const TraceEvent& event = _events[(first + i) & (Capacity - 1)];
+            if (i % EVENTS_PER_LINE == 0) out.print("{\"type\":\"Trace\",\"data\":[");
+            snprintf(chunk, sizeof(chunk), "%s[%lu,%u,\"%c\",%lu]", i % EVENTS_PER_LINE ? "," : "",
+                     (unsigned long)event.timestamp, (unsigned)event.id,
+                     event.kind < sizeof(kinds) ? kinds[event.kind] : 'i', (unsigned long)event.arg);
+            out.print(chunk);
+            if (i % EVENTS_PER_LINE == EVENTS_PER_LINE - 1 || i == count - 1) out.print("]}\n");
+        }
+        out.print("{\"type\":\"TraceEnd\"}\n");
+    }
+
+private:
+    TraceEvent _events[Capacity];
+    std::atomic<uint32_t> _next;
+};
+
+// Instrumentation compiles to nothing unless SIDEEYE_TRACE is defined; the
+// ring itself only exists in trace builds.
+#ifdef SIDEEYE_TRACE
+
+#ifndef SIDEEYE_TRACE_EVENTS
+#define SIDEEYE_TRACE_EVENTS 512
+#endif
+
+typedef TraceRing<SIDEEYE_TRACE_EVENTS> TraceBuffer;
+
+// The firmware-wide ring, shared by every module that includes this header
+inline TraceBuffer& traceBuffer() {
+    static TraceBuffer buffer;
+    return buffer;
+}
+
+// Records a begin event now and the matching end when the scope exits
+class TraceScope {
+public:
+    TraceScope(TraceId id, uint32_t arg) : _id(id), _arg(arg) { traceBuffer().record(_id, TRACE_KIND_BEGIN, _arg); }
+    ~TraceScope() { traceBuffer().record(_id, TRACE_KIND_END, _arg); }
+
+private:
+    TraceId _id;
+    uint32_t _arg;
+};
+
+#define TRACE_SCOPE(id, arg) TraceScope traceScope_((id), (arg))
+#define TRACE_INSTANT(id, arg) traceBuffer().record((id), TRACE_KIND_INSTANT, (arg))
+#else
+#define TRACE_SCOPE(id, arg) do {} while (0)
+#define TRACE_INSTANT(id, arg) do {} while (0)
+#endif
+
+#endif
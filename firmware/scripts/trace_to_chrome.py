@@ -0,0 +1,69 @@
+#!/usr/bin/env python3
+"""Converts a DumpTrace capture into Chrome/Perfetto trace JSON.
+
+Capture the serial lines the firmware prints for {"type": "DumpTrace"}
+(built with -D SIDEEYE_TRACE), then:
+
+    python3 trace_to_chrome.py capture.log > trace.json
+
+and open trace.json in chrome://tracing or https://ui.perfetto.dev.
+Lines that aren't trace output are ignored, so a raw monitor log works.
+"""
+
+import json
+import sys
+
+PHASES = {"B": "B", "E": "E", "i": "i"}
+
+
+def convert(lines):
+    names = []
+    events = []
+    last = None
+    offset = 0
+    for line in lines:
+        line = line.strip()
+        if not line.startswith("{"):
+            continue
+        try:
+            frame = json.loads(line)
+        except ValueError:
+            continue
+        kind = frame.get("type")
+        if kind == "TraceInfo":
+            names = frame["data"]["names"]
+            last = None
+            offset = 0
+        elif kind == "Trace":
+            for timestamp, event_id, phase, arg in frame["data"]:
+                # micros() wraps every 2^32 us; keep the timeline monotonic
+                if last is not None and timestamp < last:
+                    offset += 1 << 32
+                last = timestamp
+                name = names[event_id] if event_id < len(names) else "event_%d" % event_id
+                event = {
+                    "name": name,
+                    "ph": PHASES.get(phase, "i"),
+                    "ts": timestamp + offset,
+                    "pid": 1,
+                    "tid": 1,
+                    "args": {"arg": arg},
+                }
+                if event["ph"] == "i":
+                    event["s"] = "t"
+                events.append(event)
+    return {"traceEvents": events, "displayTimeUnit": "ms"}
+
+
+def main():
+    if len(sys.argv) > 1:
+        with open(sys.argv[1]) as f:
+            trace = convert(f)
+    else:
+        trace = convert(sys.stdin)
+    json.dump(trace, sys.stdout)
+    sys.stdout.write("\n")
+
+
+if __name__ == "__main__":
+    main()
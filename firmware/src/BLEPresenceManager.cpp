@@ -1,20 +1,128 @@
 #include "BLEPresenceManager.h"
 #include "NetworkManager.h"
+#include <LittleFS.h>
+#include <ctype.h>
 
 #define SERVICE_UUID        "4fafc201-1fb5-459e-8fcc-c5c9c331914b"
 #define CHARACTERISTIC_UUID "beb5483e-36e1-4688-b7f5-ea07361b26a8"
 
+const char* const BLEPresenceManager::TARGETS_PATH = "/presence.json";
+
+// Hex bytes, optionally separated by ':', '-' or spaces
+static bool parseHex(const char* text, uint8_t* out, size_t length) {
+    size_t n = 0;
+    for (const char* p = text; *p;) {
+        if (*p == ':' || *p == '-' || *p == ' ') {
+            p++;
+            continue;
+        }
+        if (n >= length || !isxdigit((unsigned char)p[0]) || !isxdigit((unsigned char)p[1])) return false;
+        char byte[3] = {p[0], p[1], 0};
+        out[n++] = (uint8_t)strtoul(byte, nullptr, 16);
+        p += 2;
+    }
+    return n == length;
+}
+
 BLEPresenceManager::BLEPresenceManager() {}
 
 void BLEPresenceManager::begin(const char* deviceId) {
     BLEDevice::init(String("SideEye-" + String(deviceId)).c_str());
     setupServer(deviceId);
     
+    // Passive: presence only needs advertisements, not scan responses
     _pBLEScan = BLEDevice::getScan();
     _pBLEScan->setAdvertisedDeviceCallbacks(this);
-    _pBLEScan->setActiveScan(true);
-    _pBLEScan->setInterval(100);
-    _pBLEScan->setWindow(99);
+    _pBLEScan->setActiveScan(false);
+    _pBLEScan->setInterval(SCAN_INTERVAL_MS);
+    _pBLEScan->setWindow(SCAN_WINDOW_MS);
+
+    loadTargets();
+}
+
+bool BLEPresenceManager::configure(JsonObject data) {
+    PresenceTracker tracker = _tracker;
+    bool enabled = false;
+    if (!applyTargets(data, tracker, enabled)) return false;
+    _tracker = tracker;
+    setEnabled(false); // Restart scanning with the new targets
+    setEnabled(enabled);
+    return saveTargets();
+}
+
+bool BLEPresenceManager::applyTargets(JsonObject data, PresenceTracker& tracker, bool& enabled) const {
+    // Checked at full width so an out-of-range value can't wrap into a valid one
+    PresenceTracker::Settings settings = tracker.settings();
+    long enterRssi = data["enter_rssi"] | (long)settings.enterRssi;
+    long exitRssi = data["exit_rssi"] | (long)settings.exitRssi;
+    long windowMs = data["window_ms"] | (long)settings.windowMs;
+    long periodMs = data["period_ms"] | (long)settings.searchPeriodMs;
+    if (enterRssi < -127 || enterRssi > 0 || exitRssi < -127 || exitRssi > 0 || enterRssi <= exitRssi) return false;
+    if (windowMs <= 0 || periodMs <= 0 || windowMs > periodMs || periodMs > (long)settings.maxPeriodMs) return false;
+    settings.enterRssi = (int8_t)enterRssi;
+    settings.exitRssi = (int8_t)exitRssi;
+    settings.windowMs = (uint16_t)windowMs;
+    settings.searchPeriodMs = (uint16_t)periodMs;
+    tracker.setSettings(settings);
+    tracker.clearTargets();
+
+    for (JsonVariant mac : data["macs"].as<JsonArray>()) {
+        uint8_t address[6];
+        if (!parseHex(mac | "", address, sizeof(address)) || !tracker.addMac(address)) return false;
+    }
+    // What saveTargets() writes instead of the addresses themselves
+    for (JsonVariant hash : data["mac_hashes"].as<JsonArray>()) {
+        if (!tracker.addMacHash(strtoul(hash | "", nullptr, 16))) return false;
+    }
+    for (JsonVariant irk : data["irks"].as<JsonArray>()) {
+        uint8_t key[16];
+        if (!parseHex(irk | "", key, sizeof(key)) || !tracker.addIrk(key)) return false;
+    }
+    enabled = (data["enabled"] | true) && tracker.hasTargets();
+    return true;
+}
+
+void BLEPresenceManager::loadTargets() {
+    if (!LittleFS.exists(TARGETS_PATH)) return;
+    File file = LittleFS.open(TARGETS_PATH, "r");
+    if (!file) return;
+    JsonDocument doc;
+    DeserializationError error = deserializeJson(doc, file);
+    file.close();
+    bool enabled = false;
+    PresenceTracker tracker = _tracker;
+    if (!error && applyTargets(doc.as<JsonObject>(), tracker, enabled)) {
+        _tracker = tracker;
+        setEnabled(enabled);
+    }
+}
+
+bool BLEPresenceManager::saveTargets() const {
+    JsonDocument doc;
+    const PresenceTracker::Settings& settings = _tracker.settings();
+    doc["enabled"] = _enabled;
+    doc["enter_rssi"] = settings.enterRssi;
+    doc["exit_rssi"] = settings.exitRssi;
+    doc["window_ms"] = settings.windowMs;
+    doc["period_ms"] = settings.searchPeriodMs;
+    JsonArray hashes = doc["mac_hashes"].to<JsonArray>();
+    for (uint8_t i = 0; i < _tracker.macCount(); i++) {
+        char hex[9];
+        snprintf(hex, sizeof(hex), "%08lx", (unsigned long)_tracker.macHashAt(i));
+        hashes.add(hex);
+    }
+    JsonArray irks = doc["irks"].to<JsonArray>();
+    for (uint8_t i = 0; i < _tracker.irkCount(); i++) {
+        char hex[33];
+        for (uint8_t b = 0; b < 16; b++) snprintf(hex + b * 2, 3, "%02x", _tracker.irkAt(i)[b]);
+        irks.add(hex);
+    }
+
+    File file = LittleFS.open(TARGETS_PATH, "w");
+    if (!file) return false;
+    bool ok = serializeJson(doc, file) > 0;
+    file.close();
+    return ok;
 }
 
 void BLEPresenceManager::setupServer(const char* deviceId) {
@@ -39,42 +147,61 @@ void BLEPresenceManager::setEnabled(bool enabled) {
         startScan();
     } else {
         stopScan();
-        _present = false;
+        _tracker.reset();
     }
 }
 
+// Windows are opened and closed from update(), so the scan itself runs
+// until stopped
 void BLEPresenceManager::startScan() {
-    if (_pBLEScan) {
-        _pBLEScan->start(0, nullptr, false);
+    if (_pBLEScan && !_scanning) {
+        _scanning = _pBLEScan->start(0, nullptr, false);
     }
 }
 
 void BLEPresenceManager::stopScan() {
-    if (_pBLEScan) {
+    if (_pBLEScan && _scanning) {
         _pBLEScan->stop();
+        _pBLEScan->clearResults();
     }
+    _scanning = false;
 }
 
+// The tracker is only touched from the loop; if the queue is full the loop
+// is stalled and a later advertisement will do
 void BLEPresenceManager::onResult(BLEAdvertisedDevice advertisedDevice) {
-    _lastSeen = millis();
-    _present = true;
+    if (!advertisedDevice.haveRSSI()) return;
+    Sighting sighting;
+    memcpy(sighting.address, *advertisedDevice.getAddress().getNative(), sizeof(sighting.address));
+    int rssi = advertisedDevice.getRSSI();
+    sighting.rssi = rssi < -128 ? -128 : (rssi > 127 ? 127 : rssi);
+    sighting.at = millis();
+    _sightings.push(sighting);
 }
 
 void BLEPresenceManager::update(SideEyeNetworkManager& network, SystemState& state) {
+    // Drained even while disabled so the queue holds nothing stale
+    Sighting sighting;
+    while (_sightings.pop(sighting)) {
+        if (_enabled) _tracker.observe(sighting.address, sighting.rssi, sighting.at);
+    }
     if (!_enabled) return;
 
-    // Presence smoothing / timeout
-    if (_present && (millis() - _lastSeen > PRESENCE_TIMEOUT)) {
-        _present = false;
+    // Duty cycle: the radio only listens during the tracker's scan windows
+    if (_tracker.update(millis())) {
+        startScan();
+    } else {
+        stopScan();
     }
 
     // Only send serial message and MQTT update on state change
-    if (_present != _lastSentPresence) {
-        _lastSentPresence = _present;
+    bool present = _tracker.present();
+    if (present != _lastSentPresence) {
+        _lastSentPresence = present;
         
         // Serial message
         Serial.print("{\"type\": \"Presence\", \"data\": {\"status\": ");
-        Serial.print(_present ? "true" : "false");
+        Serial.print(present ? "true" : "false");
         Serial.println("}}");
 
         // MQTT update
@@ -82,16 +209,15 @@ void BLEPresenceManager::update(SideEyeNetworkManager& network, SystemState& sta
     }
 
     // Update BLE characteristic
-    static unsigned long lastNotify = 0;
-    if (_pPresenceCharacteristic && millis() - lastNotify > 1000) {
-        uint8_t val = _present ? 1 : 0;
+    if (_pPresenceCharacteristic && millis() - _lastNotify > 1000) {
+        uint8_t val = present ? 1 : 0;
         _pPresenceCharacteristic->setValue(&val, 1);
         _pPresenceCharacteristic->notify();
-        lastNotify = millis();
+        _lastNotify = millis();
     }
 }
 
 const char* BLEPresenceManager::getStatusString() const {
     if (!_enabled) return "Disabled";
-    return _present ? "Present" : "Scanning";
+    return _tracker.present() ? "Present" : "Scanning";
 }
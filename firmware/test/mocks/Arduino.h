@@ -3,6 +3,8 @@
 #include <iostream>
 #include <string>
 #include <cstdio>
+#include <cstdarg>
+#include <cstring>
 
 #define HIGH 1
 #define LOW 0
@@ -13,8 +15,11 @@
 #define FSPI 1
 
 extern unsigned long _mock_millis;
+extern size_t _mock_allocations;
 inline unsigned long millis() { return _mock_millis; }
+inline unsigned long micros() { return _mock_millis * 1000; }
 inline void delay(unsigned long ms) { _mock_millis += ms; }
+inline void yield() {}
 
 extern int _mock_digitalRead_val;
 inline int digitalRead(uint8_t pin) { return _mock_digitalRead_val; }
@@ -28,6 +33,16 @@ inline void analogWrite(uint8_t pin, int val) {
     _mock_analogWrite_val = val;
 }
 
+extern int _mock_ledcFade_start;
+extern int _mock_ledcFade_target;
+extern int _mock_ledcFade_duration;
+inline bool ledcFade(uint8_t pin, uint32_t start_duty, uint32_t target_duty, int max_fade_time_ms) {
+    _mock_ledcFade_start = start_duty;
+    _mock_ledcFade_target = target_duty;
+    _mock_ledcFade_duration = max_fade_time_ms;
+    return true;
+}
+
 class String : public std::string {
 public:
     String(const char* s) : std::string(s) {}
@@ -60,6 +75,7 @@ public:
         if (pos == std::string::npos) return -1;
         return (int)pos;
     }
+    long toInt() const { return strtol(c_str(), nullptr, 10); }
     int indexOf(char c) const {
         size_t pos = find(c);
         if (pos == std::string::npos) return -1;
@@ -67,14 +83,85 @@ public:
     }
 };
 
-class SerialMock {
+// Arduino's output and input stream bases, reduced to what the firmware uses
+class Print {
+public:
+    virtual ~Print() {}
+    virtual size_t write(uint8_t c) = 0;
+    virtual size_t write(const uint8_t* buffer, size_t size) {
+        size_t n = 0;
+        while (size--) n += write(*buffer++);
+        return n;
+    }
+    size_t write(const char* s) { return write((const uint8_t*)s, strlen(s)); }
+    virtual void flush() {}
+
+    size_t print(const char* s) { return write(s); }
+    size_t print(const String& s) { return write((const uint8_t*)s.data(), s.length()); }
+    size_t print(char c) { return write((uint8_t)c); }
+    size_t print(int n) { return print(std::to_string(n).c_str()); }
+    size_t print(unsigned int n) { return print(std::to_string(n).c_str()); }
+    size_t print(long n) { return print(std::to_string(n).c_str()); }
+    size_t print(unsigned long n) { return print(std::to_string(n).c_str()); }
+    size_t print(double f, int digits = 2) {
+        char buf[32];
+        snprintf(buf, sizeof(buf), "%.*f", digits, f);
+        return print(buf);
+    }
+    size_t println() { return write("\r\n"); }
+    template <typename T>
+    size_t println(const T& value) { return print(value) + println(); }
+
+    size_t printf(const char* format, ...) {
+        char buf[256];
+        va_list args;
+        va_start(args, format);
+        int n = vsnprintf(buf, sizeof(buf), format, args);
+        va_end(args);
+        return n > 0 ? write(buf) : 0;
+    }
+};
+
+class Stream : public Print {
 public:
+    virtual int available() = 0;
+    virtual int read() = 0;
+    virtual int peek() = 0;
+};
+
+// Output goes to stdout, or into _output while _capture is set; _feed()
+// queues bytes for available()/read()
+class SerialMock : public Stream {
+public:
+    using Print::write;
+
     void begin(unsigned long baud) {}
-    void println(const char* s) { std::cout << s << std::endl; }
-    void println(String s) { std::cout << s.c_str() << std::endl; }
-    void print(const char* s) { std::cout << s; }
-    void print(String s) { std::cout << s.c_str(); }
-    void print(float f, int p=2) { std::cout << f; }
-    void printf(const char* format, ...) {}
+    size_t write(uint8_t c) override {
+        if (_capture) _output.push_back((char)c);
+        else std::cout << (char)c;
+        return 1;
+    }
+    size_t write(const uint8_t* buffer, size_t size) override {
+        if (_capture) _output.append((const char*)buffer, size);
+        else std::cout.write((const char*)buffer, size);
+        return size;
+    }
+    int available() override { return (int)(_input.size() - _inputPos); }
+    int read() override {
+        if (_inputPos >= _input.size()) return -1;
+        return (uint8_t)_input[_inputPos++];
+    }
+    int peek() override { return _inputPos < _input.size() ? (uint8_t)_input[_inputPos] : -1; }
+
+    void _feed(const std::string& bytes) {
+        _input.erase(0, _inputPos);
+        _inputPos = 0;
+        _input += bytes;
+    }
+
+    std::string _input;
+    size_t _inputPos = 0;
+    std::string _output;
+    bool _capture = false;
 };
 extern SerialMock Serial;
\ No newline at end of file
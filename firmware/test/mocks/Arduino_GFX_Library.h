@@ -1,4 +1,35 @@
 #pragma once
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+#include "Arduino.h"
+
+#define GFX_NOT_DEFINED -1
+#define GFX_SKIP_OUTPUT_BEGIN -2
+
+/*
+ * Pixel-accurate stand-in for Arduino_GFX.
+ *
+ * Every primitive rasterizes into an in-memory RGB565 framebuffer and, for
+ * panel-backed targets, accounts for what the real driver would push over
+ * SPI: one address window (CASET + RASET + RAMWR, 11 bytes) per primitive
+ * segment plus two bytes per pixel. Primitives are decomposed the way
+ * Arduino_GFX does it, so the counters track real cost closely enough to
+ * set budgets against.
+ *
+ * Text uses the metrics of the classic 6x8 font but synthetic, deterministic
+ * glyph shapes; golden checksums are stable, they just don't spell words.
+ */
+
+struct GfxStats {
+    uint32_t calls = 0;   // Public draw API calls
+    uint32_t windows = 0; // Address window changes
+    uint32_t pixels = 0;  // Pixels pushed
+    uint32_t spiBytes() const { return windows * 11 + pixels * 2; }
+};
 
 class Arduino_DataBus {
 public:
@@ -10,33 +41,294 @@ public:
     Arduino_HWSPI(int dc, int cs, int sck, int mosi, int miso) {}
 };
 
-class Arduino_GFX {
+class Arduino_G {
 public:
-    virtual ~Arduino_GFX() = default;
-    bool begin(int32_t speed = 0) { return true; }
-    void fillScreen(uint16_t color) {}
-    void setRotation(uint8_t r) {}
-    void setTextColor(uint16_t c) {}
-    void setTextSize(uint8_t s) {}
-    void setCursor(int16_t x, int16_t y) {}
-    void print(const char* s) {}
-    void print(String s) {}
-    void print(int i) {}
-    void print(float f, int p=2) {}
-    void println(const char* s) {}
-    void println(String s) {}
-    void println(int i) {}
-    void printf(const char* format, ...) {}
-    void drawRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) {}
-    void fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) {}
-    void fillCircle(int16_t x, int16_t y, int16_t r, uint16_t color) {}
-    void drawLine(int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint16_t color) {}
+    virtual ~Arduino_G() = default;
+};
+
+class Arduino_GFX : public Arduino_G {
+public:
+    Arduino_GFX(int16_t w = 240, int16_t h = 135) : _w0(w), _h0(h), _w(w), _h(h), _fb((size_t)w * h, 0) {}
+
+    virtual bool begin(int32_t speed = GFX_NOT_DEFINED) { return true; }
+
+    int16_t width() const { return _w; }
+    int16_t height() const { return _h; }
+    uint8_t getRotation() const { return _rotation; }
+
+    void setRotation(uint8_t r) {
+        _rotation = r & 3;
+        _w = (_rotation & 1) ? _h0 : _w0;
+        _h = (_rotation & 1) ? _w0 : _h0;
+    }
+
+    void fillScreen(uint16_t color) { _stats.calls++; fillRectRaw(0, 0, _w, _h, color); }
+    void setTextColor(uint16_t c) { _textColor = c; }
+    void setTextSize(uint8_t s) { _textSize = s > 0 ? s : 1; }
+    void setCursor(int16_t x, int16_t y) { _cursorX = x; _cursorY = y; }
+    int16_t getCursorX() const { return _cursorX; }
+    int16_t getCursorY() const { return _cursorY; }
+
+    void print(const char* s) { _stats.calls++; writeText(s); }
+    void print(const String& s) { print(s.c_str()); }
+    void print(int i) { char buf[16]; snprintf(buf, sizeof(buf), "%d", i); print(buf); }
+    void print(float f, int p = 2) { char buf[32]; snprintf(buf, sizeof(buf), "%.*f", p, f); print(buf); }
+    void println(const char* s) { print(s); writeText("\n"); }
+    void println(const String& s) { println(s.c_str()); }
+    void println(int i) { print(i); writeText("\n"); }
+    void printf(const char* format, ...) {
+        char buf[128];
+        va_list args;
+        va_start(args, format);
+        vsnprintf(buf, sizeof(buf), format, args);
+        va_end(args);
+        print(buf);
+    }
+
+    void drawPixel(int16_t x, int16_t y, uint16_t color) { _stats.calls++; pixel(x, y, color); }
+
+    void drawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color) { _stats.calls++; fillRectRaw(x, y, w, 1, color); }
+    void drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color) { _stats.calls++; fillRectRaw(x, y, 1, h, color); }
+
+    void drawRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) {
+        _stats.calls++;
+        fillRectRaw(x, y, w, 1, color);
+        fillRectRaw(x, y + h - 1, w, 1, color);
+        fillRectRaw(x, y, 1, h, color);
+        fillRectRaw(x + w - 1, y, 1, h, color);
+    }
+
+    void fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) { _stats.calls++; fillRectRaw(x, y, w, h, color); }
+
+    void fillCircle(int16_t x0, int16_t y0, int16_t r, uint16_t color) {
+        _stats.calls++;
+        fillRectRaw(x0, y0 - r, 1, 2 * r + 1, color);
+        int16_t f = 1 - r, ddF_x = 1, ddF_y = -2 * r, x = 0, y = r;
+        int16_t px = x, py = y;
+        while (x < y) {
+            if (f >= 0) { y--; ddF_y += 2; f += ddF_y; }
+            x++; ddF_x += 2; f += ddF_x;
+            if (x < (y + 1)) {
+                fillRectRaw(x0 + x, y0 - y, 1, 2 * y + 1, color);
+                fillRectRaw(x0 - x, y0 - y, 1, 2 * y + 1, color);
+            }
+            if (y != py) {
+                fillRectRaw(x0 + py, y0 - px, 1, 2 * px + 1, color);
+                fillRectRaw(x0 - py, y0 - px, 1, 2 * px + 1, color);
+                py = y;
+            }
+            px = x;
+        }
+    }
+
+    void drawLine(int16_t x0, int16_t y0, int16_t x1, int16_t y1, uint16_t color) {
+        _stats.calls++;
+        if (x0 == x1) {
+            if (y0 > y1) { int16_t t = y0; y0 = y1; y1 = t; }
+            fillRectRaw(x0, y0, 1, y1 - y0 + 1, color);
+            return;
+        }
+        if (y0 == y1) {
+            if (x0 > x1) { int16_t t = x0; x0 = x1; x1 = t; }
+            fillRectRaw(x0, y0, x1 - x0 + 1, 1, color);
+            return;
+        }
+        int dx = abs(x1 - x0), sx = x0 < x1 ? 1 : -1;
+        int dy = -abs(y1 - y0), sy = y0 < y1 ? 1 : -1;
+        int err = dx + dy;
+        while (true) {
+            pixel(x0, y0, color);
+            if (x0 == x1 && y0 == y1) break;
+            int e2 = 2 * err;
+            if (e2 >= dy) { err += dy; x0 += sx; }
+            if (e2 <= dx) { err += dx; y0 += sy; }
+        }
+    }
+
     void getTextBounds(const char *string, int16_t x, int16_t y, int16_t *x1, int16_t *y1, uint16_t *w, uint16_t *h) {
-        *x1 = 0; *y1 = 0; *w = 10; *h = 10;
+        size_t len = strlen(string);
+        while (len > 0 && (string[len - 1] == '\n' || string[len - 1] == '\r')) len--;
+        *x1 = x; *y1 = y;
+        *w = (uint16_t)(len * 6 * _textSize);
+        *h = (uint16_t)(len > 0 ? 8 * _textSize : 0);
+    }
+
+    // --- Test helpers ---
+
+    const GfxStats& stats() const { return _stats; }
+    void resetStats() { _stats = GfxStats(); }
+
+    // Reads back a pixel in the current rotation's coordinates
+    uint16_t getPixel(int16_t x, int16_t y) const {
+        if (x < 0 || y < 0 || x >= _w || y >= _h) return 0;
+        return _fb[physicalIndex(x, y)];
+    }
+
+    const uint16_t* framebuffer() const { return _fb.data(); }
+
+    // FNV-1a over the physical framebuffer, used for golden-image asserts
+    uint32_t checksum() const {
+        uint32_t hash = 2166136261u;
+        for (size_t i = 0; i < _fb.size(); i++) {
+            hash = (hash ^ (_fb[i] & 0xFF)) * 16777619u;
+            hash = (hash ^ (_fb[i] >> 8)) * 16777619u;
+        }
+        return hash;
+    }
+
+    // Dumps the visible image as a binary PPM for eyeballing golden changes
+    bool writePPM(const char* path) const {
+        FILE* f = fopen(path, "wb");
+        if (!f) return false;
+        fprintf(f, "P6\n%d %d\n255\n", _w, _h);
+        for (int16_t y = 0; y < _h; y++) {
+            for (int16_t x = 0; x < _w; x++) {
+                uint16_t c = getPixel(x, y);
+                uint8_t rgb[3] = {(uint8_t)((c >> 8) & 0xF8), (uint8_t)((c >> 3) & 0xFC), (uint8_t)((c << 3) & 0xF8)};
+                fwrite(rgb, 1, 3, f);
+            }
+        }
+        fclose(f);
+        return true;
+    }
+
+protected:
+    size_t physicalIndex(int16_t x, int16_t y) const {
+        int16_t px = x, py = y;
+        switch (_rotation) {
+            case 1: px = _w0 - 1 - y; py = x; break;
+            case 2: px = _w0 - 1 - x; py = _h0 - 1 - y; break;
+            case 3: px = y; py = _h0 - 1 - x; break;
+            default: break;
+        }
+        return (size_t)py * _w0 + px;
+    }
+
+    void store(int16_t x, int16_t y, uint16_t color) {
+        if (x < 0 || y < 0 || x >= _w || y >= _h) return;
+        writePixelPreclipped(x, y, color);
+    }
+
+    // The real library's extension points for custom targets: everything
+    // ends up in one of these once clipped to the screen
+    virtual void writePixelPreclipped(int16_t x, int16_t y, uint16_t color) { _fb[physicalIndex(x, y)] = color; }
+    virtual void writeFillRectPreclipped(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) {
+        for (int16_t j = y; j < y + h; j++) {
+            for (int16_t i = x; i < x + w; i++) writePixelPreclipped(i, j, color);
+        }
+    }
+
+    void account(uint32_t windows, uint32_t pixels) {
+        if (!_countCost) return;
+        _stats.windows += windows;
+        _stats.pixels += pixels;
+    }
+
+    void pixel(int16_t x, int16_t y, uint16_t color) {
+        if (x < 0 || y < 0 || x >= _w || y >= _h) return;
+        store(x, y, color);
+        account(1, 1);
+    }
+
+    void fillRectRaw(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) {
+        if (w < 0) { x += w + 1; w = -w; }
+        if (h < 0) { y += h + 1; h = -h; }
+        int16_t x2 = x + w, y2 = y + h;
+        if (x < 0) x = 0;
+        if (y < 0) y = 0;
+        if (x2 > _w) x2 = _w;
+        if (y2 > _h) y2 = _h;
+        if (x >= x2 || y >= y2) return;
+        writeFillRectPreclipped(x, y, x2 - x, y2 - y, color);
+        account(1, (uint32_t)(x2 - x) * (y2 - y));
+    }
+
+    static uint8_t glyphColumn(unsigned char c, int col) {
+        if (c <= ' ' || col >= 5) return 0;
+        uint32_t h = (uint32_t)c * 2654435761u;
+        return (uint8_t)(((h >> (col * 5 + 3)) & 0x7F) | (1 << (col % 7)));
+    }
+
+    void writeText(const char* s) {
+        for (; *s; s++) {
+            unsigned char c = (unsigned char)*s;
+            if (c == '\n') {
+                _cursorX = 0;
+                _cursorY += 8 * _textSize;
+                continue;
+            }
+            if (c == '\r') continue;
+            if (_cursorX + 6 * _textSize > _w) { // Wrap like Arduino_GFX does by default
+                _cursorX = 0;
+                _cursorY += 8 * _textSize;
+            }
+            for (int col = 0; col < 5; col++) {
+                uint8_t bits = glyphColumn(c, col);
+                for (int row = 0; row < 8; row++) {
+                    if (!(bits & (1 << row))) continue;
+                    if (_textSize == 1) {
+                        pixel(_cursorX + col, _cursorY + row, _textColor);
+                    } else {
+                        fillRectRaw(_cursorX + col * _textSize, _cursorY + row * _textSize, _textSize, _textSize, _textColor);
+                    }
+                }
+            }
+            _cursorX += 6 * _textSize;
+        }
+    }
+
+    int16_t _w0, _h0; // Native (rotation 0) size
+    int16_t _w, _h;   // Size in the current rotation
+    uint8_t _rotation = 0;
+    std::vector<uint16_t> _fb;
+    bool _countCost = false;
+    GfxStats _stats;
+    int16_t _cursorX = 0;
+    int16_t _cursorY = 0;
+    uint16_t _textColor = 0xFFFF;
+    uint8_t _textSize = 1;
+};
+
+class Arduino_TFT : public Arduino_GFX {
+public:
+    Arduino_TFT(int16_t w, int16_t h) : Arduino_GFX(w, h) { _countCost = true; }
+
+    void startWrite() {}
+    void endWrite() {}
+
+    void writeAddrWindow(int16_t x, int16_t y, uint16_t w, uint16_t h) {
+        _stats.calls++;
+        _winX = x; _winY = y; _winW = w; _winH = h; _winPos = 0;
+        account(1, 0);
     }
+
+    void writeRepeat(uint16_t color, uint32_t len) {
+        for (uint32_t i = 0; i < len; i++) {
+            if (_winW == 0) break;
+            store(_winX + (int16_t)(_winPos % _winW), _winY + (int16_t)(_winPos / _winW), color);
+            _winPos++;
+        }
+        account(0, len);
+    }
+
+private:
+    int16_t _winX = 0, _winY = 0;
+    uint16_t _winW = 0, _winH = 0;
+    uint32_t _winPos = 0;
 };
 
-class Arduino_ST7789 : public Arduino_GFX {
+class Arduino_ST7789;
+extern Arduino_ST7789* _mock_panel;
+
+class Arduino_ST7789 : public Arduino_TFT {
 public:
-    Arduino_ST7789(Arduino_DataBus *bus, int8_t rst, uint8_t r, bool ips, int16_t w, int16_t h, int16_t col_offset1, int16_t row_offset1, int16_t col_offset2, int16_t row_offset2) {}
-};
\ No newline at end of file
+    Arduino_ST7789(Arduino_DataBus *bus, int8_t rst, uint8_t r, bool ips, int16_t w, int16_t h, int16_t col_offset1, int16_t row_offset1, int16_t col_offset2, int16_t row_offset2)
+        : Arduino_TFT(w, h) {
+        setRotation(r);
+        _mock_panel = this;
+    }
+    ~Arduino_ST7789() {
+        if (_mock_panel == this) _mock_panel = nullptr;
+    }
+};
+
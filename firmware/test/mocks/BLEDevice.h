@@ -0,0 +1,178 @@
+#pragma once
+#include <Arduino.h>
+#include <map>
+#include <vector>
+
+typedef uint8_t esp_bd_addr_t[6];
+
+class BLEAddress {
+public:
+    BLEAddress() { memset(_address, 0, sizeof(_address)); }
+    explicit BLEAddress(const uint8_t address[6]) { memcpy(_address, address, sizeof(_address)); }
+    esp_bd_addr_t* getNative() { return &_address; }
+
+private:
+    esp_bd_addr_t _address;
+};
+
+class BLEAdvertisedDevice {
+public:
+    BLEAdvertisedDevice() {}
+    BLEAdvertisedDevice(const uint8_t address[6], int rssi) : _address(address), _rssi(rssi), _haveRSSI(true) {}
+    BLEAddress getAddress() { return _address; }
+    int getRSSI() { return _rssi; }
+    bool haveRSSI() { return _haveRSSI; }
+
+private:
+    BLEAddress _address;
+    int _rssi = 0;
+    bool _haveRSSI = false;
+};
+
+class BLEAdvertisedDeviceCallbacks {
+public:
+    virtual ~BLEAdvertisedDeviceCallbacks() {}
+    virtual void onResult(BLEAdvertisedDevice advertisedDevice) = 0;
+};
+
+class BLEScanResults {};
+
+class BLEScan {
+public:
+    void setAdvertisedDeviceCallbacks(BLEAdvertisedDeviceCallbacks* callbacks) { _callbacks = callbacks; }
+    void setActiveScan(bool active) { _active = active; }
+    void setInterval(uint16_t interval) { _interval = interval; }
+    void setWindow(uint16_t window) { _window = window; }
+    bool start(uint32_t duration, void (*complete)(BLEScanResults), bool isContinue) {
+        _scanning = true;
+        _starts++;
+        return true;
+    }
+    void stop() { _scanning = false; }
+    void clearResults() {}
+
+    BLEAdvertisedDeviceCallbacks* _callbacks = nullptr;
+    bool _scanning = false;
+    bool _active = true;
+    uint16_t _interval = 0;
+    uint16_t _window = 0;
+    int _starts = 0;
+};
+
+// The parts of the GATT server event parameters the firmware reads
+struct esp_ble_gatts_cb_param_t {
+    struct {
+        uint16_t conn_id;
+        esp_bd_addr_t remote_bda;
+    } connect;
+    struct {
+        uint16_t conn_id;
+        uint16_t mtu;
+    } mtu;
+};
+
+class BLECharacteristic;
+
+class BLECharacteristicCallbacks {
+public:
+    virtual ~BLECharacteristicCallbacks() {}
+    virtual void onWrite(BLECharacteristic* characteristic) {}
+};
+
+class BLECharacteristic {
+public:
+    static const uint32_t PROPERTY_READ = 1 << 0;
+    static const uint32_t PROPERTY_WRITE = 1 << 1;
+    static const uint32_t PROPERTY_NOTIFY = 1 << 2;
+    static const uint32_t PROPERTY_WRITE_NR = 1 << 5;
+    void setCallbacks(BLECharacteristicCallbacks* callbacks) { _callbacks = callbacks; }
+    void setValue(uint8_t* data, size_t length) { _value.assign((const char*)data, length); }
+    String getValue() { return String(_value); }
+    void notify() {
+        _notifyCount++;
+        _notifications.push_back(_value);
+    }
+
+    // Simulates a client write, on the caller's thread as the BLE task would
+    void _write(const std::string& bytes) {
+        _value = bytes;
+        if (_callbacks) _callbacks->onWrite(this);
+    }
+
+    BLECharacteristicCallbacks* _callbacks = nullptr;
+    std::string _value;
+    std::vector<std::string> _notifications;
+    uint32_t _properties = 0;
+    int _notifyCount = 0;
+};
+
+class BLEService {
+public:
+    BLECharacteristic* createCharacteristic(const char* uuid, uint32_t properties) {
+        BLECharacteristic& characteristic = _characteristics[uuid];
+        characteristic._properties = properties;
+        return &characteristic;
+    }
+    void start() {}
+    std::map<std::string, BLECharacteristic> _characteristics;
+};
+
+class BLEServer;
+
+class BLEServerCallbacks {
+public:
+    virtual ~BLEServerCallbacks() {}
+    virtual void onConnect(BLEServer* server) {}
+    virtual void onConnect(BLEServer* server, esp_ble_gatts_cb_param_t* param) {}
+    virtual void onDisconnect(BLEServer* server) {}
+    virtual void onMtuChanged(BLEServer* server, esp_ble_gatts_cb_param_t* param) {}
+};
+
+class BLEServer {
+public:
+    BLEService* createService(const char* uuid) { return &_services[uuid]; }
+    void setCallbacks(BLEServerCallbacks* callbacks) { _callbacks = callbacks; }
+    void updateConnParams(esp_bd_addr_t remote, uint16_t minInterval, uint16_t maxInterval, uint16_t latency,
+                          uint16_t timeout) {
+        _minInterval = minInterval;
+        _maxInterval = maxInterval;
+    }
+    void startAdvertising() { _advertisingStarts++; }
+
+    // Simulated link events, in the order the stack reports them
+    void _connect(uint16_t mtu) {
+        esp_ble_gatts_cb_param_t param = {};
+        if (_callbacks) {
+            _callbacks->onConnect(this);
+            _callbacks->onConnect(this, &param);
+        }
+        param.mtu.mtu = mtu;
+        if (_callbacks) _callbacks->onMtuChanged(this, &param);
+    }
+    void _disconnect() {
+        if (_callbacks) _callbacks->onDisconnect(this);
+    }
+
+    std::map<std::string, BLEService> _services;
+    BLEServerCallbacks* _callbacks = nullptr;
+    uint16_t _minInterval = 0;
+    uint16_t _maxInterval = 0;
+    int _advertisingStarts = 0;
+};
+
+class BLEAdvertising {
+public:
+    void addServiceUUID(const char* uuid) {}
+    void setScanResponse(bool enabled) {}
+    void start() {}
+};
+
+class BLEDevice {
+public:
+    static void init(String deviceName) {}
+    static void setMTU(uint16_t mtu) { _localMtu() = mtu; }
+    static uint16_t& _localMtu() { static uint16_t mtu = 23; return mtu; }
+    static BLEScan* getScan() { static BLEScan scan; return &scan; }
+    static BLEServer* createServer() { static BLEServer server; return &server; }
+    static BLEAdvertising* getAdvertising() { static BLEAdvertising advertising; return &advertising; }
+};
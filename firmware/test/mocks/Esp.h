@@ -0,0 +1,16 @@
+#pragma once
+#include <stdint.h>
+
+class ESPClass {
+public:
+    ESPClass() : _restarted(false) {}
+    void restart() { _restarted = true; }
+    uint32_t getFreeHeap() { return 100000; }
+    // Advances by _cycleStep per read, so timed code always takes a while
+    uint32_t getCycleCount() { return _cycles += _cycleStep; }
+    bool _restarted;
+    uint32_t _cycles = 0;
+    uint32_t _cycleStep = 0;
+};
+
+extern ESPClass ESP;
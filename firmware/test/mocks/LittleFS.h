@@ -3,9 +3,12 @@
 #include <map>
 #include <stdint.h>
 #include <vector>
+#include <string.h>
+#include <algorithm>
 
 extern std::map<std::string, std::string> _mock_sd_files;
 extern std::map<std::string, std::string> _mock_lfs_files;
+extern size_t _mock_file_reads; // read(buf, size) calls, so tests can bound what a query touches
 
 class File {
 public:
@@ -66,6 +69,15 @@ public:
         if (_pos < _content.length()) return (uint8_t)_content[_pos++];
         return -1;
     }
+
+    size_t read(uint8_t* buf, size_t size) {
+        _mock_file_reads++;
+        if (!_valid || _pos >= _content.length()) return 0;
+        size_t n = std::min(size, _content.length() - _pos);
+        memcpy(buf, _content.data() + _pos, n);
+        _pos += n;
+        return n;
+    }
     
     bool isDirectory() { return _isDir; }
     
@@ -103,11 +115,11 @@ public:
             _failNextOpen = false;
             return File("", nullptr, false);
         }
-        if (_mock_lfs_files.count(path)) return File(path, &_mock_lfs_files, true);
         if (std::string(mode) == "w") {
-            _mock_lfs_files[path] = "";
+            _mock_lfs_files[path] = ""; // Truncate, as on the device
             return File(path, &_mock_lfs_files, true); 
         }
+        if (_mock_lfs_files.count(path)) return File(path, &_mock_lfs_files, true);
         return File("", nullptr, false); 
     }
     
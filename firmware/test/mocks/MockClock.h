@@ -0,0 +1,18 @@
+#pragma once
+#include <Arduino.h>
+#include "AppClock.h"
+
+// Virtual time for SideEyeApp. Advancing it moves _mock_millis too, so the
+// managers that read millis() directly stay in step.
+class MockClock : public AppClock {
+public:
+    unsigned long millis() override { return _mock_millis; }
+    unsigned long micros() override { return _mock_millis * 1000; }
+    time_t wallClock() override { return _epoch ? _epoch + _mock_millis / 1000 : 0; }
+    void startWallClockSync() override { _syncStarted = true; }
+
+    void advance(unsigned long ms) { _mock_millis += ms; }
+
+    time_t _epoch = 0; // Wall-clock time at _mock_millis == 0; 0 means never synced
+    bool _syncStarted = false;
+};
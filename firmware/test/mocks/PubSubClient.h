@@ -1,27 +1,106 @@
 #pragma once
 #include <Arduino.h>
 #include <WiFi.h>
+#include <functional>
+#include <string.h>
+
+// One recorded publish; fixed-size so recording never allocates.
+struct MockPublish {
+    char topic[128];
+    char payload[512];
+    bool retained;
+};
 
 class PubSubClient {
 public:
-    PubSubClient(WiFiClient& client) : _connected(false), _state(0) {}
-    bool connect(const char* id) { _connected = true; return true; }
-    bool connect(const char* id, const char* user, const char* pass, const char* willTopic, uint8_t willQos, bool willRetain, const char* willMessage) { _connected = true; return true; }
-    bool connect(const char* id, const char* willTopic, uint8_t willQos, bool willRetain, const char* willMessage) { _connected = true; return true; }
-    void disconnect() { _connected = false; }
-    bool publish(const char* topic, const char* payload) { return true; }
-    bool publish(const char* topic, const char* payload, bool retained) { return true; }
+    PubSubClient(WiFiClient& client) : _client(&client), _connected(false), _state(0) {}
+    bool connect(const char* id) { return handshake(); }
+    bool connect(const char* id, const char* user, const char* pass, const char* willTopic, uint8_t willQos, bool willRetain, const char* willMessage) { return handshake(); }
+    bool connect(const char* id, const char* willTopic, uint8_t willQos, bool willRetain, const char* willMessage) { return handshake(); }
+    void disconnect() { _connected = false; _client->stop(); }
+    bool publish(const char* topic, const char* payload) { return publish(topic, payload, false); }
+    bool publish(const char* topic, const char* payload, bool retained) {
+        MockPublish& p = _published[_publishCount % MAX_PUBLISHED];
+        strncpy(p.topic, topic, sizeof(p.topic) - 1);
+        p.topic[sizeof(p.topic) - 1] = '\0';
+        strncpy(p.payload, payload, sizeof(p.payload) - 1);
+        p.payload[sizeof(p.payload) - 1] = '\0';
+        p.retained = retained;
+        _publishCount++;
+        return true;
+    }
+    bool beginPublish(const char* topic, unsigned int length, bool retained) {
+        MockPublish& p = _published[_publishCount % MAX_PUBLISHED];
+        strncpy(p.topic, topic, sizeof(p.topic) - 1);
+        p.topic[sizeof(p.topic) - 1] = '\0';
+        p.payload[0] = '\0';
+        p.retained = retained;
+        _streamDeclared = length;
+        _streamWritten = 0;
+        return true;
+    }
+    size_t write(const uint8_t* data, size_t length) {
+        MockPublish& p = _published[_publishCount % MAX_PUBLISHED];
+        size_t room = _streamWritten < sizeof(p.payload) - 1 ? sizeof(p.payload) - 1 - _streamWritten : 0;
+        size_t n = length < room ? length : room;
+        memcpy(p.payload + _streamWritten, data, n);
+        _streamWritten += length;
+        p.payload[_streamWritten < sizeof(p.payload) ? _streamWritten : sizeof(p.payload) - 1] = '\0';
+        _maxWrite = length > _maxWrite ? length : _maxWrite;
+        return length;
+    }
+    int endPublish() {
+        if (_streamWritten != _streamDeclared) _lengthMismatches++;
+        _publishCount++;
+        return 1;
+    }
     bool subscribe(const char* topic) { return true; }
     bool loop() { return true; }
     bool connected() { return _connected; }
     void setServer(const char* domain, uint16_t port) {}
+    void setServer(IPAddress ip, uint16_t port) {}
+    void setSocketTimeout(uint16_t seconds) {}
     void setCallback(std::function<void(char*, uint8_t*, unsigned int)> callback) {}
     int state() { return _state; }
     
     void _setConnected(bool c) { _connected = c; }
     void _setState(int s) { _state = s; }
 
+    // The most recent MAX_PUBLISHED publishes, looked up by topic
+    static const int MAX_PUBLISHED = 32;
+    const MockPublish* _find(const char* topic) const {
+        int first = _publishCount > MAX_PUBLISHED ? _publishCount - MAX_PUBLISHED : 0;
+        for (int i = _publishCount - 1; i >= first; i--) {
+            if (strcmp(_published[i % MAX_PUBLISHED].topic, topic) == 0) return &_published[i % MAX_PUBLISHED];
+        }
+        return nullptr;
+    }
+    int _publishCount = 0;
+    size_t _streamDeclared = 0;
+    size_t _streamWritten = 0;
+    size_t _maxWrite = 0;
+    int _lengthMismatches = 0;
+    MockPublish _published[MAX_PUBLISHED];
+
 private:
+    // Like the real client: reuse an open socket, otherwise open one first
+    bool handshake() {
+        _mock_broker.mqttAttempts++;
+        if (!_client->connected() && !_client->connect(IPAddress(), 0, 0)) {
+            _state = -2; // MQTT_CONNECT_FAILED
+            return false;
+        }
+        if (!_mock_broker.accepts) {
+            _state = 5; // MQTT_CONNECT_UNAUTHORIZED
+            _client->stop();
+            return false;
+        }
+        _state = 0;
+        _connected = true;
+        return true;
+    }
+
+    WiFiClient* _client;
     bool _connected;
     int _state;
 };
@@ -24,7 +24,9 @@ public:
         
         bool writing = (std::string(mode) == FILE_WRITE || std::string(mode) == FILE_APPEND);
         if (_mock_sd_files.count(path)) {
-             return File(path, &_mock_sd_files, true);
+             File file(path, &_mock_sd_files, true);
+             if (std::string(mode) == FILE_APPEND) file.seek(file.size());
+             return file;
         }
         
         if (writing) {
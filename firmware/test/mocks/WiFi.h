@@ -1,36 +1,87 @@
 #pragma once
 #include <stdint.h>
 #include "Arduino.h"
+#include "Esp.h"
+#include <string.h>
+#include "lwip/dns.h"
 
 #define WL_CONNECTED 3
 #define WL_IDLE_STATUS 0
+#define WL_DISCONNECTED 6
+#define WIFI_STA 1
 
 class IPAddress {
 public:
-    String toString() { return "1.2.3.4"; }
+    IPAddress() : _addr{0, 0, 0, 0} {}
+    IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d) : _addr{a, b, c, d} {}
+    IPAddress(uint32_t address) { memcpy(_addr, &address, 4); } // Network byte order, as lwIP keeps it
+    bool fromString(const char* s) {
+        unsigned a, b, c, d;
+        char tail;
+        if (sscanf(s, "%u.%u.%u.%u%c", &a, &b, &c, &d, &tail) != 4 || a > 255 || b > 255 || c > 255 || d > 255) return false;
+        _addr[0] = a; _addr[1] = b; _addr[2] = c; _addr[3] = d;
+        return true;
+    }
+    String toString() const {
+        char buf[16];
+        snprintf(buf, sizeof(buf), "%u.%u.%u.%u", _addr[0], _addr[1], _addr[2], _addr[3]);
+        return String(buf);
+    }
+    bool operator==(const IPAddress& o) const { return memcmp(_addr, o._addr, 4) == 0; }
+    uint8_t _addr[4];
 };
 
+// Stand-in for the path to the MQTT broker: DNS, TCP and the broker itself
+struct MockBroker {
+    bool resolvable = true;
+    bool reachable = true;
+    bool accepts = true;
+    int dnsLookups = 0;
+    int tcpAttempts = 0;
+    int mqttAttempts = 0;
+
+    // The lookup dns_gethostbyname() left in flight
+    dns_found_callback dnsCallback = nullptr;
+    void* dnsArg = nullptr;
+
+    // Answers it, as the lwIP task would: 10.0.0.2 or, if not resolvable, NULL
+    bool answerDns() {
+        if (!dnsCallback) return false;
+        dns_found_callback callback = dnsCallback;
+        dnsCallback = nullptr;
+        ip_addr_t addr;
+        const uint8_t bytes[4] = {10, 0, 0, 2};
+        memcpy(&addr.u_addr.ip4.addr, bytes, 4);
+        callback("", resolvable ? &addr : nullptr, dnsArg);
+        return true;
+    }
+};
+extern MockBroker _mock_broker;
+
 class WiFiClass {
 public:
-    uint8_t status() { return WL_CONNECTED; }
-    IPAddress softAPIP() { return IPAddress(); }
-    IPAddress localIP() { return IPAddress(); }
-    int RSSI() { return -50; }
+    uint8_t status() { return _status; }
+    bool mode(int m) { return true; }
+    int begin() { _begins++; return _status; }
+    int begin(const char* ssid, const char* pass) { _begins++; return _status; }
+    IPAddress softAPIP() { return IPAddress(1, 2, 3, 4); }
+    IPAddress localIP() { return IPAddress(1, 2, 3, 4); }
+    int RSSI() { return _rssi; }
+    int _rssi = -50;
+    uint8_t _status = WL_CONNECTED;
+    int _begins = 0;
 };
 
 extern WiFiClass WiFi;
 
 class WiFiClient {
 public:
-    bool connected() { return true; }
+    int connect(IPAddress ip, uint16_t port, int32_t timeout) {
+        _mock_broker.tcpAttempts++;
+        _connected = _mock_broker.reachable;
+        return _connected;
+    }
+    void stop() { _connected = false; }
+    bool connected() { return _connected; }
+    bool _connected = false;
 };
-
-class ESPClass {
-public:
-    ESPClass() : _restarted(false) {}
-    void restart() { _restarted = true; }
-    uint32_t getFreeHeap() { return 100000; }
-    bool _restarted;
-};
-
-extern ESPClass ESP;
\ No newline at end of file
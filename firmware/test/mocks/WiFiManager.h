@@ -1,6 +1,7 @@
 #pragma once
 #include <Arduino.h>
 #include <functional>
+#include <string>
 
 enum wm_debuglevel_t {
     WM_DEBUG_OFF = 0,
@@ -12,8 +13,13 @@ enum wm_debuglevel_t {
 
 class WiFiManagerParameter {
 public:
-    WiFiManagerParameter(const char *id, const char *placeholder, const char *defaultValue, int length) {}
-    const char* getValue() { return ""; }
+    // Like the real one, holds the default until the portal changes it
+    WiFiManagerParameter(const char *id, const char *placeholder, const char *defaultValue, int length)
+        : _value(defaultValue ? defaultValue : "") {}
+    const char* getValue() { return _value.c_str(); }
+    void setValue(const char *defaultValue, int length) { _value = defaultValue ? defaultValue : ""; }
+private:
+    std::string _value;
 };
 
 class WiFiManager {
@@ -23,7 +29,18 @@ public:
     void setWebServerCallback(void (*func)()) {}
     void addParameter(WiFiManagerParameter *p) {}
     bool autoConnect(const char *apName, const char *apPassword = NULL) { return _autoConnectResult; }
+    void setConfigPortalBlocking(bool shouldBlock) {}
+    bool startConfigPortal(const char *apName, const char *apPassword = NULL) {
+        _portalStarts++;
+        return false; // Non-blocking: still open
+    }
+    // True once the portal has saved credentials and joined
+    bool process() { return _portalDone; }
+    bool getWiFiIsSaved() { return _wifiSaved; }
     void resetSettings() {}
     bool preloadWiFi(String ssid, String pass) { return true; }
     bool _autoConnectResult = true;
+    bool _wifiSaved = true;
+    bool _portalDone = false;
+    int _portalStarts = 0;
 };
@@ -0,0 +1,34 @@
+#pragma once
+#include <Arduino.h>
+#include <WiFi.h>
+#include <algorithm>
+#include <deque>
+#include <string.h>
+
+// Datagrams waiting to be received, oldest first
+extern std::deque<std::string> _mock_udp_packets;
+
+class WiFiUDP {
+public:
+    uint8_t begin(uint16_t port) { _port = port; return 1; }
+    void stop() { _port = 0; }
+    int parsePacket() {
+        if (_port == 0 || _mock_udp_packets.empty()) return 0;
+        _packet = _mock_udp_packets.front();
+        _mock_udp_packets.pop_front();
+        _offset = 0;
+        return (int)_packet.size();
+    }
+    int read(char* buffer, size_t length) { return read(reinterpret_cast<uint8_t*>(buffer), length); }
+    int read(uint8_t* buffer, size_t length) {
+        size_t n = std::min(length, _packet.size() - _offset);
+        memcpy(buffer, _packet.data() + _offset, n);
+        _offset += n;
+        return (int)n;
+    }
+    void flush() { _offset = _packet.size(); }
+
+    uint16_t _port = 0;
+    std::string _packet;
+    size_t _offset = 0;
+};
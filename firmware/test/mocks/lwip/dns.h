@@ -0,0 +1,26 @@
+#pragma once
+#include <stdint.h>
+
+// The slice of lwIP's DNS client the firmware uses. Lookups are answered
+// by MockBroker::answerDns(), standing in for the lwIP task.
+typedef int8_t err_t;
+#define ERR_OK 0
+#define ERR_INPROGRESS -5
+#define ERR_ARG -16
+
+typedef struct {
+    uint32_t addr;
+} ip4_addr_t;
+
+typedef struct {
+    union {
+        ip4_addr_t ip4;
+    } u_addr;
+    uint8_t type;
+} ip_addr_t;
+
+#define ip_addr_get_ip4_u32(ipaddr) ((ipaddr)->u_addr.ip4.addr)
+
+typedef void (*dns_found_callback)(const char* name, const ip_addr_t* ipaddr, void* callback_arg);
+
+err_t dns_gethostbyname(const char* hostname, ip_addr_t* addr, dns_found_callback found, void* callback_arg);
@@ -0,0 +1,2 @@
+#pragma once
+// Core locking is compiled out in the native build
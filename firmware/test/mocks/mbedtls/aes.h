@@ -0,0 +1,93 @@
+#pragma once
+#include <stdint.h>
+#include <string.h>
+
+// AES-128 encryption only (what BLE address resolution needs), so tests
+// can check real vectors. Byte-oriented reference implementation.
+
+#define MBEDTLS_AES_ENCRYPT 1
+#define MBEDTLS_AES_DECRYPT 0
+
+struct mbedtls_aes_context {
+    uint8_t roundKeys[176];
+};
+
+namespace mock_aes {
+
+inline uint8_t xtime(uint8_t x) { return (uint8_t)((x << 1) ^ ((x & 0x80) ? 0x1b : 0)); }
+
+inline uint8_t sbox(uint8_t x) {
+    // Multiplicative inverse in GF(2^8), then the affine transform
+    uint8_t inverse = 0;
+    if (x) {
+        for (int c = 1; c < 256; c++) {
+            uint8_t a = x, b = (uint8_t)c, product = 0;
+            while (b) {
+                if (b & 1) product ^= a;
+                a = xtime(a);
+                b >>= 1;
+            }
+            if (product == 1) {
+                inverse = (uint8_t)c;
+                break;
+            }
+        }
+    }
+    uint8_t s = inverse;
+    for (int i = 1; i < 5; i++) s ^= (uint8_t)((inverse << i) | (inverse >> (8 - i)));
+    return s ^ 0x63;
+}
+
+} // namespace mock_aes
+
+inline void mbedtls_aes_init(mbedtls_aes_context* ctx) { memset(ctx, 0, sizeof(*ctx)); }
+inline void mbedtls_aes_free(mbedtls_aes_context* ctx) { memset(ctx, 0, sizeof(*ctx)); }
+
+inline int mbedtls_aes_setkey_enc(mbedtls_aes_context* ctx, const unsigned char* key, unsigned int keybits) {
+    if (keybits != 128) return -1;
+    memcpy(ctx->roundKeys, key, 16);
+    uint8_t rcon = 1;
+    for (int i = 16; i < 176; i += 4) {
+        uint8_t t[4];
+        memcpy(t, ctx->roundKeys + i - 4, 4);
+        if (i % 16 == 0) {
+            uint8_t first = t[0];
+            t[0] = mock_aes::sbox(t[1]) ^ rcon;
+            t[1] = mock_aes::sbox(t[2]);
+            t[2] = mock_aes::sbox(t[3]);
+            t[3] = mock_aes::sbox(first);
+            rcon = mock_aes::xtime(rcon);
+        }
+        for (int j = 0; j < 4; j++) ctx->roundKeys[i + j] = ctx->roundKeys[i + j - 16] ^ t[j];
+    }
+    return 0;
+}
+
+inline int mbedtls_aes_crypt_ecb(mbedtls_aes_context* ctx, int mode, const unsigned char input[16],
+                                 unsigned char output[16]) {
+    if (mode != MBEDTLS_AES_ENCRYPT) return -1;
+    uint8_t s[16];
+    for (int i = 0; i < 16; i++) s[i] = input[i] ^ ctx->roundKeys[i];
+    for (int round = 1; round <= 10; round++) {
+        uint8_t t[16];
+        // SubBytes and ShiftRows (column-major state)
+        for (int c = 0; c < 4; c++) {
+            for (int r = 0; r < 4; r++) t[c * 4 + r] = mock_aes::sbox(s[((c + r) % 4) * 4 + r]);
+        }
+        // MixColumns, skipped in the last round
+        if (round < 10) {
+            for (int c = 0; c < 4; c++) {
+                uint8_t* col = t + c * 4;
+                uint8_t a0 = col[0], a1 = col[1], a2 = col[2], a3 = col[3];
+                uint8_t all = a0 ^ a1 ^ a2 ^ a3;
+                col[0] ^= all ^ mock_aes::xtime(a0 ^ a1);
+                col[1] ^= all ^ mock_aes::xtime(a1 ^ a2);
+                col[2] ^= all ^ mock_aes::xtime(a2 ^ a3);
+                col[3] ^= all ^ mock_aes::xtime(a3 ^ a0);
+            }
+        }
+        for (int i = 0; i < 16; i++) s[i] = t[i] ^ ctx->roundKeys[round * 16 + i];
+    }
+    memcpy(output, s, 16);
+    return 0;
+}
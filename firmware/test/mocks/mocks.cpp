@@ -1,20 +1,50 @@
 #include "Arduino.h"
 #include "WiFi.h"
+#include "WiFiUdp.h"
 #include "SD.h"
 #include "LittleFS.h"
 #include "SPI.h"
+#include "Arduino_GFX_Library.h"
+#include <cstdlib>
+#include <new>
 
 unsigned long _mock_millis = 0;
 int _mock_digitalRead_val = HIGH;
 int _mock_analogWrite_val = 0;
 uint8_t _mock_analogWrite_pin = 0;
+int _mock_ledcFade_start = -1;
+int _mock_ledcFade_target = -1;
+int _mock_ledcFade_duration = -1;
 uint32_t _mock_sd_frequency = 0;
 SerialMock Serial;
 WiFiClass WiFi;
+MockBroker _mock_broker;
+std::deque<std::string> _mock_udp_packets;
 ESPClass ESP;
 SDClass SD;
 LittleFSClass LittleFS;
 SPIClass SPI;
+Arduino_ST7789* _mock_panel = nullptr;
 
 std::map<std::string, std::string> _mock_sd_files;
 std::map<std::string, std::string> _mock_lfs_files;
+size_t _mock_file_reads = 0;
+
+err_t dns_gethostbyname(const char* hostname, ip_addr_t* addr, dns_found_callback found, void* callback_arg) {
+    _mock_broker.dnsLookups++;
+    _mock_broker.dnsCallback = found;
+    _mock_broker.dnsArg = callback_arg;
+    return ERR_INPROGRESS;
+}
+
+// Counts every heap allocation so tests can assert a path is allocation-free
+size_t _mock_allocations = 0;
+
+void* operator new(size_t size) {
+    _mock_allocations++;
+    void* p = malloc(size ? size : 1);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+void operator delete(void* p) noexcept { free(p); }
@@ -12,15 +12,34 @@
 #endif
 
 #include "HistoryBuffer.h"
+#include "Scheduler.h"
+#include "RenderScheduler.h"
+#include "StaticLayerCache.h"
+#include "TelemetryHistory.h"
+#include "HistoryStore.h"
+#include "StatsLog.h"
 #include "InputHandler.h"
 #include "DisplayManager.h"
 #include "SyncManager.h"
 #include "NetworkManager.h"
+#include "HostTable.h"
+#include "PublishQueue.h"
+#include "ConfigStore.h"
+#include "BootProfile.h"
+#include "LoopMetrics.h"
+#include "Trace.h"
+#include "SideEyeApp.h"
+#include <MockClock.h>
+#include "SpscRing.h"
+#include <thread>
 
 void setUp(void) {
 #ifdef NATIVE
     _mock_millis = 0;
     _mock_digitalRead_val = HIGH;
+    _mock_broker = MockBroker();
+    _mock_lfs_files.clear();
+    WiFi = WiFiClass();
 #endif
 }
 
@@ -45,6 +64,58 @@ void test_history_max(void) {
     TEST_ASSERT_EQUAL(50, buffer.max());
 }
 
+void test_history_sliding_min_max(void) {
+    // Compare against a brute-force scan of the logical window
+    HistoryBuffer<int, 7> buffer;
+    uint32_t seed = 12345;
+    for (int n = 0; n < 200; n++) {
+        seed = seed * 1103515245 + 12345;
+        int value = (int)((seed >> 16) % 100) - 50;
+        buffer.push(value);
+
+        int lo = buffer.get(0), hi = buffer.get(0);
+        long sum = 0;
+        for (size_t i = 0; i < buffer.count(); i++) {
+            int v = buffer.get(i);
+            if (v < lo) lo = v;
+            if (v > hi) hi = v;
+            sum += v;
+        }
+        TEST_ASSERT_EQUAL(hi, buffer.max());
+        TEST_ASSERT_EQUAL(lo, buffer.min());
+        TEST_ASSERT_EQUAL(sum, (long)buffer.sum());
+        TEST_ASSERT_FLOAT_WITHIN(0.001, (double)sum / buffer.count(), buffer.mean());
+    }
+}
+
+void test_history_pow2_and_spans(void) {
+    HistoryBuffer<uint64_t, 8> buffer;
+    HistoryBuffer<uint64_t, 8>::Span span = buffer.spans();
+    TEST_ASSERT_EQUAL(0, span.firstLength + span.secondLength);
+
+    for (uint64_t v = 1; v <= 11; v++) buffer.push(v);
+    TEST_ASSERT_EQUAL(8, buffer.count());
+    TEST_ASSERT_EQUAL(4, buffer.get(0));
+    TEST_ASSERT_EQUAL(11, buffer.get(7));
+    TEST_ASSERT_EQUAL(11, buffer.max());
+    TEST_ASSERT_EQUAL(4, buffer.min());
+    TEST_ASSERT_EQUAL(60, buffer.sum());
+
+    // Oldest-first runs that concatenate to the logical window
+    span = buffer.spans();
+    TEST_ASSERT_EQUAL(5, span.firstLength);
+    TEST_ASSERT_EQUAL(3, span.secondLength);
+    size_t i = 0;
+    for (size_t j = 0; j < span.firstLength; j++) TEST_ASSERT_EQUAL(buffer.get(i++), span.first[j]);
+    for (size_t j = 0; j < span.secondLength; j++) TEST_ASSERT_EQUAL(buffer.get(i++), span.second[j]);
+
+    HistoryBuffer<float, 60> floats;
+    floats.push(1.5f);
+    floats.push(2.5f);
+    TEST_ASSERT_EQUAL(2, floats.spans().firstLength);
+    TEST_ASSERT_FLOAT_WITHIN(0.001, 2.0, floats.mean());
+}
+
 void test_display_draw_identity() {
     DisplayManager display;
     SystemState state;
@@ -64,6 +135,36 @@ void test_display_format_speed() {
     TEST_ASSERT_EQUAL_STRING("1.5 MB/s", display.formatSpeed(1.5 * 1024 * 1024).c_str());
 }
 
+void test_static_string() {
+    StaticString<8> s;
+    TEST_ASSERT_TRUE(s.empty());
+    TEST_ASSERT_EQUAL_STRING("", s.c_str());
+
+    s = "host";
+    TEST_ASSERT_EQUAL(4, s.length());
+    TEST_ASSERT_TRUE(s == "host");
+    TEST_ASSERT_TRUE(s != "hostname");
+
+    // Truncates to capacity, keeping the terminator
+    s = "hostname-too-long";
+    TEST_ASSERT_EQUAL(7, s.length());
+    TEST_ASSERT_EQUAL_STRING("hostnam", s.c_str());
+
+    // A two-byte character straddling the limit is dropped whole
+    s = "abcdef\xC3\xA9";
+    TEST_ASSERT_EQUAL_STRING("abcdef", s.c_str());
+    s = "abcde\xC3\xA9";
+    TEST_ASSERT_EQUAL(7, s.length());
+
+    s = nullptr;
+    TEST_ASSERT_TRUE(s.empty());
+
+    SystemState state;
+    TEST_ASSERT_TRUE(state.hostname == "Unknown");
+    TEST_ASSERT_EQUAL_STRING("Idle", syncStatusLabel(state.sd_sync_status));
+    TEST_ASSERT_EQUAL_STRING("Error!", syncStatusLabel(SYNC_ERROR));
+}
+
 void test_display_draw_smoke() {
     DisplayManager display;
     SystemState state;
@@ -76,9 +177,9 @@ void test_display_draw_smoke() {
     display.drawWiFiStatus();
     display.drawProgressBar(0, 0, 100, 10, 50.0, 0xFFFF);
     
-    HistoryBuffer<uint64_t, 60> buffer;
-    buffer.push(10);
-    display.drawSparkline(0, 0, 100, 20, buffer, 0xFFFF);
+    RollupSeries series;
+    series.push(10, 0);
+    display.drawRollupGraph(0, 0, 100, 20, series, RANGE_MINUTE, 0xFFFF);
     
     display.drawResourcesPage(state, true);
     display.drawResourcesPage(state, false);
@@ -131,12 +232,12 @@ void test_display_manager_extended() {
     state.cpu_percent = 60; // Yellow progress bar
     display.drawResourcesPage(state, false);
     
-    // Test Sparkline with 0 max
-    HistoryBuffer<uint64_t, 60> emptyBuffer;
-    display.drawSparkline(0, 0, 100, 20, emptyBuffer, 0xFFFF);
-    emptyBuffer.push(0);
-    emptyBuffer.push(0);
-    display.drawSparkline(0, 0, 100, 20, emptyBuffer, 0xFFFF);
+    // Test graph with 0 max
+    RollupSeries empty;
+    display.drawRollupGraph(0, 0, 100, 20, empty, RANGE_MINUTE, 0xFFFF);
+    empty.push(0, 0);
+    empty.push(0, 1000);
+    display.drawRollupGraph(0, 0, 100, 20, empty, RANGE_MINUTE, 0xFFFF);
     
     // Test other screens
     display.drawBootScreen("1.0.0");
@@ -163,15 +264,15 @@ void test_input_click(void) {
 
     input.begin();
     _mock_digitalRead_val = LOW;
-    input.update(state, page, lastPageChange, needsStaticDraw, "v1");
+    input.update(state, page, lastPageChange, needsStaticDraw);
     _mock_millis += 60;
-    input.update(state, page, lastPageChange, needsStaticDraw, "v1");
+    input.update(state, page, lastPageChange, needsStaticDraw);
     _mock_digitalRead_val = HIGH;
-    input.update(state, page, lastPageChange, needsStaticDraw, "v1");
+    input.update(state, page, lastPageChange, needsStaticDraw);
     _mock_millis += 60;
-    input.update(state, page, lastPageChange, needsStaticDraw, "v1");
+    input.update(state, page, lastPageChange, needsStaticDraw);
     _mock_millis += 400;
-    input.update(state, page, lastPageChange, needsStaticDraw, "v1");
+    input.update(state, page, lastPageChange, needsStaticDraw);
 
     TEST_ASSERT_TRUE(needsStaticDraw);
     TEST_ASSERT_EQUAL(PAGE_RESOURCES, page);
@@ -188,25 +289,25 @@ void test_input_double_click_and_hold(void) {
     input.begin();
     
     // 1. Click 1
-    _mock_digitalRead_val = LOW; _mock_millis += 60; input.update(state, page, lastPageChange, needsStaticDraw, "v1");
-    _mock_digitalRead_val = HIGH; _mock_millis += 60; input.update(state, page, lastPageChange, needsStaticDraw, "v1");
+    _mock_digitalRead_val = LOW; _mock_millis += 60; input.update(state, page, lastPageChange, needsStaticDraw);
+    _mock_digitalRead_val = HIGH; _mock_millis += 60; input.update(state, page, lastPageChange, needsStaticDraw);
     
     // 2. Click 2 (within double click window)
-    _mock_digitalRead_val = LOW; _mock_millis += 60; input.update(state, page, lastPageChange, needsStaticDraw, "v1");
+    _mock_digitalRead_val = LOW; _mock_millis += 60; input.update(state, page, lastPageChange, needsStaticDraw);
     
     // Release
-    _mock_digitalRead_val = HIGH; _mock_millis += 60; input.update(state, page, lastPageChange, needsStaticDraw, "v1");
+    _mock_digitalRead_val = HIGH; _mock_millis += 60; input.update(state, page, lastPageChange, needsStaticDraw);
 
     // Hold (for screen toggle)
-    _mock_digitalRead_val = LOW; _mock_millis += 60; input.update(state, page, lastPageChange, needsStaticDraw, "v1");
+    _mock_digitalRead_val = LOW; _mock_millis += 60; input.update(state, page, lastPageChange, needsStaticDraw);
     _mock_millis += 1000;
-    input.update(state, page, lastPageChange, needsStaticDraw, "v1");
-    _mock_digitalRead_val = HIGH; _mock_millis += 60; input.update(state, page, lastPageChange, needsStaticDraw, "v1");
+    input.update(state, page, lastPageChange, needsStaticDraw);
+    _mock_digitalRead_val = HIGH; _mock_millis += 60; input.update(state, page, lastPageChange, needsStaticDraw);
     
     // Auto-off simulation
     input.notifyActivity();
     _mock_millis += 70000;
-    input.update(state, page, lastPageChange, needsStaticDraw, "v1");
+    input.update(state, page, lastPageChange, needsStaticDraw);
 }
 
 void test_input_notify_activity(void) {
@@ -304,11 +405,11 @@ public:
     static void test() {
         SideEyeNetworkManager nm;
         SystemState state;
-        unsigned long retry = 0;
+        BLEPresenceManager ble;
         
         // 1. Initial state (disconnected)
-        nm.update(retry); 
-        nm.publishState(state);
+        nm.update();
+        nm.publishState(state, ble);
         
         // 2. Setup with config
         LittleFS._setFile("/config.json", "{\"mqtt_server\":\"localhost\",\"mqtt_port\":1883,\"mqtt_user\":\"user\",\"mqtt_pass\":\"pass\"}");
@@ -316,11 +417,11 @@ public:
         
         // 3. Trigger reconnect
         nm._mqttClient._setConnected(false);
-        nm.update(retry);
+        nm.update();
         
         // 4. Publish while connected
         nm._mqttClient._setConnected(true);
-        nm.publishState(state);
+        nm.publishState(state, ble);
         
         // 5. Discovery
         nm.publishHADiscovery();
@@ -332,9 +433,13 @@ public:
         nm2.reconnectMQTT(); // Test anonymous MQTT connect
         
         // 7. Save config paths
+        state.brightness = 10;
         nm.saveConfig(state, true);
-        LittleFS._setFailNextOpen(true);
+        TEST_ASSERT_TRUE(nm.flushConfig());
+        state.brightness = 20;
         nm.saveConfig(state, true);
+        LittleFS._setFailNextOpen(true);
+        TEST_ASSERT_FALSE(nm.flushConfig());
 
         // 8. Reset settings
         ESP._restarted = false;
@@ -348,6 +453,463 @@ public:
         nm._mqttClient._setState(-1);
         nm.reconnectMQTT();
     }
+
+    static void testPublishAllocations() {
+        SideEyeNetworkManager nm;
+        SystemState state;
+        BLEPresenceManager ble;
+        nm.begin("DEV1", "1.0.0", state, dummy_callback, dummy_config_callback, dummy_callback);
+        strcpy(nm.mqtt_topic_prefix, "side-eye");
+        nm._mqttClient._setConnected(false);
+        nm.reconnectMQTT();
+        TEST_ASSERT_EQUAL_STRING("side-eye/DEV1/state", nm.topic(TOPIC_STATE));
+        TEST_ASSERT_EQUAL_STRING("side-eye/DEV1/set/#", nm.topic(TOPIC_SET));
+        nm.setDrainRate(NUM_TOPICS, 100);
+
+        state.hostname = "my-host-\"quoted\"";
+        state.cycle_duration = 12000;
+        int before = nm._mqttClient._publishCount;
+        size_t allocations = _mock_allocations;
+        nm.publishState(state, ble);
+        TEST_ASSERT_EQUAL(0, _mock_allocations - allocations);
+        TEST_ASSERT_EQUAL(11, nm._mqttClient._publishCount - before);
+
+        const MockPublish* doc = nm._mqttClient._find("side-eye/DEV1/state");
+        TEST_ASSERT_NOT_NULL(doc);
+        TEST_ASSERT_EQUAL_STRING("{\"hostname\":\"my-host-\\\"quoted\\\"\",\"ip\":\"No IP\","
+                                 "\"mac\":\"No MAC\",\"rssi\":-50,\"ble_status\":\"Disabled\",\"ble_present\":false}",
+                                 doc->payload);
+        const MockPublish* cycle = nm._mqttClient._find("side-eye/DEV1/state/cycle_duration");
+        TEST_ASSERT_NOT_NULL(cycle);
+        TEST_ASSERT_EQUAL_STRING("12000", cycle->payload);
+        TEST_ASSERT_TRUE(cycle->retained);
+    }
+
+    static void testPublishChangesOnly() {
+        SideEyeNetworkManager nm;
+        SystemState state;
+        BLEPresenceManager ble;
+        nm.begin("DEV1", "1.0.0", state, dummy_callback, dummy_config_callback, dummy_callback);
+        strcpy(nm.mqtt_topic_prefix, "side-eye");
+        nm._mqttClient._setConnected(false);
+        nm.reconnectMQTT();
+        nm.setRssiInterval(30000);
+        nm.setDrainRate(NUM_TOPICS, 100);
+
+        int& count = nm._mqttClient._publishCount;
+        int before = count;
+        nm.publishState(state, ble);
+        TEST_ASSERT_EQUAL(11, count - before);
+
+        // A minute of 1 Hz Stats with a drifting RSSI: one refresh per interval
+        before = count;
+        for (int i = 1; i <= 60; i++) {
+            _mock_millis = i * 1000;
+            WiFi._rssi = -50 - i;
+            nm.publishState(state, ble);
+        }
+        TEST_ASSERT_EQUAL(2, count - before);
+
+        // Only the edited setting goes out
+        before = count;
+        state.cpu_warning = 60;
+        nm.publishState(state, ble);
+        TEST_ASSERT_EQUAL(1, count - before);
+        TEST_ASSERT_EQUAL_STRING("60", nm._mqttClient._find("side-eye/DEV1/state/cpu_warning")->payload);
+
+        // Identity changes republish the document immediately
+        before = count;
+        state.hostname = "renamed";
+        nm.publishState(state, ble);
+        TEST_ASSERT_EQUAL(1, count - before);
+
+        // A reconnect resends everything
+        nm._mqttClient._setConnected(false);
+        nm.reconnectMQTT();
+        _mock_millis += 100;
+        before = count;
+        nm.publishState(state, ble);
+        TEST_ASSERT_EQUAL(11, count - before);
+        WiFi._rssi = -50;
+    }
+
+    static void testDiscoveryStreamed() {
+        SideEyeNetworkManager nm;
+        SystemState state;
+        nm.begin("DEV1", "1.2.3", state, dummy_callback, dummy_config_callback, dummy_callback);
+        strcpy(nm.mqtt_topic_prefix, "side-eye");
+        strcpy(nm.mqtt_discovery_prefix, "homeassistant");
+        nm._mqttClient._setConnected(false);
+
+        int before = nm._mqttClient._publishCount;
+        size_t allocations = _mock_allocations;
+        nm.reconnectMQTT();
+        // "online" plus the discovery configs
+        TEST_ASSERT_EQUAL((int)SideEyeNetworkManager::DISCOVERY_COUNT + 1, nm._mqttClient._publishCount - before);
+        TEST_ASSERT_EQUAL(0, nm._mqttClient._lengthMismatches);
+
+        const MockPublish* host = nm._mqttClient._find("homeassistant/sensor/side_eye_DEV1_hostname/config");
+        TEST_ASSERT_NOT_NULL(host);
+        TEST_ASSERT_TRUE(host->retained);
+        TEST_ASSERT_EQUAL_STRING(
+            "{\"name\":\"SideEye DEV1 Hostname\",\"state_topic\":\"side-eye/DEV1/state\","
+            "\"value_template\":\"{{ value_json.hostname }}\",\"unique_id\":\"side_eye_DEV1_hostname\","
+            "\"icon\":\"mdi:label\",\"device\":{\"identifiers\":[\"side_eye_DEV1\"],\"name\":\"SideEye DEV1\","
+            "\"model\":\"ESP32-C6 GEEK\",\"manufacturer\":\"Waveshare\",\"sw_version\":\"1.2.3\"}}",
+            host->payload);
+        const MockPublish* status = nm._mqttClient._find("homeassistant/binary_sensor/side_eye_DEV1_status/config");
+        TEST_ASSERT_NOT_NULL(status);
+        TEST_ASSERT_NOT_NULL(strstr(status->payload, "\"state_topic\":\"side-eye/DEV1/status\""));
+#ifdef SIDEEYE_LOOP_METRICS
+        const MockPublish* render = nm._mqttClient._find("homeassistant/sensor/side_eye_DEV1_loop_render/config");
+        TEST_ASSERT_NOT_NULL(render);
+        TEST_ASSERT_NOT_NULL(strstr(render->payload, "\"value_template\":\"{{ value_json.render_p99 }}\""));
+#endif
+
+        // Unchanged configs aren't resent on reconnect...
+        nm._mqttClient._setConnected(false);
+        before = nm._mqttClient._publishCount;
+        nm.reconnectMQTT();
+        TEST_ASSERT_EQUAL(1, nm._mqttClient._publishCount - before);
+        TEST_ASSERT_FALSE(nm.publishHADiscovery());
+
+        // ...but a new discovery prefix publishes the full set
+        nm.setDiscoveryPrefix("ha");
+        allocations = _mock_allocations;
+        TEST_ASSERT_TRUE(nm.publishHADiscovery());
+        TEST_ASSERT_EQUAL(0, _mock_allocations - allocations);
+        TEST_ASSERT_NOT_NULL(nm._mqttClient._find("ha/sensor/side_eye_DEV1_rssi/config"));
+    }
+
+    // Runs update() until the phase changes or `limit` ms pass, 10 ms a loop.
+    // DNS answers between loops, so a lookup takes two.
+    static MqttPhase stepUntilChange(SideEyeNetworkManager& nm, unsigned long limit) {
+        MqttPhase start = nm.mqttPhase();
+        for (unsigned long t = 0; t < limit && nm.mqttPhase() == start; t += 10) {
+            nm.update();
+            _mock_broker.answerDns();
+            if (nm.mqttPhase() == start) _mock_millis += 10;
+        }
+        return nm.mqttPhase();
+    }
+
+    static void testConnectStateMachine() {
+        SideEyeNetworkManager nm;
+        SystemState state;
+        nm.begin("DEV1", "1.0.0", state, dummy_callback, dummy_config_callback, dummy_callback);
+        strcpy(nm.mqtt_server, "broker.lan");
+        strcpy(nm.mqtt_topic_prefix, "side-eye");
+
+        // Broker down: every attempt fails at TCP and the waits grow
+        _mock_broker.reachable = false;
+        unsigned long lastFailure = 0, lastWait = 0;
+        for (int attempt = 1; attempt <= 10; attempt++) {
+            TEST_ASSERT_EQUAL(MQTT_RESOLVE, stepUntilChange(nm, 600000));
+            TEST_ASSERT_EQUAL(MQTT_TCP, stepUntilChange(nm, 20));
+            TEST_ASSERT_EQUAL(MQTT_BACKOFF, stepUntilChange(nm, 10));
+            TEST_ASSERT_EQUAL(attempt, _mock_broker.tcpAttempts);
+
+            unsigned long wait = nm.nextAttempt() - _mock_millis;
+            unsigned long cap = SideEyeNetworkManager::BACKOFF_BASE_MS << (attempt - 1);
+            if (cap > SideEyeNetworkManager::BACKOFF_MAX_MS) cap = SideEyeNetworkManager::BACKOFF_MAX_MS;
+            TEST_ASSERT_TRUE(wait >= cap / 2 && wait <= cap);
+            if (attempt > 1 && cap < SideEyeNetworkManager::BACKOFF_MAX_MS) TEST_ASSERT_TRUE(wait > lastWait / 2);
+            lastWait = wait;
+            lastFailure = _mock_millis;
+        }
+        // Ten failures span minutes, not the 50 s of a fixed 5 s retry
+        TEST_ASSERT_TRUE(lastFailure > 5UL * 60 * 1000);
+        // The name is looked up again after each TCP failure
+        TEST_ASSERT_EQUAL(10, _mock_broker.dnsLookups);
+
+        // Broker back, behind a slow resolver: the lookup is polled, not
+        // waited on, and only issued once
+        _mock_broker.reachable = true;
+        TEST_ASSERT_EQUAL(MQTT_RESOLVE, stepUntilChange(nm, 600000));
+        for (int i = 0; i < 50; i++) nm.update();
+        TEST_ASSERT_EQUAL(MQTT_RESOLVE, nm.mqttPhase());
+        TEST_ASSERT_EQUAL(11, _mock_broker.dnsLookups);
+        TEST_ASSERT_TRUE(_mock_broker.answerDns());
+        // Then one step per update() through to connected
+        TEST_ASSERT_EQUAL(MQTT_TCP, stepUntilChange(nm, 10));
+        TEST_ASSERT_EQUAL(MQTT_HANDSHAKE, stepUntilChange(nm, 10));
+        TEST_ASSERT_EQUAL(0, _mock_broker.mqttAttempts);
+        TEST_ASSERT_EQUAL(MQTT_SUBSCRIBE, stepUntilChange(nm, 10));
+        TEST_ASSERT_EQUAL(1, _mock_broker.mqttAttempts);
+        TEST_ASSERT_EQUAL(MQTT_DISCOVERY, stepUntilChange(nm, 10));
+        TEST_ASSERT_EQUAL(MQTT_CONNECTED, stepUntilChange(nm, 10));
+        TEST_ASSERT_EQUAL_STRING("online", nm._mqttClient._find("side-eye/DEV1/status")->payload);
+
+        // A dropped connection retries quickly, since the backoff was reset
+        nm._mqttClient._setConnected(false);
+        nm.update();
+        TEST_ASSERT_EQUAL(MQTT_BACKOFF, nm.mqttPhase());
+        TEST_ASSERT_TRUE(nm.nextAttempt() - _mock_millis <= SideEyeNetworkManager::BACKOFF_BASE_MS);
+
+        // A broker refusing the CONNECT backs off too; IP literals skip DNS
+        _mock_broker.accepts = false;
+        strcpy(nm.mqtt_server, "192.168.1.5");
+        nm._brokerResolved = false;
+        int lookups = _mock_broker.dnsLookups;
+        TEST_ASSERT_EQUAL(MQTT_RESOLVE, stepUntilChange(nm, 600000));
+        TEST_ASSERT_EQUAL(MQTT_TCP, stepUntilChange(nm, 10));
+        TEST_ASSERT_EQUAL(MQTT_HANDSHAKE, stepUntilChange(nm, 10));
+        TEST_ASSERT_EQUAL(MQTT_BACKOFF, stepUntilChange(nm, 10));
+        TEST_ASSERT_EQUAL(lookups, _mock_broker.dnsLookups);
+
+        // A name that doesn't resolve backs off without trying TCP
+        _mock_broker.resolvable = false;
+        strcpy(nm.mqtt_server, "gone.lan");
+        nm._brokerResolved = false;
+        int tcpAttempts = _mock_broker.tcpAttempts;
+        TEST_ASSERT_EQUAL(MQTT_RESOLVE, stepUntilChange(nm, 600000));
+        TEST_ASSERT_EQUAL(MQTT_BACKOFF, stepUntilChange(nm, 20));
+        TEST_ASSERT_EQUAL(lookups + 1, _mock_broker.dnsLookups);
+        TEST_ASSERT_EQUAL(tcpAttempts, _mock_broker.tcpAttempts);
+    }
+
+    static void testOfflineQueue() {
+        SideEyeNetworkManager nm;
+        SystemState state;
+        BLEPresenceManager ble;
+        nm.begin("DEV1", "1.0.0", state, dummy_callback, dummy_config_callback, dummy_callback);
+        strcpy(nm.mqtt_server, "localhost");
+        strcpy(nm.mqtt_topic_prefix, "side-eye");
+        nm.setRssiInterval(600000);
+        _mock_millis = 100000;
+
+        // Connected: a full refresh goes out DRAIN_BURST per interval
+        nm.reconnectMQTT();
+        int& count = nm._mqttClient._publishCount;
+        int before = count;
+        nm.publishState(state, ble);
+        TEST_ASSERT_EQUAL(4, count - before);
+        _mock_millis += 50;
+        nm.update();
+        TEST_ASSERT_EQUAL(4, count - before);
+        _mock_millis += 50;
+        nm.update();
+        TEST_ASSERT_EQUAL(8, count - before);
+        _mock_millis += 100;
+        nm.update();
+        TEST_ASSERT_EQUAL(11, count - before);
+        TEST_ASSERT_EQUAL(0, nm.queuedPublishes());
+
+        // Broker gone: changes are held, one per topic
+        nm._mqttClient._setConnected(false);
+        nm.update();
+        TEST_ASSERT_EQUAL(MQTT_BACKOFF, nm.mqttPhase());
+        before = count;
+        uint32_t coalesced = nm.queueCounters().coalesced;
+        for (int i = 1; i <= 5; i++) {
+            state.cpu_warning = 50 + i;
+            nm.publishState(state, ble);
+        }
+        state.hostname = "renamed";
+        nm.publishState(state, ble);
+        TEST_ASSERT_EQUAL(0, count - before);
+        TEST_ASSERT_EQUAL(2, nm.queuedPublishes());
+        TEST_ASSERT_EQUAL(coalesced + 4, nm.queueCounters().coalesced);
+
+        // Back: the reconnect's full refresh merges with what was held, so
+        // each topic goes out once, with its latest value
+        nm._mqttClient._setConnected(false);
+        nm.reconnectMQTT();
+        before = count;
+        nm.publishState(state, ble);
+        TEST_ASSERT_EQUAL(11, nm.queuedPublishes() + (count - before));
+        for (int i = 0; i < 5; i++) {
+            _mock_millis += 100;
+            nm.update();
+        }
+        TEST_ASSERT_EQUAL(11, count - before);
+        TEST_ASSERT_EQUAL_STRING("55", nm._mqttClient._find("side-eye/DEV1/state/cpu_warning")->payload);
+        TEST_ASSERT_EQUAL(0, nm.queueCounters().dropped);
+
+        // The boot report rides the same queue
+        _mock_millis += 100;
+        TEST_ASSERT_TRUE(nm.publishBootProfile("{\"type\":\"BootProfile\"}"));
+        const MockPublish* boot = nm._mqttClient._find("side-eye/DEV1/boot_profile");
+        TEST_ASSERT_NOT_NULL(boot);
+        TEST_ASSERT_TRUE(boot->retained);
+    }
+
+    static void testOfflineOneShots() {
+        SideEyeNetworkManager nm;
+        SystemState state;
+        BLEPresenceManager ble;
+        nm.begin("DEV1", "1.0.0", state, dummy_callback, dummy_config_callback, dummy_callback);
+        strcpy(nm.mqtt_server, "localhost");
+        strcpy(nm.mqtt_topic_prefix, "side-eye");
+        nm.setRssiInterval(600000);
+
+        // Never connected: every queueable topic is held at once
+        LoopMetrics metrics(160);
+        metrics.record(STAGE_RENDER, 160 * 900);
+        nm.publishState(state, ble);
+        TEST_ASSERT_TRUE(nm.publishBootProfile("{\"type\":\"BootProfile\"}"));
+        TEST_ASSERT_TRUE(nm.publishMetrics(metrics));
+        for (int i = 0; i < 100; i++) {
+            state.cpu_warning = 50 + i % 40;
+            nm.publishState(state, ble);
+        }
+        TEST_ASSERT_EQUAL(SideEyeNetworkManager::QUEUE_SLOTS, nm.queuedPublishes());
+        TEST_ASSERT_EQUAL(0, nm.queueCounters().dropped);
+
+        nm._mqttClient._setConnected(false);
+        nm.reconnectMQTT();
+        for (int i = 0; i < 5; i++) {
+            _mock_millis += 100;
+            nm.update();
+        }
+        TEST_ASSERT_EQUAL(0, nm.queuedPublishes());
+        TEST_ASSERT_NOT_NULL(nm._mqttClient._find("side-eye/DEV1/state"));
+        TEST_ASSERT_NOT_NULL(nm._mqttClient._find("side-eye/DEV1/state/cpu_warning"));
+        TEST_ASSERT_NOT_NULL(nm._mqttClient._find("side-eye/DEV1/metrics"));
+        const MockPublish* boot = nm._mqttClient._find("side-eye/DEV1/boot_profile");
+        TEST_ASSERT_NOT_NULL(boot);
+        TEST_ASSERT_TRUE(boot->retained);
+    }
+
+    static void testConfigMigration() {
+        LittleFS._setFile("/config.json", "{\"mqtt_server\":\"broker.lan\",\"brightness\":77,\"cycle_duration\":9000}");
+        SystemState state;
+        SideEyeNetworkManager nm;
+        nm.begin("DEV1", "1.0.0", state, dummy_callback, dummy_config_callback, dummy_callback);
+        TEST_ASSERT_EQUAL_STRING("broker.lan", nm.mqtt_server);
+        TEST_ASSERT_FALSE(LittleFS.exists("/config.json"));
+        TEST_ASSERT_EQUAL(1, nm._config.writes());
+
+        // Next boot reads the record
+        SystemState restored;
+        SideEyeNetworkManager next;
+        next.begin("DEV1", "1.0.0", restored, dummy_callback, dummy_config_callback, dummy_callback);
+        TEST_ASSERT_EQUAL_STRING("broker.lan", next.mqtt_server);
+        TEST_ASSERT_EQUAL(77, restored.brightness);
+        TEST_ASSERT_EQUAL(9000, restored.cycle_duration);
+
+        // A slider drag from Home Assistant: one write once it settles
+        for (int i = 0; i < 20; i++) {
+            _mock_millis += 100;
+            restored.brightness = 100 + i;
+            next.saveConfig(restored, true);
+            next.update();
+        }
+        TEST_ASSERT_EQUAL(0, next._config.writes());
+        _mock_millis += 2000;
+        next.update();
+        TEST_ASSERT_EQUAL(1, next._config.writes());
+
+        // Setting it back to the stored value writes nothing
+        next.saveConfig(restored, true);
+        _mock_millis += 5000;
+        next.update();
+        TEST_ASSERT_EQUAL(1, next._config.writes());
+    }
+
+    static void testWifiBringUp() {
+        SideEyeNetworkManager nm;
+        SystemState state;
+        WiFi._status = WL_DISCONNECTED;
+        _mock_millis = 1000;
+        nm.begin("DEV1", "1.0.0", state, dummy_callback, dummy_config_callback, dummy_callback);
+        strcpy(nm.mqtt_server, "broker.lan");
+        TEST_ASSERT_EQUAL(1000, _mock_millis); // Nothing waited on
+        TEST_ASSERT_EQUAL(1, WiFi._begins);
+        TEST_ASSERT_EQUAL(WIFI_JOINING, nm.wifiPhase());
+
+        // MQTT holds off until WiFi is up
+        _mock_millis += 5000;
+        nm.update();
+        TEST_ASSERT_EQUAL(WIFI_JOINING, nm.wifiPhase());
+        TEST_ASSERT_EQUAL(MQTT_BACKOFF, nm.mqttPhase());
+        TEST_ASSERT_EQUAL(0, _mock_broker.dnsLookups);
+
+        // The saved network never answers: the portal opens without blocking
+        _mock_millis = 1000 + SideEyeNetworkManager::WIFI_JOIN_TIMEOUT_MS;
+        nm.update();
+        TEST_ASSERT_EQUAL(WIFI_PORTAL, nm.wifiPhase());
+        TEST_ASSERT_EQUAL(1, nm._wm._portalStarts);
+        nm.update();
+        TEST_ASSERT_EQUAL(WIFI_PORTAL, nm.wifiPhase());
+
+        // Credentials saved: the portal's settings are taken and MQTT starts
+        nm._serverParam.setValue("broker2.lan", 40);
+        nm._wm._portalDone = true;
+        WiFi._status = WL_CONNECTED;
+        nm.update();
+        TEST_ASSERT_EQUAL(WIFI_UP, nm.wifiPhase());
+        TEST_ASSERT_TRUE(nm._udpListening);
+        TEST_ASSERT_EQUAL_STRING("broker2.lan", nm.mqtt_server);
+        TEST_ASSERT_EQUAL(MQTT_RESOLVE, nm.mqttPhase());
+
+        // Nothing saved and no build-time network: straight to the portal
+        SideEyeNetworkManager fresh;
+        fresh._wm._wifiSaved = false;
+        fresh.begin("DEV2", "1.0.0", state, dummy_callback, dummy_config_callback, dummy_callback);
+        TEST_ASSERT_EQUAL(WIFI_PORTAL, fresh.wifiPhase());
+    }
+
+    static void testPublishMetrics() {
+        SideEyeNetworkManager nm;
+        SystemState state;
+        nm.begin("DEV1", "1.0.0", state, dummy_callback, dummy_config_callback, dummy_callback);
+        strcpy(nm.mqtt_topic_prefix, "side-eye");
+        nm._mqttClient._setConnected(false);
+        nm.reconnectMQTT();
+
+        LoopMetrics metrics(160);
+        metrics.record(STAGE_RENDER, 160 * 900);
+        metrics.record(STAGE_LOOP, 160 * 1000);
+        TEST_ASSERT_TRUE(nm.publishMetrics(metrics));
+        const MockPublish* published = nm._mqttClient._find("side-eye/DEV1/metrics");
+        TEST_ASSERT_NOT_NULL(published);
+        TEST_ASSERT_NOT_NULL(strstr(published->payload, "\"render_p99\":900,\"render_max\":900"));
+        TEST_ASSERT_NOT_NULL(strstr(published->payload, "\"input_p99\":0,\"input_max\":0"));
+
+        // Worst case still fits the queue
+        for (uint8_t i = 0; i < NUM_LOOP_STAGES; i++) metrics.record(static_cast<LoopStage>(i), 0xFFFFFFFF);
+        metrics.setCpuMhz(1);
+        TEST_ASSERT_TRUE(nm.publishMetrics(metrics));
+    }
+
+    static void testUdpTelemetry() {
+        SideEyeNetworkManager nm;
+        SystemState state;
+        nm.begin("DEV1", "1.0.0", state, dummy_callback, dummy_config_callback, dummy_callback);
+        nm.update(); // Joins, then starts listening
+        HostTable hosts;
+
+        _mock_udp_packets.push_back("{\"type\":\"Identity\",\"host\":\"rack1-a\",\"data\":{\"hostname\":\"alpha\",\"ip\":\"10.0.0.5\"}}");
+        _mock_udp_packets.push_back("{\"type\":\"Stats\",\"host\":\"rack1-b\",\"data\":{\"cpu_percent\":12.5,"
+                                    "\"ram_used\":2147483648,\"ram_total\":8589934592,\"net_up\":1000}}");
+        _mock_udp_packets.push_back("{\"type\":\"Stats\",\"host\":\"rack1-a\",\"data\":{\"cpu_percent\":99}}");
+        _mock_udp_packets.push_back("not json");
+        _mock_udp_packets.push_back("{\"type\":\"Stats\",\"data\":{\"cpu_percent\":1}}"); // No host
+        _mock_udp_packets.push_back("{\"type\":\"GetVersion\",\"host\":\"rack1-c\"}");     // Not telemetry
+        _mock_udp_packets.push_back(std::string(600, ' '));                                     // Oversized
+
+        TEST_ASSERT_EQUAL(3, nm.pollTelemetry(hosts, 1000, 8));
+        TEST_ASSERT_TRUE(_mock_udp_packets.empty());
+        TEST_ASSERT_EQUAL(2, hosts.count());
+
+        int8_t a = hosts.find("rack1-a");
+        int8_t b = hosts.find("rack1-b");
+        TEST_ASSERT_EQUAL(0, a);
+        TEST_ASSERT_EQUAL(1, b);
+        TEST_ASSERT_EQUAL_STRING("alpha", hosts.state(a).hostname.c_str());
+        TEST_ASSERT_FLOAT_WITHIN(0.01, 99.0, hosts.state(a).cpu_percent);
+        TEST_ASSERT_FLOAT_WITHIN(0.01, 12.5, hosts.state(b).cpu_percent);
+        TEST_ASSERT_EQUAL(2048, hosts.state(b).ram_used_mb);
+        TEST_ASSERT_EQUAL(1000, hosts.state(b).net_up);
+        TEST_ASSERT_TRUE(hosts.state(b).connected);
+
+        // At most maxPackets per call, so a flood can't stall the loop
+        for (int i = 0; i < 10; i++) _mock_udp_packets.push_back("{\"type\":\"Stats\",\"host\":\"rack1-a\",\"data\":{}}");
+        TEST_ASSERT_EQUAL(4, nm.pollTelemetry(hosts, 2000));
+        TEST_ASSERT_EQUAL(6, (int)_mock_udp_packets.size());
+        _mock_udp_packets.clear();
+    }
 };
 
 void test_network_manager_full() {
@@ -355,6 +917,197 @@ void test_network_manager_full() {
     NetworkManagerTest::testFailure();
 }
 
+void test_network_publish_no_alloc() {
+    NetworkManagerTest::testPublishAllocations();
+}
+
+void test_network_publish_changes_only() {
+    NetworkManagerTest::testPublishChangesOnly();
+}
+
+void test_network_discovery_streamed() {
+    NetworkManagerTest::testDiscoveryStreamed();
+}
+
+void test_network_connect_state_machine() {
+    NetworkManagerTest::testConnectStateMachine();
+}
+
+void test_network_offline_queue() {
+    NetworkManagerTest::testOfflineQueue();
+}
+
+void test_network_offline_one_shots() {
+    NetworkManagerTest::testOfflineOneShots();
+}
+
+void test_network_config_migration() {
+    NetworkManagerTest::testConfigMigration();
+}
+
+void test_network_wifi_bring_up() {
+    NetworkManagerTest::testWifiBringUp();
+}
+
+void test_network_publish_metrics() {
+    NetworkManagerTest::testPublishMetrics();
+}
+
+void test_network_udp_telemetry() {
+    NetworkManagerTest::testUdpTelemetry();
+}
+
+void test_publish_queue(void) {
+    PublishQueue<3, 8> queue;
+    int16_t evicted;
+    TEST_ASSERT_TRUE(queue.push(1, "a", true, &evicted));
+    TEST_ASSERT_EQUAL(-1, evicted);
+    TEST_ASSERT_TRUE(queue.push(2, "b", false));
+    TEST_ASSERT_TRUE(queue.push(1, "a2", true)); // Replaces in place
+    TEST_ASSERT_EQUAL(2, queue.size());
+    TEST_ASSERT_EQUAL(1, queue.front()->key);
+    TEST_ASSERT_EQUAL_STRING("a2", queue.front()->payload);
+
+    // Full: the oldest goes, and the caller learns which
+    TEST_ASSERT_TRUE(queue.push(3, "c", true));
+    TEST_ASSERT_TRUE(queue.push(4, "d", true, &evicted));
+    TEST_ASSERT_EQUAL(1, evicted);
+    TEST_ASSERT_EQUAL(3, queue.size());
+    TEST_ASSERT_FALSE(queue.push(5, "too long", true));
+
+    const char* expected[] = {"b", "c", "d"};
+    for (int i = 0; i < 3; i++) {
+        TEST_ASSERT_EQUAL_STRING(expected[i], queue.front()->payload);
+        queue.sent();
+    }
+    TEST_ASSERT_NULL(queue.front());
+    TEST_ASSERT_EQUAL(4, queue.counters().queued);
+    TEST_ASSERT_EQUAL(1, queue.counters().coalesced);
+    TEST_ASSERT_EQUAL(2, queue.counters().dropped);
+    TEST_ASSERT_EQUAL(3, queue.counters().sent);
+}
+
+void test_config_store(void) {
+    ConfigStore store(2000, 10000);
+    ConfigData config;
+    strcpy(config.mqtt_server, "broker");
+    config.brightness = 10;
+
+    // Debounced: written once changes stop for 2 s
+    TEST_ASSERT_TRUE(store.request(config, 0));
+    TEST_ASSERT_FALSE(store.update(1000));
+    config.brightness = 20;
+    store.request(config, 1500);
+    TEST_ASSERT_FALSE(store.update(3000));
+    TEST_ASSERT_TRUE(store.update(3500));
+    TEST_ASSERT_EQUAL(1, store.writes());
+
+    // Unchanged settings are never written
+    TEST_ASSERT_FALSE(store.request(config, 4000));
+    TEST_ASSERT_FALSE(store.update(10000));
+
+    // Changes that never settle still go out after the maximum delay
+    unsigned long now = 20000;
+    while (store.writes() == 1 && now < 40000) {
+        config.brightness++;
+        store.request(config, now);
+        store.update(now);
+        now += 500;
+    }
+    TEST_ASSERT_EQUAL(2, store.writes());
+    TEST_ASSERT_TRUE(now - 20000 <= 10500);
+
+    ConfigData loaded;
+    ConfigStore reader;
+    TEST_ASSERT_TRUE(reader.load(loaded));
+    TEST_ASSERT_TRUE(loaded == config);
+    TEST_ASSERT_EQUAL(2, reader.sequence());
+
+    // A corrupt newest record falls back to the previous one
+    char path[20];
+    ConfigStore::slotPath(2 % ConfigStore::SLOTS, path, sizeof(path));
+    _mock_lfs_files[path][20] ^= 0x01;
+    TEST_ASSERT_TRUE(reader.load(loaded));
+    TEST_ASSERT_EQUAL(20, loaded.brightness);
+    TEST_ASSERT_EQUAL_STRING("broker", loaded.mqtt_server);
+
+    store.clear();
+    TEST_ASSERT_FALSE(ConfigStore().load(loaded));
+}
+
+void test_boot_profile(void) {
+    BootProfile profile;
+    profile.start(BOOT_SD, 1200);
+    profile.finish(BOOT_SD, 81600);
+    profile.start(BOOT_GFX, 81600);
+    profile.finish(BOOT_GFX, 250000);
+    profile.start(BOOT_WIFI, 260000);
+    TEST_ASSERT_EQUAL(80400, profile.duration(BOOT_SD));
+    TEST_ASSERT_EQUAL(0, profile.duration(BOOT_WIFI));
+    TEST_ASSERT_EQUAL(250000, profile.total());
+    TEST_ASSERT_FALSE(profile.complete());
+
+    char line[BootProfile::LINE_SIZE];
+    TEST_ASSERT_TRUE(profile.format("1.2.0", line, sizeof(line)));
+    TEST_ASSERT_EQUAL_STRING("{\"type\":\"BootProfile\",\"data\":{\"version\":\"1.2.0\",\"total_us\":250000,"
+                             "\"phases\":{\"sd\":[1200,80400],\"gfx\":[81600,168400],\"littlefs\":null,"
+                             "\"history\":null,\"config\":null,\"first_frame\":null,\"ble\":null,"
+                             "\"wifi\":null,\"mqtt\":null}}}",
+                             line);
+
+    // Every phase at its widest still fits the line (and an MQTT payload)
+    for (uint8_t i = 0; i < NUM_BOOT_PHASES; i++) {
+        profile.start(static_cast<BootPhase>(i), 0);
+        profile.finish(static_cast<BootPhase>(i), 4000000000u);
+    }
+    TEST_ASSERT_TRUE(profile.complete());
+    TEST_ASSERT_TRUE(profile.format("10.20.30-rc.1+abcdef", line, sizeof(line)));
+    char tiny[32];
+    TEST_ASSERT_FALSE(profile.format("1.2.0", tiny, sizeof(tiny)));
+}
+
+void test_host_table(void) {
+    HostTable hosts(10000);
+    char id[16];
+    for (int i = 0; i < HostTable::MAX_HOSTS; i++) {
+        snprintf(id, sizeof(id), "host-%d", i);
+        TEST_ASSERT_EQUAL(i, hosts.touch(id, 0));
+    }
+    for (int i = 0; i < HostTable::MAX_HOSTS; i++) {
+        snprintf(id, sizeof(id), "host-%d", i);
+        TEST_ASSERT_EQUAL(i, hosts.find(id));
+    }
+    TEST_ASSERT_EQUAL(HostTable::NONE, hosts.find("host-99"));
+    TEST_ASSERT_EQUAL(HostTable::NONE, hosts.touch("", 0));
+
+    // Full, and nobody has gone quiet: a newcomer is turned away
+    TEST_ASSERT_EQUAL(HostTable::NONE, hosts.touch("newcomer", 5000));
+
+    // Once host-3 is the longest silent past the expiry, it gives up its slot
+    for (int i = 0; i < HostTable::MAX_HOSTS; i++) {
+        snprintf(id, sizeof(id), "host-%d", i);
+        if (i != 3) hosts.touch(id, 8000);
+    }
+    hosts.state(3).cpu_percent = 50;
+    TEST_ASSERT_EQUAL(3, hosts.touch("newcomer", 12000));
+    TEST_ASSERT_EQUAL(HostTable::NONE, hosts.find("host-3"));
+    TEST_ASSERT_EQUAL(3, hosts.find("newcomer"));
+    TEST_ASSERT_EQUAL(0, hosts.state(3).cpu_percent);
+    TEST_ASSERT_EQUAL(5, hosts.find("host-5"));
+
+    // IDs past the capacity are truncated consistently
+    TEST_ASSERT_EQUAL(HostTable::NONE, hosts.touch("a-very-long-host-identifier-0", 12000));
+    hosts.expire(30000);
+    TEST_ASSERT_FALSE(hosts.state(0).connected);
+    int8_t slot = hosts.touch("a-very-long-host-identifier-0", 30000);
+    TEST_ASSERT_NOT_EQUAL(HostTable::NONE, slot);
+    TEST_ASSERT_EQUAL(slot, hosts.find("a-very-long-host-identifier-1"));
+
+    // Rotation visits connected hosts only
+    TEST_ASSERT_EQUAL(slot, hosts.nextConnected(HostTable::NONE));
+    TEST_ASSERT_EQUAL(HostTable::NONE, hosts.nextConnected(slot));
+}
+
 void test_input_handler_extended() {
     SystemState state;
     Page page = PAGE_IDENTITY;
@@ -366,19 +1119,19 @@ void test_input_handler_extended() {
     DisplayManager display;
     InputHandler input(9, display);
     input.begin();
-    input.update(state, page, lastPageChange, needsStaticDraw, "v1"); // Register HIGH
+    input.update(state, page, lastPageChange, needsStaticDraw); // Register HIGH
     
     // Test Hold (toggle screen)
     _mock_digitalRead_val = LOW;
-    input.update(state, page, lastPageChange, needsStaticDraw, "v1"); // Start press
+    input.update(state, page, lastPageChange, needsStaticDraw); // Start press
     _mock_millis += 100;
-    input.update(state, page, lastPageChange, needsStaticDraw, "v1"); // Register press
+    input.update(state, page, lastPageChange, needsStaticDraw); // Register press
     _mock_millis += 1000;
-    input.update(state, page, lastPageChange, needsStaticDraw, "v1"); // Register HOLD
+    input.update(state, page, lastPageChange, needsStaticDraw); // Register HOLD
     _mock_digitalRead_val = HIGH;
-    input.update(state, page, lastPageChange, needsStaticDraw, "v1"); // Release
+    input.update(state, page, lastPageChange, needsStaticDraw); // Release
     _mock_millis += 100;
-    input.update(state, page, lastPageChange, needsStaticDraw, "v1"); // Register Release
+    input.update(state, page, lastPageChange, needsStaticDraw); // Register Release
     TEST_ASSERT_FALSE(input.isScreenOn());
     
     // Test Long Hold (Reset)
@@ -386,17 +1139,17 @@ void test_input_handler_extended() {
     _mock_millis += 100;
     InputHandler input2(9, display);
     input2.begin();
-    input2.update(state, page, lastPageChange, needsStaticDraw, "v1"); // Register HIGH
+    input2.update(state, page, lastPageChange, needsStaticDraw); // Register HIGH
     
     _mock_digitalRead_val = LOW;
-    input2.update(state, page, lastPageChange, needsStaticDraw, "v1"); // Start press
+    input2.update(state, page, lastPageChange, needsStaticDraw); // Start press
     _mock_millis += 100;
-    input2.update(state, page, lastPageChange, needsStaticDraw, "v1"); // Register press
+    input2.update(state, page, lastPageChange, needsStaticDraw); // Register press
     
     bool reset = false;
     for(int i=0; i<30; i++) {
         _mock_millis += 500;
-        if (input2.update(state, page, lastPageChange, needsStaticDraw, "v1")) {
+        if (input2.update(state, page, lastPageChange, needsStaticDraw)) {
             reset = true;
             break;
         }
@@ -404,9 +1157,9 @@ void test_input_handler_extended() {
     TEST_ASSERT_TRUE(reset);
     TEST_ASSERT_TRUE(input2.isResetActive());
     _mock_digitalRead_val = HIGH;
-    input2.update(state, page, lastPageChange, needsStaticDraw, "v1"); // Release
+    input2.update(state, page, lastPageChange, needsStaticDraw); // Release
     _mock_millis += 100;
-    input2.update(state, page, lastPageChange, needsStaticDraw, "v1"); // Register Release
+    input2.update(state, page, lastPageChange, needsStaticDraw); // Register Release
     TEST_ASSERT_FALSE(input2.isResetActive());
 }
 
@@ -421,15 +1174,15 @@ void test_input_click_disconnected(void) {
 
     input.begin();
     _mock_digitalRead_val = LOW;
-    input.update(state, page, lastPageChange, needsStaticDraw, "v1");
+    input.update(state, page, lastPageChange, needsStaticDraw);
     _mock_millis += 60;
-    input.update(state, page, lastPageChange, needsStaticDraw, "v1");
+    input.update(state, page, lastPageChange, needsStaticDraw);
     _mock_digitalRead_val = HIGH;
-    input.update(state, page, lastPageChange, needsStaticDraw, "v1");
+    input.update(state, page, lastPageChange, needsStaticDraw);
     _mock_millis += 60;
-    input.update(state, page, lastPageChange, needsStaticDraw, "v1");
+    input.update(state, page, lastPageChange, needsStaticDraw);
     _mock_millis += 400;
-    input.update(state, page, lastPageChange, needsStaticDraw, "v1");
+    input.update(state, page, lastPageChange, needsStaticDraw);
 
     TEST_ASSERT_TRUE(needsStaticDraw);
     TEST_ASSERT_EQUAL(PAGE_RESOURCES, page);
@@ -445,8 +1198,11 @@ void setup() {
     UNITY_BEGIN();
     RUN_TEST(test_history_push_and_get);
     RUN_TEST(test_history_max);
+    RUN_TEST(test_history_sliding_min_max);
+    RUN_TEST(test_history_pow2_and_spans);
     RUN_TEST(test_display_draw_identity);
     RUN_TEST(test_display_format_speed);
+    RUN_TEST(test_static_string);
     RUN_TEST(test_display_draw_smoke);
     RUN_TEST(test_display_sd_disconnected);
     RUN_TEST(test_display_manager_extended);
@@ -466,14 +1222,1058 @@ void test_display_backlight_pwm() {
     display.setBacklight(state, false);
     TEST_ASSERT_EQUAL(0, _mock_analogWrite_val);
     
-    // Test fade
-    display.fadeBacklight(255, 100);
-    TEST_ASSERT_EQUAL(255, _mock_analogWrite_val);
-    display.fadeBacklight(0, 100);
-    TEST_ASSERT_EQUAL(0, _mock_analogWrite_val);
+    // Test fade is handed to the LEDC hardware and returns immediately
+    unsigned long before = _mock_millis;
+    display.fadeBacklight(0, 500);
+    TEST_ASSERT_EQUAL(before, _mock_millis);
+    TEST_ASSERT_EQUAL(0, _mock_ledcFade_start);
+    TEST_ASSERT_EQUAL(0, _mock_ledcFade_target);
+    TEST_ASSERT_EQUAL(500, _mock_ledcFade_duration);
+
+    display.setBacklight(state, true);
+    display.fadeBacklight(0, 500);
+    TEST_ASSERT_EQUAL(255, _mock_ledcFade_start);
+    _mock_millis += 250;
+    TEST_ASSERT_UINT8_WITHIN(2, 128, display.getBacklightLevel());
+
+    // Reversing mid-fade starts from the current level
+    display.fadeBacklight(255, 500);
+    TEST_ASSERT_UINT8_WITHIN(2, 128, _mock_ledcFade_start);
+    _mock_millis += 500;
+    display.update();
+    TEST_ASSERT_EQUAL(255, display.getBacklightLevel());
+#endif
+}
+
+void test_tween(void) {
+    Tween t;
+    t.start(0, 100, 1000, 0);
+    TEST_ASSERT_TRUE(t.update(0));
+    TEST_ASSERT_EQUAL(50, t.value(500));
+    TEST_ASSERT_EQUAL(100, t.value(2000));
+    TEST_ASSERT_FALSE(t.update(1000));
+    t.set(10);
+    TEST_ASSERT_EQUAL(10, t.value(0));
+    TEST_ASSERT_FALSE(t.isActive());
+}
+
+static int scheduler_hits = 0;
+void scheduler_count(void* ctx) { scheduler_hits++; }
+
+void test_scheduler(void) {
+    Scheduler<2> sched;
+    scheduler_hits = 0;
+    int once = sched.schedule(0, 100, scheduler_count, nullptr);
+    int every = sched.schedule(0, 50, scheduler_count, nullptr, 50);
+    TEST_ASSERT_EQUAL(Scheduler<2>::INVALID_ID, sched.schedule(0, 10, scheduler_count, nullptr));
+
+    sched.update(49);
+    TEST_ASSERT_EQUAL(0, scheduler_hits);
+    sched.update(50);
+    TEST_ASSERT_EQUAL(1, scheduler_hits);
+    sched.update(100);
+    TEST_ASSERT_EQUAL(3, scheduler_hits);
+    TEST_ASSERT_FALSE(sched.isPending(once));
+    TEST_ASSERT_TRUE(sched.isPending(every));
+
+    sched.cancel(every);
+    sched.update(1000);
+    TEST_ASSERT_EQUAL(3, scheduler_hits);
+}
+
+void test_render_scheduler_coalesces(void) {
+    RenderScheduler renderer(50);
+    TEST_ASSERT_EQUAL(RenderScheduler::NONE, renderer.poll(0, true));
+
+    // Static redraws go out immediately
+    renderer.invalidate(RenderScheduler::STATIC);
+    TEST_ASSERT_EQUAL(RenderScheduler::STATIC, renderer.poll(0, true));
+
+    // A burst of value updates inside one frame budget collapses to one render
+    for (int i = 0; i < 10; i++) {
+        renderer.invalidate(RenderScheduler::VALUES);
+        TEST_ASSERT_EQUAL(RenderScheduler::NONE, renderer.poll(10 + i, true));
+    }
+    TEST_ASSERT_EQUAL(RenderScheduler::VALUES, renderer.poll(50, true));
+    TEST_ASSERT_EQUAL(2, renderer.frameCount());
+    TEST_ASSERT_EQUAL(9, renderer.coalescedCount());
+
+    // A page switch doesn't wait for the frame budget
+    renderer.invalidate(RenderScheduler::VALUES);
+    renderer.invalidate(RenderScheduler::STATIC);
+    TEST_ASSERT_EQUAL(RenderScheduler::VALUES | RenderScheduler::STATIC, renderer.poll(51, true));
+}
+
+void test_render_scheduler_screen_off(void) {
+    RenderScheduler renderer(50);
+    renderer.invalidate(RenderScheduler::VALUES);
+    TEST_ASSERT_EQUAL(RenderScheduler::NONE, renderer.poll(100, false));
+    renderer.invalidate(RenderScheduler::BANNER);
+    TEST_ASSERT_EQUAL(RenderScheduler::NONE, renderer.poll(200, false));
+    TEST_ASSERT_EQUAL(0, renderer.frameCount());
+
+    // Waking up issues one full catch-up frame
+    uint8_t frame = renderer.poll(300, true);
+    TEST_ASSERT_TRUE(frame & RenderScheduler::STATIC);
+    TEST_ASSERT_EQUAL(RenderScheduler::NONE, renderer.poll(400, true));
+    TEST_ASSERT_EQUAL(1, renderer.frameCount());
+}
+
+// Stores pixels in one piece
+static bool store_layer(StaticLayerCache& cache, uint32_t key, const uint16_t* pixels, size_t count) {
+    return cache.build(key, [&](StaticLayerCache::RunEncoder& encoder) { encoder.push(pixels, count); });
+}
+
+void test_static_layer_rle(void) {
+    uint16_t pixels[] = {1, 1, 1, 2, 3, 3};
+    uint16_t expected[] = {3, 1, 1, 2, 2, 3};
+    StaticLayerCache::RunEncoder counter;
+    counter.push(pixels, 6);
+    TEST_ASSERT_EQUAL(3, counter.finish());
+
+    // Pairs past the capacity are counted, not written
+    uint16_t runs[6] = {};
+    StaticLayerCache::RunEncoder encoder(runs, 2);
+    encoder.push(pixels, 6);
+    TEST_ASSERT_EQUAL(3, encoder.finish());
+    TEST_ASSERT_EQUAL_MEMORY(expected, runs, 4 * sizeof(uint16_t));
+    TEST_ASSERT_EQUAL(0, runs[4]);
+
+    // Runs longer than a uint16_t count split
+    static uint16_t flat[70000];
+    StaticLayerCache::RunEncoder longRuns;
+    longRuns.push(flat, 70000);
+    TEST_ASSERT_EQUAL(2, longRuns.finish());
+
+    StaticLayerCache cache;
+    TEST_ASSERT_TRUE(store_layer(cache, 42, pixels, 6));
+    StaticLayerCache::Layer layer;
+    TEST_ASSERT_TRUE(cache.find(42, layer));
+    TEST_ASSERT_EQUAL(3, layer.pairs);
+    TEST_ASSERT_EQUAL_MEMORY(expected, layer.runs, sizeof(expected));
+    TEST_ASSERT_FALSE(cache.find(7, layer));
+
+    // Built from pieces, runs carry across the seams
+    TEST_ASSERT_TRUE(cache.build(43, [&](StaticLayerCache::RunEncoder& encoder) {
+        encoder.push(pixels, 2);
+        encoder.push(pixels + 2, 3);
+        encoder.push(pixels + 5, 1);
+    }));
+    TEST_ASSERT_TRUE(cache.find(43, layer));
+    TEST_ASSERT_EQUAL(3, layer.pairs);
+    TEST_ASSERT_EQUAL_MEMORY(expected, layer.runs, sizeof(expected));
+
+    // A renderer that pushes more the second time is refused, not overrun
+    int calls = 0;
+    TEST_ASSERT_FALSE(cache.build(44, [&](StaticLayerCache::RunEncoder& encoder) {
+        encoder.push(pixels, ++calls == 1 ? 3 : 6);
+    }));
+    TEST_ASSERT_FALSE(cache.find(44, layer));
+}
+
+void test_static_layer_cache_eviction(void) {
+    uint16_t pixels[] = {1, 2, 3, 4}; // 4 runs = 16 bytes
+    StaticLayerCache cache(40);
+    TEST_ASSERT_TRUE(store_layer(cache, 1, pixels, 4));
+    TEST_ASSERT_TRUE(store_layer(cache, 2, pixels, 4));
+    StaticLayerCache::Layer layer;
+    TEST_ASSERT_TRUE(cache.find(1, layer)); // 1 is now most recently used
+
+    TEST_ASSERT_TRUE(store_layer(cache, 3, pixels, 4));
+    TEST_ASSERT_TRUE(cache.find(1, layer));
+    TEST_ASSERT_FALSE(cache.find(2, layer));
+    TEST_ASSERT_TRUE(cache.find(3, layer));
+    TEST_ASSERT_EQUAL(32, cache.bytesUsed());
+
+    // Larger than the whole budget
+    uint16_t big[] = {1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11};
+    TEST_ASSERT_FALSE(store_layer(cache, 4, big, 11));
+
+    // Slot count is bounded even when the byte budget isn't reached
+    StaticLayerCache roomy;
+    for (uint32_t key = 0; key < StaticLayerCache::SLOTS + 2; key++) {
+        TEST_ASSERT_TRUE(store_layer(roomy, key, pixels, 1));
+    }
+    TEST_ASSERT_EQUAL(StaticLayerCache::SLOTS, roomy.size());
+
+    cache.clear();
+    TEST_ASSERT_EQUAL(0, cache.size());
+    TEST_ASSERT_EQUAL(0, cache.bytesUsed());
+}
+
+void test_rollup_tiers(void) {
+    RollupSeries series;
+    unsigned long now = 0;
+
+    // Two minutes of 1 Hz samples ramping 0..119
+    for (int i = 0; i < 120; i++) {
+        series.push((float)i, now);
+        now += 1000;
+    }
+
+    TEST_ASSERT_EQUAL(60, series.count(RANGE_MINUTE));
+    Rollup last = series.get(RANGE_MINUTE, 59);
+    TEST_ASSERT_EQUAL_FLOAT(119, last.mean);
+    TEST_ASSERT_EQUAL_FLOAT(60, series.get(RANGE_MINUTE, 0).min);
+
+    // One closed minute plus the one still filling
+    TEST_ASSERT_EQUAL(2, series.count(RANGE_HOUR));
+    Rollup first = series.get(RANGE_HOUR, 0);
+    TEST_ASSERT_EQUAL_FLOAT(0, first.min);
+    TEST_ASSERT_EQUAL_FLOAT(59, first.max);
+    TEST_ASSERT_EQUAL_FLOAT(29.5, first.mean);
+    // The newest second is still open in the finest tier
+    TEST_ASSERT_EQUAL_FLOAT(118, series.peak(RANGE_HOUR));
+
+    TEST_ASSERT_EQUAL(1, series.count(RANGE_DAY));
+    TEST_ASSERT_EQUAL_FLOAT(0, series.get(RANGE_DAY, 0).min);
+}
+
+void test_rollup_jitter_and_gaps(void) {
+    RollupSeries series;
+
+    // Two samples landing in the same second are averaged
+    series.push(10, 0);
+    series.push(20, 995);
+    series.push(30, 1990);
+    series.push(40, 2985);
+    TEST_ASSERT_EQUAL(3, series.count(RANGE_MINUTE));
+    TEST_ASSERT_EQUAL_FLOAT(15, series.get(RANGE_MINUTE, 0).mean);
+    TEST_ASSERT_EQUAL_FLOAT(30, series.get(RANGE_MINUTE, 1).mean);
+
+    // A long gap collapses into a single bucket boundary
+    series.push(50, 600000);
+    TEST_ASSERT_EQUAL(4, series.count(RANGE_MINUTE));
+    TEST_ASSERT_EQUAL_FLOAT(50, series.get(RANGE_MINUTE, 3).mean);
+}
+
+void test_rollup_day_tier(void) {
+    RollupSeries series;
+    unsigned long now = 0;
+
+    // 25 hours at one sample every 10 s fills the day tier and wraps
+    for (unsigned long i = 0; i < 25UL * 360; i++) {
+        series.push((float)(i % 360), now);
+        now += 10000;
+    }
+    TEST_ASSERT_EQUAL(RollupSeries::HALF_HOURS, series.count(RANGE_DAY));
+    Rollup r = series.get(RANGE_DAY, 0);
+    TEST_ASSERT_TRUE(r.min <= r.mean);
+    TEST_ASSERT_TRUE(r.mean <= r.max);
+    TEST_ASSERT_EQUAL_FLOAT(359, series.peak(RANGE_DAY));
+}
+
+void test_rollup_peak_scrolls_out(void) {
+    RollupSeries series;
+    unsigned long now = 0;
+
+    // A falling ramp: each new second is lower, so the peak is always the
+    // oldest slot and has to move as slots are overwritten
+    for (int i = 0; i < 200; i++) {
+        series.push((float)(1000 - i), now);
+        now += 1000;
+    }
+    TEST_ASSERT_EQUAL(60, series.count(RANGE_MINUTE));
+    TEST_ASSERT_EQUAL_FLOAT(series.get(RANGE_MINUTE, 0).max + 1, series.peak(RANGE_MINUTE));
+
+    series.clear();
+    TEST_ASSERT_EQUAL(0, series.count(RANGE_MINUTE));
+    TEST_ASSERT_EQUAL_FLOAT(0, series.peak(RANGE_MINUTE));
+}
+
+void test_display_network_graph_history(void) {
+    DisplayManager display;
+    TelemetryHistory history;
+    SystemState state;
+    state.connected = true;
+    display.begin(state);
+    display.setHistory(&history);
+
+    for (int i = 0; i < 90; i++) {
+        history.net_down.push((float)(i * 1024), i * 1000UL);
+        history.net_up.push((float)(i * 512), i * 1000UL);
+    }
+    for (uint8_t range = 0; range < NUM_RANGES; range++) {
+        state.graph_range = range;
+        display.updateDynamicValues(state, PAGE_NETWORK, true, false, "1.0.0");
+    }
+
+    // Out-of-range settings fall back to the minute view
+    state.graph_range = 7;
+    display.updateDynamicValues(state, PAGE_NETWORK, false, false, "1.0.0");
+}
+
+void test_history_store_round_trip(void) {
+    _mock_lfs_files.clear();
+    TelemetryHistory history;
+    for (unsigned long i = 0; i < 150; i++) {
+        history.net_down.push((float)i, i * 1000);
+        history.thermal_c.push(40.0f + i % 7, i * 1000);
+    }
+
+    HistoryStore store;
+    TEST_ASSERT_FALSE(store.update(history, 0)); // Nothing marked dirty
+    store.markDirty();
+    TEST_ASSERT_TRUE(store.save(history, 1000));
+    TEST_ASSERT_EQUAL(1, store.sequence());
+
+    TelemetryHistory restored;
+    HistoryStore reboot;
+    TEST_ASSERT_TRUE(reboot.restore(restored, 500));
+    TEST_ASSERT_EQUAL(1, reboot.sequence());
+    for (uint8_t r = 0; r < NUM_RANGES; r++) {
+        GraphRange range = (GraphRange)r;
+        TEST_ASSERT_EQUAL(history.net_down.count(range), restored.net_down.count(range));
+        for (size_t i = 0; i < history.net_down.count(range); i++) {
+            TEST_ASSERT_EQUAL_FLOAT(history.net_down.get(range, i).mean, restored.net_down.get(range, i).mean);
+            TEST_ASSERT_EQUAL_FLOAT(history.thermal_c.get(range, i).max, restored.thermal_c.get(range, i).max);
+        }
+    }
+    TEST_ASSERT_EQUAL(0, restored.cpu_percent.count(RANGE_MINUTE));
+
+    // The restored series keeps rolling up from where it left off
+    restored.net_down.push(1000, 1500);
+    TEST_ASSERT_EQUAL_FLOAT(1000, restored.net_down.get(RANGE_MINUTE, 59).mean);
+}
+
+void test_history_store_rotation_and_corruption(void) {
+    _mock_lfs_files.clear();
+    TelemetryHistory history;
+    HistoryStore store(1000);
+
+    for (int n = 1; n <= 4; n++) {
+        history.cpu_percent.push((float)n, n * 1000UL);
+        store.markDirty();
+        TEST_ASSERT_TRUE(store.update(history, n * 1000UL));
+        TEST_ASSERT_FALSE(store.update(history, n * 1000UL + 10)); // Throttled
+    }
+    TEST_ASSERT_EQUAL(HistoryStore::SLOTS, _mock_lfs_files.size());
+
+    // Corrupt the newest snapshot (#4 lives in slot 1): restore falls back to #3
+    char path[20];
+    HistoryStore::slotPath(4 % HistoryStore::SLOTS, path, sizeof(path));
+    _mock_lfs_files[path][20] ^= 0x5A;
+
+    TelemetryHistory restored;
+    HistoryStore reboot;
+    TEST_ASSERT_TRUE(reboot.restore(restored, 0));
+    TEST_ASSERT_EQUAL(3, reboot.sequence());
+    TEST_ASSERT_EQUAL(3, restored.cpu_percent.count(RANGE_MINUTE));
+
+    // The next save overwrites the oldest slot, not the one just restored
+    reboot.markDirty();
+    TEST_ASSERT_TRUE(reboot.flush(restored, 10));
+    TEST_ASSERT_EQUAL(4, reboot.sequence());
+
+    // Truncated or foreign files are ignored
+    _mock_lfs_files.clear();
+    _mock_lfs_files["/history0.bin"] = "SIHS";
+    TelemetryHistory empty;
+    TEST_ASSERT_FALSE(reboot.restore(empty, 0));
+    TEST_ASSERT_EQUAL(0, empty.cpu_percent.count(RANGE_MINUTE));
+}
+
+struct CapturePrint : public Print {
+    std::string text;
+    size_t write(uint8_t c) override {
+        text += (char)c;
+        return 1;
+    }
+};
+
+void test_latency_histogram(void) {
+    TEST_ASSERT_EQUAL(0, LatencyHistogram::bucketOf(0));
+    TEST_ASSERT_EQUAL(1, LatencyHistogram::bucketOf(1));
+    TEST_ASSERT_EQUAL(2, LatencyHistogram::bucketOf(3));
+    TEST_ASSERT_EQUAL(11, LatencyHistogram::bucketOf(1024));
+    TEST_ASSERT_EQUAL(32, LatencyHistogram::bucketOf(0xFFFFFFFF));
+
+    // 990 fast passes and 10 slow ones: p50 is fast, p99 still fast, max slow
+    LatencyHistogram h;
+    TEST_ASSERT_EQUAL(0, h.percentile(99));
+    for (int i = 0; i < 990; i++) h.record(100);
+    for (int i = 0; i < 10; i++) h.record(50000);
+    TEST_ASSERT_EQUAL(1000, h.count());
+    TEST_ASSERT_EQUAL(127, h.percentile(50));
+    TEST_ASSERT_EQUAL(127, h.percentile(99));
+    TEST_ASSERT_EQUAL(50000, h.percentile(100));
+    TEST_ASSERT_EQUAL(50000, h.max());
+    h.record(60000);
+    TEST_ASSERT_EQUAL(60000, h.percentile(100)); // Capped at the max, not 65535
+
+    // A stage timer records the cycles spent in its scope
+    LoopMetrics metrics(160);
+    ESP._cycleStep = 1600;
+    {
+        StageTimer timer(metrics, STAGE_SERIAL);
+    }
+    ESP._cycleStep = 0;
+    TEST_ASSERT_EQUAL(1, metrics.stage(STAGE_SERIAL).count());
+    TEST_ASSERT_EQUAL(1600, metrics.stage(STAGE_SERIAL).max());
+
+    CapturePrint out;
+    metrics.write(out);
+    TEST_ASSERT_NOT_NULL(strstr(out.text.c_str(), "\"serial\":{\"count\":1,\"p50_us\":10,\"p99_us\":10,\"max_us\":10,"
+                                                  "\"buckets\":[0,0,0,0,0,0,0,0,0,0,0,1]}"));
+    TEST_ASSERT_NOT_NULL(strstr(out.text.c_str(), "\"input\":{\"count\":0,\"p50_us\":0,\"p99_us\":0,\"max_us\":0,\"buckets\":[]}"));
+    TEST_ASSERT_EQUAL('\n', out.text[out.text.size() - 1]);
+}
+
+void test_trace_ring(void) {
+    TraceRing<4> ring;
+    TEST_ASSERT_EQUAL(0, ring.size());
+    ring.record(TRACE_HANDLE_JSON, TRACE_KIND_BEGIN, 120, 1000);
+    ring.record(TRACE_HANDLE_JSON, TRACE_KIND_END, 120, 1250);
+    TEST_ASSERT_EQUAL(2, ring.size());
+    TEST_ASSERT_EQUAL(1250, ring.at(1).timestamp);
+
+    // Wrapping keeps the newest events, oldest first
+    for (uint32_t i = 0; i < 4; i++) ring.record(TRACE_PUBLISH, TRACE_KIND_INSTANT, i, 2000 + i);
+    TEST_ASSERT_EQUAL(4, ring.size());
+    TEST_ASSERT_EQUAL(6, ring.recorded());
+    TEST_ASSERT_EQUAL(0, ring.at(0).arg);
+    TEST_ASSERT_EQUAL(3, ring.at(3).arg);
+
+    CapturePrint out;
+    ring.dump(out);
+    TEST_ASSERT_NOT_NULL(strstr(out.text.c_str(), "{\"type\":\"TraceInfo\",\"data\":{\"events\":4,\"recorded\":6,"
+                                                  "\"names\":[\"handle_json\","));
+    TEST_ASSERT_NOT_NULL(strstr(out.text.c_str(), "{\"type\":\"Trace\",\"data\":[[2000,8,\"i\",0],[2001,8,\"i\",1],"
+                                                  "[2002,8,\"i\",2],[2003,8,\"i\",3]]}\n{\"type\":\"TraceEnd\"}\n"));
+
+#ifdef SIDEEYE_TRACE
+    // Scopes and the network phase changes land in the shared buffer
+    traceBuffer().clear();
+    _mock_millis = 7;
+    {
+        TraceScope scope(TRACE_DRAW_STATIC, 2);
+    }
+    TEST_ASSERT_EQUAL(2, traceBuffer().size());
+    TEST_ASSERT_EQUAL(TRACE_KIND_BEGIN, traceBuffer().at(0).kind);
+    TEST_ASSERT_EQUAL(TRACE_KIND_END, traceBuffer().at(1).kind);
+    TEST_ASSERT_EQUAL(7000, traceBuffer().at(1).timestamp);
+
+    SideEyeNetworkManager nm;
+    SystemState state;
+    nm.begin("DEV1", "1.0.0", state, dummy_callback, dummy_config_callback, dummy_callback);
+    const TraceEvent& joined = traceBuffer().at(traceBuffer().size() - 1);
+    TEST_ASSERT_EQUAL(TRACE_WIFI_PHASE, joined.id);
+    TEST_ASSERT_EQUAL(WIFI_JOINING, joined.arg);
+    traceBuffer().clear();
+#endif
+}
+
+void test_app_serial_loop(void) {
+    MockClock clock;
+    DisplayManager display;
+    SideEyeNetworkManager network;
+    SideEyeApp app(clock, Serial, display, network, "1.0.0");
+    app.begin("DEV1", dummy_callback, dummy_config_callback, dummy_callback);
+    TEST_ASSERT_TRUE(app.bootProfile().finished(BOOT_FIRST_FRAME));
+
+    Serial._capture = true;
+    Serial._output.clear();
+    Serial._feed("{\"type\":\"Identity\",\"data\":{\"hostname\":\"alpha\",\"ip\":\"10.0.0.5\"}}\n"
+                 "{\"type\":\"Stats\",\"data\":{\"cpu_percent\":42,\"alert_level\":1}}\r\n"
+                 "not json\n" + std::string(600, 'x') + "\n"
+                 "{\"type\":\"GetVersion\"}\n{\"type\":\"Sta");
+    app.loop();
+
+    TEST_ASSERT_EQUAL_STRING("alpha", app.state().hostname.c_str());
+    TEST_ASSERT_EQUAL_FLOAT(42, app.state().cpu_percent);
+    TEST_ASSERT_TRUE(app.state().connected);
+    TEST_ASSERT_EQUAL(PAGE_RESOURCES, app.currentPage()); // Raised alert jumps to resources
+    TEST_ASSERT_EQUAL(3, app.counters().frames);
+    TEST_ASSERT_EQUAL(1, app.counters().rejected);
+    TEST_ASSERT_EQUAL(1, app.counters().overflows);
+    TEST_ASSERT_NOT_NULL(strstr(Serial._output.c_str(), "{\"type\":\"Version\",\"version\":\"1.0.0\"}"));
+
+    // The partial line completes on a later pass, once "WiFi Online" is gone
+    Serial._feed("ts\",\"data\":{\"cpu_percent\":7}}\n");
+    clock.advance(2000);
+    app.loop();
+    TEST_ASSERT_EQUAL(4, app.counters().frames);
+    TEST_ASSERT_EQUAL_FLOAT(7, app.state().cpu_percent);
+    TEST_ASSERT_GREATER_THAN(0, (int)app.counters().staticRenders);
+
+    Serial._output.clear();
+    Serial._feed("{\"type\":\"DumpTrace\"}\n");
+    app.loop();
+#ifdef SIDEEYE_TRACE
+    TEST_ASSERT_NOT_NULL(strstr(Serial._output.c_str(), "{\"type\":\"TraceEnd\"}"));
+#else
+    TEST_ASSERT_NOT_NULL(strstr(Serial._output.c_str(), "{\"type\":\"Error\",\"data\":\"trace disabled\"}"));
 #endif
+
+    Serial._output.clear();
+    Serial._feed("{\"type\":\"GetMetrics\"}\n");
+    app.loop();
+#ifdef SIDEEYE_LOOP_METRICS
+    TEST_ASSERT_NOT_NULL(strstr(Serial._output.c_str(), "{\"type\":\"Metrics\""));
+#else
+    TEST_ASSERT_NOT_NULL(strstr(Serial._output.c_str(), "{\"type\":\"Error\",\"data\":\"loop metrics disabled\"}"));
+#endif
+    Serial._capture = false;
+
+    // Pages cycle on the virtual clock, and silence marks the host gone
+    clock.advance(app.state().cycle_duration + 1);
+    app.loop();
+    TEST_ASSERT_EQUAL(PAGE_STATUS, app.currentPage());
+    clock.advance(SideEyeApp::CONNECTION_TIMEOUT + 1);
+    app.loop();
+    TEST_ASSERT_FALSE(app.state().connected);
+}
+
+void test_app_ble_transport(void) {
+    MockClock clock;
+    DisplayManager display;
+    SideEyeNetworkManager network;
+    SideEyeApp app(clock, Serial, display, network, "1.0.0");
+    app.begin("DEV1", dummy_callback, dummy_config_callback, dummy_callback);
+    app.loop(); // Brings up BLE
+
+    BLEServer* server = BLEDevice::createServer();
+    BLEService& service = server->_services[BLE_TELEMETRY_SERVICE_UUID];
+    BLECharacteristic& rx = service._characteristics[BLE_TELEMETRY_RX_UUID];
+    BLECharacteristic& tx = service._characteristics[BLE_TELEMETRY_TX_UUID];
+    TEST_ASSERT_TRUE(rx._properties & BLECharacteristic::PROPERTY_WRITE_NR);
+    TEST_ASSERT_EQUAL(BLETelemetry::LOCAL_MTU, BLEDevice::_localMtu());
+    tx._notifications.clear();
+
+    server->_connect(64);
+    TEST_ASSERT_TRUE(app.bleTelemetry().isConnected());
+    TEST_ASSERT_EQUAL(64, app.bleTelemetry().mtu());
+    TEST_ASSERT_EQUAL(6, server->_minInterval);
+
+    // Two frames in one write, the second finishing in the next one
+    rx._write("{\"type\":\"Identity\",\"data\":{\"hostname\":\"laptop\"}}\n{\"type\":\"Stats\",\"data\":"
+              "{\"cpu_percent\":33}}\n{\"type\":\"GetVer");
+    rx._write("sion\"}\n");
+    app.loop();
+    TEST_ASSERT_EQUAL_STRING("laptop", app.state().hostname.c_str());
+    TEST_ASSERT_EQUAL_FLOAT(33, app.state().cpu_percent);
+    TEST_ASSERT_TRUE(app.state().connected);
+
+    // The reply and the ack come back in notifications of at most MTU - 3 bytes
+    std::string received;
+    for (size_t i = 0; i < tx._notifications.size(); i++) {
+        TEST_ASSERT_TRUE(tx._notifications[i].size() <= 61);
+        received += tx._notifications[i];
+    }
+    TEST_ASSERT_EQUAL_STRING("{\"type\":\"Version\",\"version\":\"1.0.0\"}\r\n"
+                             "{\"type\":\"Ack\",\"data\":{\"frames\":3,\"free\":2048,\"dropped\":0}}\n",
+                             received.c_str());
+
+    // A write that doesn't fit the ring is dropped whole and reported
+    rx._write(std::string(1500, ' '));
+    rx._write(std::string(600, ' '));
+    rx._write("\n");
+    app.loop();
+    TEST_ASSERT_TRUE(tx._notifications.back().find("\"dropped\":1") != std::string::npos);
+
+    // A frame cut off by a disconnect doesn't merge with the next one
+    tx._notifications.clear();
+    int adverts = server->_advertisingStarts;
+    rx._write("{\"type\":\"Sta");
+    server->_disconnect();
+    TEST_ASSERT_EQUAL(adverts + 1, server->_advertisingStarts);
+    server->_connect(23);
+    rx._write("{\"type\":\"Stats\",\"data\":{\"cpu_percent\":9}}\n");
+    uint32_t rejected = app.counters().rejected;
+    app.loop();
+    TEST_ASSERT_EQUAL(rejected + 1, app.counters().rejected);
+    TEST_ASSERT_EQUAL_FLOAT(9, app.state().cpu_percent);
+    server->_disconnect();
+    server->_callbacks = nullptr;
 }
 
+void test_spsc_ring(void) {
+    SpscRing<uint16_t, 4> ring;
+    uint16_t value = 0;
+    TEST_ASSERT_FALSE(ring.pop(value));
+    for (uint16_t i = 0; i < 4; i++) TEST_ASSERT_TRUE(ring.push(i));
+    TEST_ASSERT_FALSE(ring.push(99)); // Every slot is usable, no more
+    TEST_ASSERT_EQUAL(4, ring.size());
+
+    // Bulk pushes are all or nothing, and wrap
+    TEST_ASSERT_TRUE(ring.pop(value));
+    TEST_ASSERT_TRUE(ring.pop(value));
+    TEST_ASSERT_EQUAL(1, value);
+    const uint16_t three[3] = {10, 11, 12};
+    TEST_ASSERT_FALSE(ring.push(three, 3));
+    TEST_ASSERT_EQUAL(2, ring.space());
+    TEST_ASSERT_TRUE(ring.push(three, 2));
+    const uint16_t expected[4] = {2, 3, 10, 11};
+    for (int i = 0; i < 4; i++) {
+        TEST_ASSERT_TRUE(ring.peek(value));
+        TEST_ASSERT_TRUE(ring.pop(value));
+        TEST_ASSERT_EQUAL(expected[i], value);
+    }
+    TEST_ASSERT_TRUE(ring.empty());
+}
+
+// One producer and one consumer thread: every item arrives once, in order
+// and untorn, whatever the interleaving
+void test_spsc_ring_threads(void) {
+    struct Item {
+        uint32_t sequence;
+        uint32_t check;
+    };
+    static SpscRing<Item, 64> ring;
+    const uint32_t count = 1000000;
+
+    std::thread producer([&]() {
+        Item batch[3];
+        for (uint32_t i = 0; i < count;) {
+            // Mix single and bulk pushes
+            uint32_t n = (i % 7 == 0 && count - i >= 3) ? 3 : 1;
+            for (uint32_t b = 0; b < n; b++) batch[b] = {i + b, (i + b) * 2654435761u};
+            while (!ring.push(batch, n)) std::this_thread::yield();
+            i += n;
+        }
+    });
+
+    uint32_t received = 0, outOfOrder = 0, torn = 0;
+    Item item;
+    while (received < count) {
+        if (!ring.pop(item)) {
+            std::this_thread::yield();
+            continue;
+        }
+        if (item.sequence != received) outOfOrder++;
+        if (item.check != item.sequence * 2654435761u) torn++;
+        received++;
+    }
+    producer.join();
+    TEST_ASSERT_EQUAL(0, outOfOrder);
+    TEST_ASSERT_EQUAL(0, torn);
+    TEST_ASSERT_TRUE(ring.empty());
+}
+
+void test_app_mqtt_settings_deferred(void) {
+    MockClock clock;
+    DisplayManager display;
+    SideEyeNetworkManager network;
+    SideEyeApp app(clock, Serial, display, network, "1.0.0");
+    app.begin("DEV1", dummy_callback, dummy_config_callback, dummy_callback);
+    Serial._capture = true;
+
+    // The callback only queues; the loop applies the batch
+    char cycleTopic[] = "side-eye/DEV1/set/cycle_duration";
+    char value[] = "7000junk";
+    char rotation[] = "side-eye/DEV1/set/rotation";
+    char bad[] = "2";
+    char unknown[] = "side-eye/DEV1/set/volume";
+    app.onMqttMessage(cycleTopic, (uint8_t*)value, 4); // Payloads aren't NUL-terminated
+    app.onMqttMessage(rotation, (uint8_t*)bad, 1);
+    app.onMqttMessage(unknown, (uint8_t*)bad, 1);
+    TEST_ASSERT_EQUAL(5000, app.state().cycle_duration);
+
+    app.loop();
+    TEST_ASSERT_EQUAL(7000, app.state().cycle_duration);
+    TEST_ASSERT_NOT_EQUAL(2, app.state().rotation); // Out of range, ignored
+
+    // Saved once the debounce has passed
+    _mock_lfs_files.clear();
+    clock.advance(2001);
+    app.loop();
+    ConfigData saved;
+    TEST_ASSERT_TRUE(ConfigStore().load(saved));
+    TEST_ASSERT_EQUAL(7000, saved.cycle_duration);
+    Serial._capture = false;
+    Serial._output.clear();
+}
+
+void test_presence_tracker(void) {
+    const uint8_t phone[6] = {0xAA, 0xBB, 0xCC, 0xDD, 0xEE, 0x01};
+    const uint8_t stranger[6] = {0xAA, 0xBB, 0xCC, 0xDD, 0xEE, 0x02};
+    // Core spec Vol 3 Part H D.7: ah(IRK, 0x708194) = 0x0dfbaa
+    const uint8_t irk[16] = {0xec, 0x02, 0x34, 0xa3, 0x57, 0xc8, 0xad, 0x05,
+                             0x34, 0x10, 0x10, 0xa6, 0x0a, 0x39, 0x7d, 0x9b};
+    const uint8_t rpa[6] = {0x70, 0x81, 0x94, 0x0d, 0xfb, 0xaa};
+    const uint8_t otherRpa[6] = {0x70, 0x81, 0x94, 0x0d, 0xfb, 0xab};
+    TEST_ASSERT_TRUE(PresenceTracker::resolves(irk, rpa));
+    TEST_ASSERT_FALSE(PresenceTracker::resolves(irk, otherRpa));
+    TEST_ASSERT_FALSE(PresenceTracker::resolves(irk, phone)); // Not a resolvable private address
+
+    PresenceTracker tracker;
+    TEST_ASSERT_FALSE(tracker.hasTargets());
+    tracker.addMac(phone);
+    tracker.addIrk(irk);
+    TEST_ASSERT_TRUE(tracker.matches(phone));
+    TEST_ASSERT_TRUE(tracker.matches(rpa));
+    TEST_ASSERT_FALSE(tracker.observe(stranger, -40, 0));
+    TEST_ASSERT_EQUAL(-127, tracker.smoothedRssi());
+
+    // Hysteresis on the smoothed RSSI: enter at -75, leave below -85
+    TEST_ASSERT_TRUE(tracker.observe(phone, -80, 0));
+    TEST_ASSERT_FALSE(tracker.present());
+    tracker.observe(rpa, -60, 0);
+    TEST_ASSERT_EQUAL(-75, tracker.smoothedRssi());
+    TEST_ASSERT_TRUE(tracker.present());
+    tracker.observe(phone, -100, 0);
+    tracker.observe(phone, -100, 0);
+    TEST_ASSERT_TRUE(tracker.present()); // -85 is still inside the band
+    tracker.observe(phone, -100, 0);
+    TEST_ASSERT_FALSE(tracker.present());
+
+    // Duty cycle: 1 s windows every 4 s, backing off while presence holds
+    tracker.reset();
+    TEST_ASSERT_TRUE(tracker.update(0));
+    tracker.observe(phone, -60, 100);
+    TEST_ASSERT_TRUE(tracker.update(999));
+    TEST_ASSERT_FALSE(tracker.update(1000));
+    TEST_ASSERT_EQUAL(8000, tracker.period());
+    TEST_ASSERT_FALSE(tracker.update(7999));
+    TEST_ASSERT_TRUE(tracker.update(8000));
+    tracker.observe(phone, -60, 8100);
+    TEST_ASSERT_FALSE(tracker.update(9000));
+    TEST_ASSERT_EQUAL(16000, tracker.period());
+    TEST_ASSERT_TRUE(tracker.update(25000));
+    TEST_ASSERT_FALSE(tracker.update(26000));
+    TEST_ASSERT_EQUAL(16000, tracker.period()); // Capped, and an empty window doesn't extend it
+
+    // Two missed periods drop presence and return to the search period
+    TEST_ASSERT_TRUE(tracker.update(41100));
+    TEST_ASSERT_TRUE(tracker.present());
+    TEST_ASSERT_TRUE(tracker.update(41101));
+    TEST_ASSERT_FALSE(tracker.present());
+    TEST_ASSERT_EQUAL(4000, tracker.period());
+}
+
+void test_ble_presence_targets(void) {
+    _mock_lfs_files.clear();
+    BLEScan* scan = BLEDevice::getScan();
+    BLEPresenceManager ble;
+    ble.begin("DEV1");
+    TEST_ASSERT_FALSE(ble.isEnabled()); // Nothing to look for yet
+    TEST_ASSERT_FALSE(scan->_active);
+    TEST_ASSERT_EQUAL(BLEPresenceManager::SCAN_INTERVAL_MS, scan->_interval);
+    TEST_ASSERT_EQUAL(BLEPresenceManager::SCAN_WINDOW_MS, scan->_window);
+
+    JsonDocument bad;
+    deserializeJson(bad, "{\"macs\":[\"AA:BB:CC\"]}");
+    TEST_ASSERT_FALSE(ble.configure(bad.as<JsonObject>()));
+    TEST_ASSERT_FALSE(ble.isEnabled());
+
+    // Out-of-range settings are rejected rather than narrowed into range
+    const char* const outOfRange[] = {
+        "{\"enter_rssi\":200}", "{\"exit_rssi\":-300}", "{\"enter_rssi\":-90,\"exit_rssi\":-90}",
+        "{\"window_ms\":70000}", "{\"window_ms\":5000,\"period_ms\":4000}", "{\"period_ms\":0}",
+        "{\"period_ms\":-1}"
+    };
+    for (size_t i = 0; i < sizeof(outOfRange) / sizeof(outOfRange[0]); i++) {
+        JsonDocument settings;
+        deserializeJson(settings, outOfRange[i]);
+        TEST_ASSERT_FALSE_MESSAGE(ble.configure(settings.as<JsonObject>()), outOfRange[i]);
+    }
+    TEST_ASSERT_EQUAL(-75, ble.tracker().settings().enterRssi);
+
+    JsonDocument doc;
+    deserializeJson(doc, "{\"macs\":[\"AA:BB:CC:DD:EE:01\"],\"irks\":[\"ec0234a357c8ad05341010a60a397d9b\"],"
+                         "\"enter_rssi\":-70,\"period_ms\":5000}");
+    TEST_ASSERT_TRUE(ble.configure(doc.as<JsonObject>()));
+    TEST_ASSERT_TRUE(ble.isEnabled());
+    TEST_ASSERT_TRUE(scan->_scanning);
+    TEST_ASSERT_EQUAL(-70, ble.tracker().settings().enterRssi);
+    const std::string& saved = _mock_lfs_files["/presence.json"];
+    TEST_ASSERT_TRUE(saved.find("mac_hashes") != std::string::npos);
+    TEST_ASSERT_TRUE(saved.find("AA:BB") == std::string::npos); // Only the hash is kept
+
+    SideEyeNetworkManager network;
+    SystemState state;
+    const uint8_t phone[6] = {0xAA, 0xBB, 0xCC, 0xDD, 0xEE, 0x01};
+    scan->_callbacks->onResult(BLEAdvertisedDevice(phone, -60));
+    ble.update(network, state);
+    TEST_ASSERT_TRUE(ble.isPresent());
+    TEST_ASSERT_EQUAL_STRING("Present", ble.getStatusString());
+
+    // Window closes: the radio stops until the next one
+    _mock_millis += 1000;
+    ble.update(network, state);
+    TEST_ASSERT_FALSE(scan->_scanning);
+
+    // Targets survive a restart
+    BLEPresenceManager restarted;
+    restarted.begin("DEV1");
+    TEST_ASSERT_TRUE(restarted.isEnabled());
+    TEST_ASSERT_EQUAL(1, restarted.tracker().macCount());
+    TEST_ASSERT_EQUAL(1, restarted.tracker().irkCount());
+    TEST_ASSERT_EQUAL(5000, restarted.tracker().settings().searchPeriodMs);
+    TEST_ASSERT_TRUE(restarted.tracker().matches(phone));
+    restarted.setEnabled(false);
+    scan->_callbacks = nullptr;
+}
+
+static void stats_columns(int32_t cpu, int32_t netDown, int32_t out[StatsLog::COLUMNS]) {
+    StatsLog::toColumns(cpu, 4, 16, 10, 55.5f, 100, netDown, out);
+}
+
+// Runs a query to the end, as the app's loop would over several passes
+static void stats_query(StatsLog& log, uint32_t from, uint32_t to, uint16_t points, CapturePrint& out) {
+    log.beginQuery(from, to, points, out);
+    while (log.stepQuery()) {}
+}
+
+void test_stats_log_append_and_query(void) {
+    _mock_sd_files.clear();
+    StatsLog log;
+    TEST_ASSERT_TRUE(log.begin());
+
+    // 150 samples at 1 Hz: two full blocks on the card, 30 still in RAM
+    const uint32_t t0 = 1700000000;
+    int32_t columns[StatsLog::COLUMNS];
+    for (uint32_t i = 0; i < 150; i++) {
+        stats_columns(i % 2 ? 20 : 40, 3000000000UL, columns); // net clamps to int32
+        log.append(t0 + i, columns);
+    }
+    TEST_ASSERT_EQUAL(30, log.pendingSamples());
+
+    char path[32];
+    StatsLog::segmentPath(0, path, sizeof(path));
+    TEST_ASSERT_EQUAL(sizeof(StatsLog::SegmentHeader) + 2 * StatsLog::blockBytes(), _mock_sd_files[path].size());
+
+    // One bucket per minute: the first two come from block header sums
+    CapturePrint out;
+    stats_query(log, t0, t0 + 179, 3, out);
+    TEST_ASSERT_TRUE(out.text.find("\"step\":60") != std::string::npos);
+    TEST_ASSERT_TRUE(out.text.find("{\"type\":\"HistoryPoints\",\"data\":[[1700000000,30.0,25.0,10.0,55.5,100,2147483647]") !=
+                     std::string::npos);
+    TEST_ASSERT_TRUE(out.text.find(",[1700000060,30.0,") != std::string::npos);
+    TEST_ASSERT_TRUE(out.text.find(",[1700000120,30.0,") != std::string::npos);
+    TEST_ASSERT_TRUE(out.text.find("]}\n{\"type\":\"HistoryEnd\",\"data\":{\"complete\":true}}\n") != std::string::npos);
+
+    // A range inside one block decodes individual samples
+    CapturePrint narrow;
+    stats_query(log, t0 + 10, t0 + 11, 2, narrow);
+    TEST_ASSERT_TRUE(narrow.text.find("[1700000010,40.0,") != std::string::npos);
+    TEST_ASSERT_TRUE(narrow.text.find(",[1700000011,20.0,") != std::string::npos);
+
+    // Nothing in range
+    CapturePrint empty;
+    stats_query(log, t0 - 100, t0 - 1, 10, empty);
+    TEST_ASSERT_TRUE(empty.text.find("HistoryPoints") == std::string::npos);
+    TEST_ASSERT_TRUE(empty.text.find("\"complete\":true") != std::string::npos);
+}
+
+void test_stats_log_rotation(void) {
+    _mock_sd_files.clear();
+    StatsLog log(2, 3); // 2 blocks per segment, keep 3 segments
+    TEST_ASSERT_TRUE(log.begin());
+
+    int32_t columns[StatsLog::COLUMNS];
+    stats_columns(50, 1000, columns);
+    uint32_t t = 1700000000;
+    for (int block = 0; block < 10; block++) {
+        for (int i = 0; i < StatsLog::BLOCK_SAMPLES; i++) log.append(t++, columns);
+    }
+    // A gap beyond the 16-bit time offset seals the block early
+    log.append(t, columns);
+    log.append(t + 70000, columns);
+    TEST_ASSERT_TRUE(log.flush());
+
+    TEST_ASSERT_EQUAL(3, log.firstSegment());
+    TEST_ASSERT_EQUAL(5, log.lastSegment());
+    char path[32];
+    StatsLog::segmentPath(2, path, sizeof(path));
+    TEST_ASSERT_FALSE(SD.exists(path));
+
+    // The index survives a reboot and appends continue in the last segment
+    StatsLog reboot(2, 3);
+    TEST_ASSERT_TRUE(reboot.begin());
+    TEST_ASSERT_EQUAL(3, reboot.firstSegment());
+    TEST_ASSERT_EQUAL(5, reboot.lastSegment());
+
+    CapturePrint out;
+    stats_query(reboot, t + 70000, t + 70000, 1, out);
+    TEST_ASSERT_TRUE(out.text.find("[1700070600,50.0,25.0,10.0,55.5,100,1000]") != std::string::npos);
+}
+
+void test_stats_log_bounded_query(void) {
+    _mock_sd_files.clear();
+    StatsLog log(200, 3);
+    TEST_ASSERT_TRUE(log.begin());
+
+    // 200 blocks in one segment
+    const uint32_t t0 = 1700000000;
+    int32_t columns[StatsLog::COLUMNS];
+    stats_columns(30, 1000, columns);
+    for (uint32_t i = 0; i < 200UL * StatsLog::BLOCK_SAMPLES; i++) log.append(t0 + i, columns);
+
+    // A minute in the middle is found by binary search, not a scan
+    CapturePrint narrow;
+    _mock_file_reads = 0;
+    stats_query(log, t0 + 150 * 60, t0 + 150 * 60 + 59, 1, narrow);
+    TEST_ASSERT_TRUE(narrow.text.find("[1700009000,30.0,") != std::string::npos);
+    TEST_ASSERT_LESS_THAN(16, (int)_mock_file_reads);
+
+    // The whole range takes many passes, each reading a bounded number of
+    // blocks and ending on a whole line
+    CapturePrint out;
+    log.beginQuery(t0, t0 + 200 * 60, 200, out);
+    int passes = 0;
+    bool more = true;
+    while (more) {
+        _mock_file_reads = 0;
+        more = log.stepQuery(4);
+        passes++;
+        // One over at most, plus the binary search when a segment opens
+        TEST_ASSERT_LESS_OR_EQUAL(4 + 1 + 9, (int)_mock_file_reads);
+        TEST_ASSERT_EQUAL('\n', out.text[out.text.size() - 1]);
+    }
+    TEST_ASSERT_GREATER_THAN(40, passes);
+    TEST_ASSERT_FALSE(log.queryActive());
+    size_t points = 0;
+    for (size_t at = out.text.find("[17"); at != std::string::npos; at = out.text.find("[17", at + 1)) points++;
+    TEST_ASSERT_EQUAL(12000 / 61 + 1, points); // Every bucket of the 61 s step
+    TEST_ASSERT_TRUE(out.text.find("\"complete\":true") != std::string::npos);
+
+    // A new query cuts a running one short
+    CapturePrint first, second;
+    log.beginQuery(t0, t0 + 200 * 60, 200, first);
+    TEST_ASSERT_TRUE(log.stepQuery(4));
+    log.beginQuery(t0, t0 + 59, 1, second);
+    TEST_ASSERT_TRUE(first.text.find("\"complete\":false") != std::string::npos);
+    while (log.stepQuery()) {}
+    TEST_ASSERT_TRUE(second.text.find("\"complete\":true") != std::string::npos);
+}
+
+void test_display_static_layer_cached(void) {
+    DisplayManager display;
+    SystemState state;
+    state.connected = true;
+    display.begin(state);
+
+    display.drawStaticUI(state, PAGE_RESOURCES, "1.0.0");
+    TEST_ASSERT_EQUAL(1, display.staticLayerCount());
+    display.drawStaticUI(state, PAGE_RESOURCES, "1.0.0");
+    TEST_ASSERT_EQUAL(1, display.staticLayerCount());
+    display.drawStaticUI(state, PAGE_NETWORK, "1.0.0");
+    TEST_ASSERT_EQUAL(2, display.staticLayerCount());
+
+    // A flashing banner is drawn live, the rest of the page is still cached
+    state.alert_level = 2;
+    display.drawStaticUI(state, PAGE_RESOURCES, "1.0.0");
+    TEST_ASSERT_EQUAL(3, display.staticLayerCount());
+
+    display.invalidateStaticLayers();
+    TEST_ASSERT_EQUAL(0, display.staticLayerCount());
+}
+
+void test_display_notification_non_blocking(void) {
+    DisplayManager display;
+    SystemState state;
+    display.begin(state);
+
+    unsigned long before = _mock_millis;
+    display.showNotification("Settings Updated");
+    TEST_ASSERT_EQUAL(before, _mock_millis);
+    TEST_ASSERT_TRUE(display.isNotificationActive());
+    TEST_ASSERT_FALSE(display.update());
+
+    _mock_millis += 1000;
+    display.showNotification("Again"); // Re-arms the overlay
+    _mock_millis += 1000;
+    TEST_ASSERT_FALSE(display.update());
+    TEST_ASSERT_TRUE(display.isNotificationActive());
+
+    _mock_millis += 500;
+    TEST_ASSERT_TRUE(display.update());
+    TEST_ASSERT_FALSE(display.isNotificationActive());
+    TEST_ASSERT_FALSE(display.update());
+}
+
+#ifdef NATIVE
+static SystemState golden_state() {
+    SystemState state;
+    state.connected = true;
+    state.hostname = "golden-host";
+    state.ip = "10.0.0.42";
+    state.mac = "AA:BB:CC:DD:EE:FF";
+    state.cpu_percent = 42.5;
+    state.ram_used_mb = 4096;
+    state.ram_total_mb = 16384;
+    return state;
+}
+
+// Checksums of the panel framebuffer after a full redraw of each page. When a
+// layout change is intentional, run with SIDEEYE_GOLDEN_DIR set to dump the
+// frames as PPM, eyeball them, then update the table.
+void test_display_golden_pages(void) {
+    static const struct { uint8_t rotation; uint32_t sums[NUM_PAGES]; } golden[] = {
+        { 1, { 0x40151C29, 0xE7D2B0C9, 0xFEE11969, 0x9C298D91, 0x16754100, 0xB0347E1E } },
+        { 3, { 0xFD585989, 0xF1A34661, 0x19FC1D01, 0x37E274B5, 0xB2EE50F0, 0xAD1F44CA } },
+    };
+    const char* dumpDir = getenv("SIDEEYE_GOLDEN_DIR");
+
+    for (size_t r = 0; r < sizeof(golden) / sizeof(golden[0]); r++) {
+        for (int page = 0; page < NUM_PAGES; page++) {
+            DisplayManager display;
+            SystemState state = golden_state();
+            display.begin(state);
+            display.setRotation(golden[r].rotation);
+            display.updateDynamicValues(state, (Page)page, true, false, "1.0.0");
+
+            if (dumpDir) {
+                char path[256];
+                snprintf(path, sizeof(path), "%s/page%d_rot%d.ppm", dumpDir, page, golden[r].rotation);
+                _mock_panel->writePPM(path);
+            }
+            TEST_ASSERT_EQUAL_HEX32_MESSAGE(golden[r].sums[page], _mock_panel->checksum(), "golden frame mismatch");
+        }
+    }
+
+    DisplayManager display;
+    SystemState state = golden_state();
+    display.begin(state);
+    display.updateDynamicValues(state, PAGE_RESOURCES, true, false, "1.0.0");
+    TEST_ASSERT_EQUAL_HEX16(CATPPUCCIN_MAUVE, _mock_panel->getPixel(0, 0));
+    TEST_ASSERT_EQUAL_HEX16(CATPPUCCIN_BASE, _mock_panel->getPixel(239, 134));
+}
+
+// SPI budgets per frame, counted as the bytes the panel driver would clock
+// out. They're set with ~25% headroom over the current cost so regressions
+// (e.g. a value redraw that clears the whole screen) fail loudly.
+void test_display_value_update_budget(void) {
+    DisplayManager display;
+    SystemState state = golden_state();
+    display.begin(state);
+    display.updateDynamicValues(state, PAGE_RESOURCES, true, false, "1.0.0");
+
+    _mock_panel->resetStats();
+    state.cpu_percent = 77.1;
+    state.ram_used_mb = 8192;
+    display.updateDynamicValues(state, PAGE_RESOURCES, false, false, "1.0.0");
+
+    GfxStats stats = _mock_panel->stats();
+    TEST_ASSERT_LESS_THAN(30000, stats.spiBytes());
+    TEST_ASSERT_LESS_THAN(650, stats.windows);
+    TEST_ASSERT_LESS_THAN(240 * 135 / 2, stats.pixels);
+}
+
+void test_display_page_switch_budget(void) {
+    DisplayManager display;
+    SystemState state = golden_state();
+    display.begin(state);
+    display.updateDynamicValues(state, PAGE_NETWORK, true, false, "1.0.0");
+
+    // Cached static layer: a handful of long runs instead of per-glyph windows
+    _mock_panel->resetStats();
+    display.drawStaticUI(state, PAGE_NETWORK, "1.0.0");
+    GfxStats stats = _mock_panel->stats();
+    TEST_ASSERT_LESS_THAN(16, stats.windows);
+    TEST_ASSERT_LESS_THAN(80000, stats.spiBytes());
+
+    // Dropping the cache costs a rasterize, but never more than one full frame
+    // plus the text drawn live on top of it
+    display.invalidateStaticLayers();
+    _mock_panel->resetStats();
+    display.updateDynamicValues(state, PAGE_NETWORK, true, false, "1.0.0");
+    stats = _mock_panel->stats();
+    TEST_ASSERT_LESS_THAN(120000, stats.spiBytes());
+}
+#endif
+
 void test_sync_manager_frequency() {
 #ifdef NATIVE
     SyncManager sync;
@@ -487,21 +2287,68 @@ int main(int argc, char **argv) {
     UNITY_BEGIN();
     RUN_TEST(test_history_push_and_get);
     RUN_TEST(test_history_max);
+    RUN_TEST(test_history_sliding_min_max);
+    RUN_TEST(test_history_pow2_and_spans);
     RUN_TEST(test_input_click);
     RUN_TEST(test_input_click_disconnected);
     RUN_TEST(test_input_double_click_and_hold);
     RUN_TEST(test_input_notify_activity);
     RUN_TEST(test_display_draw_identity);
     RUN_TEST(test_display_format_speed);
+    RUN_TEST(test_static_string);
     RUN_TEST(test_display_draw_smoke);
     RUN_TEST(test_display_sd_disconnected);
     RUN_TEST(test_display_backlight_pwm);
+    RUN_TEST(test_tween);
+    RUN_TEST(test_scheduler);
+    RUN_TEST(test_display_notification_non_blocking);
+    RUN_TEST(test_render_scheduler_coalesces);
+    RUN_TEST(test_render_scheduler_screen_off);
+    RUN_TEST(test_static_layer_rle);
+    RUN_TEST(test_static_layer_cache_eviction);
+    RUN_TEST(test_rollup_tiers);
+    RUN_TEST(test_rollup_jitter_and_gaps);
+    RUN_TEST(test_rollup_day_tier);
+    RUN_TEST(test_rollup_peak_scrolls_out);
+    RUN_TEST(test_display_network_graph_history);
+    RUN_TEST(test_history_store_round_trip);
+    RUN_TEST(test_history_store_rotation_and_corruption);
+    RUN_TEST(test_stats_log_append_and_query);
+    RUN_TEST(test_stats_log_rotation);
+    RUN_TEST(test_stats_log_bounded_query);
+    RUN_TEST(test_display_static_layer_cached);
+    RUN_TEST(test_display_golden_pages);
+    RUN_TEST(test_display_value_update_budget);
+    RUN_TEST(test_display_page_switch_budget);
     RUN_TEST(test_sync_manager_full);
     RUN_TEST(test_sync_manager_single_file);
     RUN_TEST(test_sync_manager_multi_chunk);
     RUN_TEST(test_sync_manager_nested_dir);
     RUN_TEST(test_sync_manager_frequency);
     RUN_TEST(test_network_manager_full);
+    RUN_TEST(test_network_publish_no_alloc);
+    RUN_TEST(test_network_publish_changes_only);
+    RUN_TEST(test_network_discovery_streamed);
+    RUN_TEST(test_network_connect_state_machine);
+    RUN_TEST(test_network_offline_queue);
+    RUN_TEST(test_network_offline_one_shots);
+    RUN_TEST(test_network_config_migration);
+    RUN_TEST(test_network_wifi_bring_up);
+    RUN_TEST(test_network_publish_metrics);
+    RUN_TEST(test_network_udp_telemetry);
+    RUN_TEST(test_publish_queue);
+    RUN_TEST(test_config_store);
+    RUN_TEST(test_boot_profile);
+    RUN_TEST(test_latency_histogram);
+    RUN_TEST(test_trace_ring);
+    RUN_TEST(test_app_serial_loop);
+    RUN_TEST(test_app_ble_transport);
+    RUN_TEST(test_spsc_ring);
+    RUN_TEST(test_spsc_ring_threads);
+    RUN_TEST(test_app_mqtt_settings_deferred);
+    RUN_TEST(test_presence_tracker);
+    RUN_TEST(test_ble_presence_targets);
+    RUN_TEST(test_host_table);
     RUN_TEST(test_input_handler_extended);
     RUN_TEST(test_display_manager_extended);
     UNITY_END();
@@ -0,0 +1,400 @@
+#include <unity.h>
+#include <Arduino.h>
+#include <WiFi.h>
+#include <SD.h>
+#include <LittleFS.h>
+#include <PubSubClient.h>
+
+#include "../../test/mocks/mocks.cpp"
+
+#include <algorithm>
+#include <chrono>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "HistoryBuffer.h"
+#include "TelemetryHistory.h"
+#include "DisplayManager.h"
+#include "SyncManager.h"
+#include "NetworkManager.h"
+#include "SideEyeApp.h"
+#include "SpscRing.h"
+#include <MockClock.h>
+
+/*
+ * Microbenchmarks for the firmware hot paths, run on the host against the
+ * mocks with `pio test -e native-bench`. Each benchmark warms up, then times
+ * every sample on its own and reports the median and p99 in nanoseconds and
+ * the heap allocations (operator new) per operation. Results are written to
+ * bench_results.json (or $SIDEEYE_BENCH_OUT) so runs can be diffed between
+ * commits. Absolute numbers are host numbers; compare them, don't quote them.
+ *
+ * The replays feed whole host sessions (synthetic ones, plus a recording
+ * named by $SIDEEYE_REPLAY_SESSION) through SideEyeApp::loop() at virtual
+ * time and report throughput, dropped frames and render counts.
+ */
+
+struct BenchResult {
+    std::string name;
+    uint32_t iterations;
+    double medianNs;
+    double p99Ns;
+    double allocsPerOp;
+};
+
+static std::vector<BenchResult> _bench_results;
+
+struct ReplayResult {
+    std::string name;
+    uint32_t framesSent;
+    unsigned long virtualMs;
+    double wallMs;
+    SideEyeApp::Counters counters;
+};
+
+static std::vector<ReplayResult> _replay_results;
+
+// Times `op` `iterations` times after `warmup` untimed calls. Fast operations
+// run `batch` times per sample so clock overhead doesn't swamp them.
+template <typename Op>
+static void bench(const char* name, Op op, uint32_t iterations = 2000, uint32_t warmup = 200, uint32_t batch = 1) {
+    for (uint32_t i = 0; i < warmup; i++) op();
+
+    std::vector<double> samples;
+    samples.reserve(iterations);
+    size_t allocations = 0;
+    for (uint32_t i = 0; i < iterations; i++) {
+        size_t before = _mock_allocations;
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        for (uint32_t b = 0; b < batch; b++) op();
+        std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+        allocations += _mock_allocations - before;
+        samples.push_back((double)std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() / batch);
+    }
+    std::sort(samples.begin(), samples.end());
+
+    BenchResult result;
+    result.name = name;
+    result.iterations = iterations * batch;
+    result.medianNs = samples[samples.size() / 2];
+    result.p99Ns = samples[std::min(samples.size() - 1, (samples.size() * 99 + 99) / 100 - 1)];
+    result.allocsPerOp = (double)allocations / (iterations * batch);
+    _bench_results.push_back(result);
+
+    printf("%-28s median %10.1f ns  p99 %10.1f ns  %6.2f allocs/op\n", name, result.medianNs, result.p99Ns,
+           result.allocsPerOp);
+    TEST_ASSERT_GREATER_THAN(0, (int)samples.size());
+}
+
+static bool write_results(const char* path) {
+    FILE* out = fopen(path, "w");
+    if (!out) return false;
+    fprintf(out, "{\"compiler\":\"%s\",\"benchmarks\":{", __VERSION__);
+    for (size_t i = 0; i < _bench_results.size(); i++) {
+        const BenchResult& r = _bench_results[i];
+        fprintf(out, "%s\n  \"%s\":{\"iterations\":%lu,\"median_ns\":%.1f,\"p99_ns\":%.1f,\"allocs_per_op\":%.2f}",
+                i > 0 ? "," : "", r.name.c_str(), (unsigned long)r.iterations, r.medianNs, r.p99Ns,
+                r.allocsPerOp);
+    }
+    fprintf(out, "\n},\"replays\":{");
+    for (size_t i = 0; i < _replay_results.size(); i++) {
+        const ReplayResult& r = _replay_results[i];
+        const SideEyeApp::Counters& c = r.counters;
+        fprintf(out, "%s\n  \"%s\":{\"frames_sent\":%lu,\"frames_handled\":%lu,\"frames_dropped\":%lu,"
+                "\"loops\":%lu,\"static_renders\":%lu,\"value_renders\":%lu,\"banner_renders\":%lu,"
+                "\"virtual_ms\":%lu,\"wall_ms\":%.1f,\"frames_per_s\":%.0f,\"speedup\":%.0f}",
+                i > 0 ? "," : "", r.name.c_str(), (unsigned long)r.framesSent, (unsigned long)c.frames,
+                (unsigned long)(c.rejected + c.overflows), (unsigned long)c.loops, (unsigned long)c.staticRenders,
+                (unsigned long)c.valueRenders, (unsigned long)c.bannerRenders, r.virtualMs, r.wallMs,
+                r.framesSent / (r.wallMs / 1000), r.virtualMs / r.wallMs);
+    }
+    fprintf(out, "\n}}\n");
+    return fclose(out) == 0;
+}
+
+void setUp(void) {
+    _mock_millis = 0;
+    _mock_digitalRead_val = HIGH;
+    _mock_broker = MockBroker();
+    _mock_lfs_files.clear();
+    _mock_sd_files.clear();
+    WiFi = WiFiClass();
+}
+
+void tearDown(void) {
+}
+
+static const char* const IDENTITY_FRAME =
+    "{\"type\":\"Identity\",\"data\":{\"hostname\":\"workstation\",\"ip\":\"192.168.1.20\","
+    "\"mac\":\"AA:BB:CC:DD:EE:FF\",\"os\":\"Linux 6.8\",\"user\":\"nicholas\"}}";
+static const char* const STATS_FRAME =
+    "{\"type\":\"Stats\",\"data\":{\"cpu_percent\":37.5,\"ram_used\":6442450944,\"ram_total\":17179869184,"
+    "\"disk_used\":214748364800,\"disk_total\":536870912000,\"net_up\":125000,\"net_down\":2500000,"
+    "\"uptime\":86400,\"thermal_c\":61.5,\"gpu_percent\":12.0,\"alert_level\":0}}";
+static const char* const WRITE_CHUNK_FRAME =
+    "{\"type\":\"WriteChunk\",\"data\":{\"path\":\"/bench.bin\",\"offset\":0,"
+    "\"data\":\"AAECAwQFBgcICQoLDA0ODxAREhMUFRYXGBkaGxwdHh8gISIjJCUmJygpKissLS4vMDEyMzQ1Njc4OTo7PD0+Pw==\"}}";
+static const char* const LIST_FILES_FRAME = "{\"type\":\"ListFiles\",\"data\":{\"path\":\"/\"}}";
+static const char* const GET_VERSION_FRAME = "{\"type\":\"GetVersion\"}";
+
+// A SideEyeApp on virtual time; serial output is captured and thrown away
+struct AppFixture {
+    MockClock clock;
+    DisplayManager display;
+    SideEyeNetworkManager network;
+    SideEyeApp app;
+
+    AppFixture() : app(clock, Serial, display, network, "bench") {
+        app.begin("BENCH", []() {}, [](WiFiManager*) {}, []() {});
+        Serial._capture = true;
+    }
+
+    ~AppFixture() {
+        Serial._capture = false;
+        Serial._output.clear();
+    }
+
+    void handle(const String& json) {
+        app.handleJson(json);
+        Serial._output.clear();
+    }
+};
+
+void bench_handle_json(void) {
+    AppFixture fixture;
+    String identity(IDENTITY_FRAME), stats(STATS_FRAME), writeChunk(WRITE_CHUNK_FRAME);
+    String listFiles(LIST_FILES_FRAME), getVersion(GET_VERSION_FRAME);
+    bench("handle_json/identity", [&]() { fixture.handle(identity); });
+    bench("handle_json/stats", [&]() {
+        fixture.clock.advance(1000);
+        fixture.handle(stats);
+    });
+    bench("handle_json/write_chunk", [&]() { fixture.handle(writeChunk); });
+    bench("handle_json/list_files", [&]() { fixture.handle(listFiles); });
+    bench("handle_json/get_version", [&]() { fixture.handle(getVersion); });
+}
+
+void bench_history_buffer(void) {
+    HistoryBuffer<float, 128> buffer;
+    float value = 0;
+    bench("history/push", [&]() { buffer.push(value += 1.5f); }, 2000, 200, 64);
+    bench("history/max", [&]() { volatile float m = buffer.max(); (void)m; }, 2000, 200, 64);
+    bench("history/mean", [&]() { volatile double m = buffer.mean(); (void)m; }, 2000, 200, 16);
+
+    RollupSeries series;
+    unsigned long now = 0;
+    bench("history/rollup_push", [&]() { series.push(value += 1.5f, now += 1000); }, 2000, 200, 16);
+}
+
+void bench_draw_pages(void) {
+    AppFixture fixture;
+    fixture.handle(IDENTITY_FRAME);
+    for (int i = 0; i < 120; i++) {
+        fixture.clock.advance(1000);
+        fixture.handle(STATS_FRAME);
+    }
+    SystemState state = fixture.app.state();
+    DisplayManager& display = fixture.display; // Graphs use the app's history
+
+    bench("draw/identity", [&]() { display.drawIdentityPage(state, false); }, 500, 50);
+    bench("draw/resources", [&]() { display.drawResourcesPage(state, false); }, 500, 50);
+    bench("draw/status", [&]() { display.drawStatusPage(state, false); }, 500, 50);
+    bench("draw/sd", [&]() { display.drawSDPage(state, false); }, 500, 50);
+    bench("draw/thermal", [&]() { display.drawThermalPage(state, false); }, 500, 50);
+    bench("draw/network", [&]() { display.drawNetworkPage(state, false); }, 500, 50);
+}
+
+void bench_write_chunk(void) {
+    SyncManager sync;
+    sync.begin();
+    JsonDocument doc;
+    deserializeJson(doc, WRITE_CHUNK_FRAME);
+    JsonObject data = doc["data"];
+    bench("sync/write_chunk", [&]() { sync.handleWriteChunk(data); });
+}
+
+void bench_publish_state(void) {
+    SideEyeNetworkManager nm;
+    BLEPresenceManager ble;
+    SystemState state;
+    nm.begin("BENCH", "1.0.0", state, []() {}, [](WiFiManager*) {}, []() {});
+    nm.setDrainRate(NUM_TOPICS, 0);
+    nm.reconnectMQTT();
+    TEST_ASSERT_EQUAL(MQTT_CONNECTED, nm.mqttPhase());
+
+    AppFixture fixture;
+    fixture.handle(IDENTITY_FRAME);
+    fixture.handle(STATS_FRAME);
+    state = fixture.app.state();
+    nm.publishState(state, ble);
+
+    bench("publish_state/unchanged", [&]() { nm.publishState(state, ble); });
+    bench("publish_state/changed", [&]() {
+        state.cpu_percent = state.cpu_percent > 50 ? 10 : 90;
+        nm.publishState(state, ble);
+    });
+}
+
+void bench_spsc_ring(void) {
+    static SpscRing<uint32_t, 64> ring;
+    uint32_t value = 0;
+    bench("spsc/push_pop", [&]() {
+        ring.push(value);
+        ring.pop(value);
+    }, 2000, 200, 64);
+
+    // Producer and consumer on their own threads; each sample is the cost
+    // per item of moving a whole run across
+    const uint32_t items = 200000;
+    std::vector<double> samples;
+    for (int run = 0; run < 15; run++) {
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        std::thread producer([&]() {
+            for (uint32_t i = 0; i < items; i++) {
+                while (!ring.push(i)) std::this_thread::yield();
+            }
+        });
+        for (uint32_t received = 0; received < items;) {
+            if (ring.pop(value)) received++;
+            else std::this_thread::yield();
+        }
+        producer.join();
+        std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now();
+        samples.push_back((double)std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count() / items);
+    }
+    std::sort(samples.begin(), samples.end());
+
+    BenchResult result;
+    result.name = "spsc/cross_thread";
+    result.iterations = items * samples.size();
+    result.medianNs = samples[samples.size() / 2];
+    result.p99Ns = samples.back();
+    result.allocsPerOp = 0;
+    _bench_results.push_back(result);
+    printf("%-28s median %10.1f ns  p99 %10.1f ns  (%.1f M items/s)\n", result.name.c_str(), result.medianNs,
+           result.p99Ns, 1000 / result.medianNs);
+    TEST_ASSERT_EQUAL(items - 1, value);
+}
+
+// One line of a recorded host session: when it arrived and what it said
+struct SessionLine {
+    unsigned long at; // ms since the session started
+    std::string json;
+};
+
+// Loads a session recorded as "<ms>\t<frame>" lines, e.g. by timestamping a
+// serial capture of the host
+static std::vector<SessionLine> load_session(const char* path) {
+    std::vector<SessionLine> session;
+    FILE* in = fopen(path, "r");
+    if (!in) return session;
+    char line[1024];
+    while (fgets(line, sizeof(line), in)) {
+        char* tab = strchr(line, '\t');
+        if (!tab) continue;
+        SessionLine entry;
+        entry.at = strtoul(line, nullptr, 10);
+        entry.json.assign(tab + 1, strcspn(tab + 1, "\r\n"));
+        session.push_back(entry);
+    }
+    fclose(in);
+    return session;
+}
+
+// A host reporting every `intervalMs` for `seconds`, with an alert spike
+// each minute and a 16-chunk file sync every two minutes
+static std::vector<SessionLine> synthetic_session(unsigned long seconds, unsigned long intervalMs) {
+    std::vector<SessionLine> session;
+    session.push_back({0, IDENTITY_FRAME});
+    char json[512];
+    for (unsigned long t = intervalMs; t <= seconds * 1000; t += intervalMs) {
+        unsigned long second = t / 1000;
+        bool spike = second % 60 >= 50 && second % 60 < 55;
+        snprintf(json, sizeof(json),
+                 "{\"type\":\"Stats\",\"data\":{\"cpu_percent\":%.1f,\"ram_used\":%llu,\"ram_total\":17179869184,"
+                 "\"net_up\":%lu,\"net_down\":%lu,\"uptime\":%lu,\"thermal_c\":%.1f,\"alert_level\":%d}}",
+                 spike ? 97.0 : 20.0 + (t / intervalMs) % 40, 6442450944ULL + (t % 7) * 1048576,
+                 (t * 37) % 250000, (t * 131) % 4000000, 86400 + second, 55.0 + (t / intervalMs) % 10,
+                 spike ? 2 : 0);
+        session.push_back({t, json});
+        if (second % 120 == 30 && t % 1000 < intervalMs) {
+            for (uint8_t chunk = 0; chunk < 16; chunk++) {
+                session.push_back({t + chunk * 10, WRITE_CHUNK_FRAME});
+            }
+        }
+    }
+    std::stable_sort(session.begin(), session.end(),
+                     [](const SessionLine& a, const SessionLine& b) { return a.at < b.at; });
+    return session;
+}
+
+// Runs the session through SideEyeApp::loop(), one pass every `loopMs` of
+// virtual time, delivering each line to the mock serial port when it's due
+static void replay(const char* name, const std::vector<SessionLine>& session, unsigned long loopMs = 5) {
+    AppFixture fixture;
+    uint32_t sent = 0;
+    unsigned long end = session.empty() ? 0 : session.back().at + 1000;
+    unsigned long start = fixture.clock.millis();
+
+    std::chrono::steady_clock::time_point wallStart = std::chrono::steady_clock::now();
+    size_t next = 0;
+    while (fixture.clock.millis() - start <= end) {
+        while (next < session.size() && session[next].at <= fixture.clock.millis() - start) {
+            Serial._feed(session[next].json + "\n");
+            next++;
+            sent++;
+        }
+        fixture.app.loop();
+        Serial._output.clear();
+        fixture.clock.advance(loopMs);
+    }
+    std::chrono::steady_clock::time_point wallEnd = std::chrono::steady_clock::now();
+
+    ReplayResult result;
+    result.name = name;
+    result.framesSent = sent;
+    result.virtualMs = end;
+    result.wallMs = std::chrono::duration_cast<std::chrono::microseconds>(wallEnd - wallStart).count() / 1000.0;
+    result.counters = fixture.app.counters();
+    _replay_results.push_back(result);
+
+    const SideEyeApp::Counters& c = result.counters;
+    printf("%-28s %lu frames in %.0f ms (%.0fx real time): %lu handled, %lu dropped, "
+           "%lu static + %lu value + %lu banner renders over %lu loops\n",
+           name, (unsigned long)sent, result.wallMs, end / result.wallMs, (unsigned long)c.frames,
+           (unsigned long)(c.rejected + c.overflows), (unsigned long)c.staticRenders, (unsigned long)c.valueRenders,
+           (unsigned long)c.bannerRenders, (unsigned long)c.loops);
+    TEST_ASSERT_EQUAL(sent, c.frames + c.rejected + c.overflows);
+}
+
+void replay_sessions(void) {
+    replay("replay/desktop_1hz", synthetic_session(600, 1000));
+    replay("replay/burst_20hz", synthetic_session(60, 50));
+
+    // A real capture, if one is given
+    const char* path = getenv("SIDEEYE_REPLAY_SESSION");
+    if (path) {
+        std::vector<SessionLine> session = load_session(path);
+        TEST_ASSERT_GREATER_THAN(0, (int)session.size());
+        replay("replay/recorded", session);
+    }
+}
+
+int main(int argc, char **argv) {
+    UNITY_BEGIN();
+    RUN_TEST(bench_handle_json);
+    RUN_TEST(bench_history_buffer);
+    RUN_TEST(bench_draw_pages);
+    RUN_TEST(bench_write_chunk);
+    RUN_TEST(bench_publish_state);
+    RUN_TEST(bench_spsc_ring);
+    RUN_TEST(replay_sessions);
+
+    const char* path = getenv("SIDEEYE_BENCH_OUT");
+    if (!path) path = "bench_results.json";
+    if (write_results(path)) printf("Results written to %s\n", path);
+    return UNITY_END();
+}